@@ -1,6 +1,11 @@
 #include "application.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include <thread>
 
 #include <spdlog/spdlog.h>
 
@@ -20,9 +25,14 @@
 #include "transform.h"
 #include "matrix_math.h"
 #include "scene.h"
+#include "scene_loader.h"
 #include "renderer.h"
 #include "shader.h"
+#include "texture.h"
 #include "logger.h"
+#include "profiler.h"
+#include "headless.h"
+#include "./mesh/buffer_pool.h"
 #include "./mesh/model_importer.h"
 #include "./mesh/object.h"
 #include "utilities.h"
@@ -53,6 +63,10 @@ void Application::SetAppState(const APP_STATE to_add) {
   Instance().app_state_ = to_add;
 }
 
+void Application::SetHeadless(const HeadlessOptions& options) {
+  headless_ = options;
+}
+
 // handling key inputs
 void InputHandle(GLFWwindow* window, int key, int scancode, int action,
                  int mods) {
@@ -101,16 +115,26 @@ Application& Application::Instance() {
 }
 
 Application::Application()
-    : vsync_(true),
+    : window_(nullptr),
+      headless_context_(nullptr),
+      vsync_(true),
       app_state_(APP_STATE::VIEWPORT_FOCUS),
       current_scene_index_(0),
       selected_obj_index_(-1) {
   LOG_TRACE("Application()");
+  // the statics are destroyed in the reverse order of their construction, the
+  // singletons used by CleanUp() must be made before this one is done
+  TextureManager::Instance();
+  Profiler::Instance();
+  BufferPool::Instance();
   Init();
 }
 
 void Application::CleanUp() {
+  // stops the background loading before the scenes it fills are deleted
+  delete scene_loader_;
   delete renderer_;
+  Profiler::Instance().Shutdown();
 
   for (int i = 0; i < shaders_.size(); i++) {
     delete shaders_[i];
@@ -119,6 +143,13 @@ void Application::CleanUp() {
   for (int i = 0; i < scenes_.size(); i++) {
     delete scenes_[i];
   }
+  TextureManager::Instance().Shutdown();
+  BufferPool::Instance().Shutdown();
+
+  if (headless_) {
+    delete headless_context_;
+    return;
+  }
 
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
@@ -137,50 +168,63 @@ void Application::Init() {
   spdlog::set_level(spdlog::level::trace);
 #endif  // NDEBUG
 
-  // Initialize the window library
-  if (!glfwInit()) {
-    LOG_ERROR("GLFW Init fail");
-    throw AppInitException();
-  }
-  LOG_INFO("Initialized GLFW");
-
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
-  // Create a windowed mode window and its OpenGL context
-  window_ = glfwCreateWindow(properties_.Width, properties_.Height,
-                             properties_.Title.c_str(), nullptr, nullptr);
-  if (!window_) {
-    glfwTerminate();
-    LOG_ERROR("GLFW Window creation fail");
-    throw AppInitException();
+  if (headless_) {
+    headless_context_ = new HeadlessContext();
+    // the core profile functions are only loaded this way without GLX
+    glewExperimental = GL_TRUE;
+  } else {
+    // Initialize the window library
+    if (!glfwInit()) {
+      LOG_ERROR("GLFW Init fail");
+      throw AppInitException();
+    }
+    LOG_INFO("Initialized GLFW");
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
+    // Create a windowed mode window and its OpenGL context
+    window_ = glfwCreateWindow(properties_.Width, properties_.Height,
+                               properties_.Title.c_str(), nullptr, nullptr);
+    if (!window_) {
+      glfwTerminate();
+      LOG_ERROR("GLFW Window creation fail");
+      throw AppInitException();
+    }
+    // Make the window's context current
+    glfwMakeContextCurrent(window_);
   }
-  // Make the window's context current
-  glfwMakeContextCurrent(window_);
 
   // initialize everything else
   GLenum res = glewInit();
-  if (res != GLEW_OK) {
+  // GLEW built for GLX can't find a display with EGL, the functions are
+  // loaded anyway
+  if (res != GLEW_OK && !(headless_ && res == GLEW_ERROR_NO_GLX_DISPLAY)) {
     LOG_ERROR("GLEW Init fail");
     throw AppInitException();
   }
   LOG_INFO("Initialized GLEW");
 
-  // input settings
-  glfwSetKeyCallback(window_, InputHandle);
+  if (!headless_) {
+    // input settings
+    glfwSetKeyCallback(window_, InputHandle);
 
-  // cursor settings
-  glfwSetInputMode(window_, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-  if (glfwRawMouseMotionSupported()) {
-    LOG_INFO("Raw mouse input detected -> enabled raw mouse input");
-    glfwSetInputMode(window_, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
-  }
+    // cursor settings
+    glfwSetInputMode(window_, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    if (glfwRawMouseMotionSupported()) {
+      LOG_INFO("Raw mouse input detected -> enabled raw mouse input");
+      glfwSetInputMode(window_, GLFW_RAW_MOUSE_MOTION, GLFW_TRUE);
+    }
 
-  glfwSetWindowPos(window_, 100, 100);
-  glfwSetCursorPos(window_, 0, 0);
+    glfwSetWindowPos(window_, 100, 100);
+    glfwSetCursorPos(window_, 0, 0);
 
-  glfwSwapInterval(vsync_);
+    glfwSwapInterval(vsync_);
+  }
 
   renderer_ = new Renderer();
+  // the control shaders count their patches only where they can, the driver
+  // may have no atomic counters there
+  const bool patch_stats = renderer_->patch_stats();
 
   // pointers because if I copy to the vector then it's going to destroy the
   // local Shader in this scope, calling the destructor and deleting the shader
@@ -192,6 +236,9 @@ void Application::Init() {
   default_shader->AddShaderFile(GL_TESS_EVALUATION_SHADER,
                                 "shaders/phong_tessellation.tese");
   default_shader->AddShaderFile(GL_FRAGMENT_SHADER, "shaders/phong.frag");
+  if (patch_stats) {
+    default_shader->AddDefine("PATCH_STATS");
+  }
 
   default_shader->Init();
 
@@ -201,6 +248,9 @@ void Application::Init() {
                              "shaders/pass_through_quad.tesc");
   quad_shader->AddShaderFile(GL_TESS_EVALUATION_SHADER, "shaders/terrain.tese");
   quad_shader->AddShaderFile(GL_FRAGMENT_SHADER, "shaders/phong.frag");
+  if (patch_stats) {
+    quad_shader->AddDefine("PATCH_STATS");
+  }
 
   quad_shader->Init();
 
@@ -211,6 +261,9 @@ void Application::Init() {
   terrain_shader->AddShaderFile(GL_TESS_EVALUATION_SHADER,
                                 "shaders/terrain.tese");
   terrain_shader->AddShaderFile(GL_FRAGMENT_SHADER, "shaders/phong.frag");
+  if (patch_stats) {
+    terrain_shader->AddDefine("PATCH_STATS");
+  }
 
   terrain_shader->Init();
 
@@ -218,132 +271,203 @@ void Application::Init() {
                                         {"QuadsShader", quad_shader},
                                         {"TerrainShader", terrain_shader}});
 
-  Scene* objects_scene = new Scene("Objects");
-  StaticModelCreator smc;
-
-  Transform mars_t;
-  StaticModel* mars =
-      smc.CreateMesh("Mars rover", "models/PerseveranceByNidal.glb");
-  mars_t.translate(-5.0F, 0.0F, 0.0F);
-  mars->transform(mars_t);
-  objects_scene->AddObject(mars);
-
-  /*
-  // TODO debug weird light
-  mars_t.translate(0.0F, 0.0F, 0.0F);
-  StaticModel* katana =
-      smc.CreateMesh("Katana", "models/dragon_katana_oni_koroshi.glb");
-  katana->transform(mars_t);
-  objects_scene->AddObject(katana);
-  */
-  Transform cube_tri_t;
-  cube_tri_t.translate(-5.0F, 0.0F, 0.0F);
-
-  const std::vector<Vertex> c_vertices = {
-      {glm::vec3(-2.0F, 2.0F, -2.0F), glm::vec2(0.0F, 0.0F)},
-      {glm::vec3(2.0F, 2.0F, 2.0F), glm::vec2(0.0F, 0.0F)},
-      {glm::vec3(2.0F, 2.0F, -2.0F), glm::vec2(0.0F, 0.0F)},
-      {glm::vec3(-2.0F, -2.0F, 2.0F), glm::vec2(0.0F, 0.0F)},
-      {glm::vec3(2.0F, -2.0F, 2.0F), glm::vec2(0.0F, 0.0F)},
-      {glm::vec3(-2.0F, 2.0F, 2.0F), glm::vec2(0.0F, 0.0F)},
-      {glm::vec3(-2.0F, -2.0F, -2.0F), glm::vec2(0.0F, 0.0F)},
-      {glm::vec3(2.0F, -2.0F, -2.0F), glm::vec2(0.0F, 0.0F)},
-  };
-  const std::vector<unsigned int> c_indices = {
-      0, 1, 2,  //
-      1, 3, 4,  //
-      5, 6, 3,  //
-      7, 3, 6,  //
-      2, 4, 7,  //
-      0, 7, 6,  //
-      0, 5, 1,  //
-      1, 5, 3,  //
-      5, 0, 6,  //
-      7, 4, 3,  //
-      2, 1, 4,  //
-      0, 2, 7,  //
-  };
-
-  SubDivMeshCreator sdmc;
-  Scene* manifolds = new Scene("Manifolds");
-  cube_tri_t.translate(-5.0F, 0.0F, 0.0F);
-
-  SubDivMesh* plane_sub = sdmc.CreateMesh("plane", "models/plane_trig.obj");
-  plane_sub->transform(cube_tri_t);
-  manifolds->AddObject(plane_sub);
-
-  cube_tri_t.translate(5.0F, 0.0F, 0.0F);
-  SubDivMesh* open_sphere =
-      sdmc.CreateMesh("open sphere", "models/opensphere.obj");
-  open_sphere->transform(cube_tri_t);
-  manifolds->AddObject(open_sphere);
-
-  cube_tri_t.translate(-10.0F, 0.0F, 0.0F);
-  SubDivMesh* triangle = sdmc.CreateMesh("triangle", "models/triangle.obj");
-  triangle->transform(cube_tri_t);
-  manifolds->AddObject(triangle);
-
-  /*
-  cube_tri_t.translate(-15.0F, 0.0F, 0.0F);
-  SubDivMesh* qcube = sdmc.CreateMesh("QUADCUBE", "models/cube/cube_quad.obj");
-  qcube->ApplySmoothShading();
-  qcube->transform(cube_tri_t);
-  manifolds->AddObject(qcube);
-  */
+  // the scenes are empty until their models have been read in the background
+  // and their objects made by scene_loader_->Update() (see Run())
+  scene_loader_ = new SceneLoader();
 
-  SubDivMesh* subdiv_cube =
-      sdmc.CreateMesh("cuboide", MESH_TYPE::TRI, c_vertices, c_indices);
+  Scene* objects_scene = new Scene("Objects");
+  scene_loader_->Add(
+      objects_scene, {{"models/PerseveranceByNidal.glb", Options()}},
+      [](Scene* scene, const std::vector<std::vector<ImportedMesh>>& models) {
+        StaticModelCreator smc;
+        Transform mars_t;
+        StaticModel* mars = smc.CreateMesh("Mars rover", models[0]);
+        mars_t.translate(-5.0F, 0.0F, 0.0F);
+        mars->transform(mars_t);
+        scene->AddObject(mars);
+
+        /*
+        // TODO debug weird light
+        mars_t.translate(0.0F, 0.0F, 0.0F);
+        StaticModel* katana =
+            smc.CreateMesh("Katana", "models/dragon_katana_oni_koroshi.glb");
+        katana->transform(mars_t);
+        scene->AddObject(katana);
+        */
+      });
 
-  subdiv_cube->ApplySmoothShading();
-  manifolds->AddObject(subdiv_cube);
+  Scene* manifolds = new Scene("Manifolds");
+  const Options subdiv_opts = SubDivMeshCreator::ImportOptions();
+  // the schemes refuse meshes that are not manifold, a closed model split at
+  // its normal seams would have boundaries. Only for the untextured ones, a
+  // welded vertex keeps the uv of one side of the seam
+  Options welded_opts = subdiv_opts;
+  welded_opts.weld_vertices = true;
+  scene_loader_->Add(
+      manifolds,
+      {{"models/plane_trig.obj", subdiv_opts},
+       {"models/opensphere.obj", welded_opts},
+       {"models/triangle.obj", welded_opts}},
+      [](Scene* scene, const std::vector<std::vector<ImportedMesh>>& models) {
+        const std::vector<Vertex> c_vertices = {
+            {glm::vec3(-2.0F, 2.0F, -2.0F), glm::vec2(0.0F, 0.0F)},
+            {glm::vec3(2.0F, 2.0F, 2.0F), glm::vec2(0.0F, 0.0F)},
+            {glm::vec3(2.0F, 2.0F, -2.0F), glm::vec2(0.0F, 0.0F)},
+            {glm::vec3(-2.0F, -2.0F, 2.0F), glm::vec2(0.0F, 0.0F)},
+            {glm::vec3(2.0F, -2.0F, 2.0F), glm::vec2(0.0F, 0.0F)},
+            {glm::vec3(-2.0F, 2.0F, 2.0F), glm::vec2(0.0F, 0.0F)},
+            {glm::vec3(-2.0F, -2.0F, -2.0F), glm::vec2(0.0F, 0.0F)},
+            {glm::vec3(2.0F, -2.0F, -2.0F), glm::vec2(0.0F, 0.0F)},
+        };
+        const std::vector<unsigned int> c_indices = {
+            0, 1, 2,  //
+            1, 3, 4,  //
+            5, 6, 3,  //
+            7, 3, 6,  //
+            2, 4, 7,  //
+            0, 7, 6,  //
+            0, 5, 1,  //
+            1, 5, 3,  //
+            5, 0, 6,  //
+            7, 4, 3,  //
+            2, 1, 4,  //
+            0, 2, 7,  //
+        };
+
+        SubDivMeshCreator sdmc;
+        Transform cube_tri_t;
+        cube_tri_t.translate(-5.0F, 0.0F, 0.0F);
+
+        SubDivMesh* plane_sub = sdmc.CreateMesh("plane", models[0]);
+        plane_sub->transform(cube_tri_t);
+        scene->AddObject(plane_sub);
+
+        cube_tri_t.translate(5.0F, 0.0F, 0.0F);
+        SubDivMesh* open_sphere = sdmc.CreateMesh("open sphere", models[1]);
+        open_sphere->transform(cube_tri_t);
+        scene->AddObject(open_sphere);
+
+        cube_tri_t.translate(-10.0F, 0.0F, 0.0F);
+        SubDivMesh* triangle = sdmc.CreateMesh("triangle", models[2]);
+        triangle->transform(cube_tri_t);
+        scene->AddObject(triangle);
+
+        /*
+        cube_tri_t.translate(-15.0F, 0.0F, 0.0F);
+        SubDivMesh* qcube =
+            sdmc.CreateMesh("QUADCUBE", "models/cube/cube_quad.obj");
+        qcube->ApplySmoothShading();
+        qcube->transform(cube_tri_t);
+        scene->AddObject(qcube);
+        */
+
+        SubDivMesh* subdiv_cube =
+            sdmc.CreateMesh("cuboide", MESH_TYPE::TRI, c_vertices, c_indices);
+
+        subdiv_cube->ApplySmoothShading();
+        scene->AddObject(subdiv_cube);
+      });
 
   Scene* t_scene_subdiv = new Scene("T Scene");
-
-  SubDivMesh* t_meshlab = sdmc.CreateMesh("T", "models/T.ply");
-  Transform t_tranform_matrix_cube;
-  t_tranform_matrix_cube.translate(0.0F, 0.0F, 0.0F);
-  t_meshlab->transform(t_tranform_matrix_cube);
-  t_scene_subdiv->AddObject(t_meshlab);
-
-  for (int i = 1; i < 5; i++) {
-    t_tranform_matrix_cube.translate(i * 10.0F, 0.0F, 0.0F);
-    SubDivMesh* to_add_t = t_meshlab->clone();
-    to_add_t->transform(t_tranform_matrix_cube);
-    t_scene_subdiv->AddObject(to_add_t);
-  }
+  scene_loader_->Add(
+      t_scene_subdiv, {{"models/T.ply", welded_opts}},
+      [](Scene* scene, const std::vector<std::vector<ImportedMesh>>& models) {
+        SubDivMeshCreator sdmc;
+        SubDivMesh* t_meshlab = sdmc.CreateMesh("T", models[0]);
+        Transform t_tranform_matrix_cube;
+        t_tranform_matrix_cube.translate(0.0F, 0.0F, 0.0F);
+        t_meshlab->transform(t_tranform_matrix_cube);
+        scene->AddObject(t_meshlab);
+
+        for (int i = 1; i < 5; i++) {
+          t_tranform_matrix_cube.translate(i * 10.0F, 0.0F, 0.0F);
+          SubDivMesh* to_add_t = t_meshlab->clone();
+          to_add_t->transform(t_tranform_matrix_cube);
+          scene->AddObject(to_add_t);
+        }
+      });
 
   Scene* bunny_scene_subdiv = new Scene("Bunny Scene");
-
-  SubDivMesh* bunny_meshlab = sdmc.CreateMesh("Bunny", "models/bunny2.ply");
-  Transform bunny_tranform_matrix_cube;
-
-  bunny_tranform_matrix_cube.translate(0.0F, 0.0F, 0.0F);
-
-  bunny_meshlab->transform(bunny_tranform_matrix_cube);
-  bunny_scene_subdiv->AddObject(bunny_meshlab);
-
-  for (int i = 1; i < 5; i++) {
-    bunny_tranform_matrix_cube.translate(i * 5.0F, 0.0F, 0.0F);
-    SubDivMesh* to_add_bunny = bunny_meshlab->clone();
-    to_add_bunny->transform(bunny_tranform_matrix_cube);
-    bunny_scene_subdiv->AddObject(to_add_bunny);
-  }
+  scene_loader_->Add(
+      bunny_scene_subdiv, {{"models/bunny2.ply", welded_opts}},
+      [](Scene* scene, const std::vector<std::vector<ImportedMesh>>& models) {
+        SubDivMeshCreator sdmc;
+        SubDivMesh* bunny_meshlab = sdmc.CreateMesh("Bunny", models[0]);
+        Transform bunny_tranform_matrix_cube;
+
+        bunny_tranform_matrix_cube.translate(0.0F, 0.0F, 0.0F);
+
+        bunny_meshlab->transform(bunny_tranform_matrix_cube);
+        scene->AddObject(bunny_meshlab);
+
+        for (int i = 1; i < 5; i++) {
+          bunny_tranform_matrix_cube.translate(i * 5.0F, 0.0F, 0.0F);
+          SubDivMesh* to_add_bunny = bunny_meshlab->clone();
+          to_add_bunny->transform(bunny_tranform_matrix_cube);
+          scene->AddObject(to_add_bunny);
+        }
+      });
+
+  Scene* progressive_scene = new Scene("Progressive Bunny");
+  scene_loader_->Add(
+      progressive_scene,
+      {{"models/bunny2.ply", ProgressiveMeshCreator::ImportOptions()}},
+      [](Scene* scene, const std::vector<std::vector<ImportedMesh>>& models) {
+        ProgressiveMeshCreator pmc;
+        ProgressiveMesh* progressive_bunny = pmc.CreateMesh("Bunny", models[0]);
+        Transform progressive_transform;
+        progressive_bunny->transform(progressive_transform);
+        scene->AddObject(progressive_bunny);
+
+        // the clones share the collapse sequence, it's built once
+        for (int i = 1; i < 3; i++) {
+          progressive_transform.translate(i * 5.0F, 0.0F, 0.0F);
+          ProgressiveMesh* to_add_bunny = progressive_bunny->clone();
+          to_add_bunny->transform(progressive_transform);
+          scene->AddObject(to_add_bunny);
+        }
+      });
 
   Scene* monster_frog = new Scene("MonsterFrog");
   Options monster_opts;
   monster_opts.triangulate = true;
-  StaticModel* monster_frog_model =
-      smc.CreateMesh("Monster", "models/monsterfrog.obj", monster_opts);
-  monster_frog->AddObject(monster_frog_model);
+  scene_loader_->Add(
+      monster_frog, {{"models/monsterfrog.obj", monster_opts}},
+      [](Scene* scene, const std::vector<std::vector<ImportedMesh>>& models) {
+        StaticModelCreator smc;
+        StaticModel* monster_frog_model = smc.CreateMesh("Monster", models[0]);
+        scene->AddObject(monster_frog_model);
+      });
 
   scenes_.push_back(manifolds);
   scenes_.push_back(objects_scene);
   scenes_.push_back(t_scene_subdiv);
   scenes_.push_back(bunny_scene_subdiv);
+  scenes_.push_back(progressive_scene);
   scenes_.push_back(monster_frog);
 
   number_of_scenes_ = static_cast<int>(scenes_.size());
 
+  if (headless_ && !headless_->scene.empty()) {
+    current_scene_index_ = -1;
+    for (int i = 0; i < number_of_scenes_; i++) {
+      if (scenes_[i]->name() == headless_->scene) {
+        current_scene_index_ = i;
+      }
+    }
+    if (current_scene_index_ == -1) {
+      LOG_ERROR("there is no scene {}", headless_->scene);
+      throw AppInitException();
+    }
+  }
+
+  scene_loader_->Prioritize(scenes_[current_scene_index_]);
+  scene_loader_->Start();
+
+  if (headless_) {
+    return;
+  }
+
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
 
@@ -435,9 +559,21 @@ void Application::DrawControls() {
                                ImGui::GetTextLineHeightWithSpacing()))) {
     for (int i = 0; i < number_of_scenes_; i++) {
       const bool is_selected = (current_scene_index_ == i);
-      if (ImGui::Selectable(scenes_[i]->name().c_str(), is_selected)) {
+      std::string label = scenes_[i]->name();
+      if (scene_loader_->IsFailed(scenes_[i])) {
+        label += " (failed)";
+      } else if (!scene_loader_->IsLoaded(scenes_[i])) {
+        label += " (loading " +
+                 std::to_string(static_cast<int>(
+                     scene_loader_->Progress(scenes_[i]) * 100.0F)) +
+                 "%)";
+      }
+      // the label changes while loading, the id must not
+      label += "###" + scenes_[i]->name();
+      if (ImGui::Selectable(label.c_str(), is_selected)) {
         current_scene_index_ = i;
         selected_obj_index_ = -1;
+        scene_loader_->Prioritize(scenes_[i]);
       }
       // Set the initial focus when opening the combo (scrolling +
       // keyboard navigation focus)
@@ -451,6 +587,12 @@ void Application::DrawControls() {
   ImGui::Spacing();
 
   ImGui::SeparatorText("Objects in Scene");
+  if (!scene_loader_->IsLoaded(scenes_[current_scene_index_]) &&
+      !scene_loader_->IsFailed(scenes_[current_scene_index_])) {
+    ImGui::Text("Loading...");
+    ImGui::ProgressBar(
+        scene_loader_->Progress(scenes_[current_scene_index_]));
+  }
   const int objnum = scenes_[current_scene_index_]->NumberOfObjects();
   for (int i = 0; i < objnum; i++) {
     if (ImGui::Selectable(
@@ -514,6 +656,10 @@ void Application::DrawControls() {
     ImGui::Text("tess_level_inner0");
     ImGui::SliderInt("tess_level_inner0 (Tessell level)",
                      renderer_->tess_level(), 1, renderer_->max_tessel_level());
+    ImGui::Checkbox("Screen space adaptive", renderer_->adaptive_tessellation());
+    ImGui::SliderFloat("target pixels per edge",
+                       renderer_->tessellation_edge_pixels(), 1.0F, 64.0F,
+                       "%.1f", slider_flags);
 
     ImGui::SliderFloat("Displacement height", renderer_->displacement_height(),
                        0.0F, 20.0F, "%.2f", ImGuiSliderFlags_None);
@@ -531,6 +677,48 @@ void Application::DrawControls() {
   const ImGuiIO& io = ImGui::GetIO();
   ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
               1000.0F / io.Framerate, io.Framerate);
+
+  ImGui::Checkbox("Frustum culling", renderer_->frustum_culling());
+  ImGui::Checkbox("Patch culling", renderer_->patch_culling());
+  const RenderStats& stats = renderer_->stats();
+  ImGui::Text("Objects drawn %d, culled %d", stats.objects, stats.culled);
+  ImGui::Text("Triangles generated %llu",
+              static_cast<unsigned long long>(stats.triangles));
+  if (stats.patch_stats) {
+    ImGui::Text("Patches culled %u of %u (%.1f%%)", stats.patches_culled,
+                stats.patches,
+                stats.patches > 0
+                    ? 100.0 * stats.patches_culled / stats.patches
+                    : 0.0);
+  } else {
+    ImGui::Text("Patches culled: unavailable");
+  }
+  ImGui::Text("Draws %d, commands %d (%d instances)", stats.draws,
+              stats.commands, stats.instances);
+  ImGui::Text("State changes: programs %d, textures %d", stats.programs,
+              stats.textures);
+  ImGui::Text("patch sizes %d, VAOs %d", stats.patch_sizes, stats.vaos);
+  ImGui::Text("Submit %.3f ms", stats.submit_ms);
+
+  if (ImGui::CollapsingHeader("Profiler")) {
+    const Profiler& profiler = Profiler::Instance();
+    const Profiler::Summary frame = profiler.FrameSummary();
+    ImGui::Text("Frame %.3f ms (p95 %.3f, p99 %.3f)", frame.average_ms,
+                frame.p95_ms, frame.p99_ms);
+    ImGui::Text("CPU (when they run)");
+    for (const auto& [name, s] : profiler.CpuSummaries()) {
+      ImGui::BulletText("%s %.3f ms (p95 %.3f, p99 %.3f)", name.c_str(),
+                        s.average_ms, s.p95_ms, s.p99_ms);
+    }
+    ImGui::Text("GPU");
+    for (const auto& [name, s] : profiler.GpuSummaries()) {
+      ImGui::BulletText("%s %.3f ms (p95 %.3f, p99 %.3f)", name.c_str(),
+                        s.average_ms, s.p95_ms, s.p99_ms);
+    }
+    if (ImGui::Button("Export Chrome trace")) {
+      profiler.ExportChromeTrace("trace.json");
+    }
+  }
   ImGui::End();
 }
 
@@ -562,20 +750,127 @@ void Application::DrawImGuiLayer() {
   DrawViewport();
 
   ImGui::PopStyleVar();  // frame rounding
+
+  ScopedTimer timer("imgui");
+  Profiler::Instance().BeginGpu("imgui");
   ImGui::Render();
   ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+  Profiler::Instance().EndGpu();
+}
+
+void Application::RunHeadless() {
+  const HeadlessOptions& options = *headless_;
+  Scene* scene = scenes_[current_scene_index_];
+
+  // the first frame is the complete scene, with all its textures
+  LOG_INFO("loading the scene {}", scene->name());
+  while (!scene_loader_->IsLoaded(scene) || TextureManager::Instance().Busy()) {
+    if (scene_loader_->IsFailed(scene)) {
+      LOG_ERROR("the scene {} failed to load", scene->name());
+      throw MeshImportException();
+    }
+    scene_loader_->Update();
+    TextureManager::Instance().Update();
+    std::this_thread::sleep_for(1ms);
+  }
+
+  const CameraPath path = options.camera_path.empty()
+                              ? CameraPath::Orbit(15.0F, 5.0F, 4)
+                              : CameraPath::Load(options.camera_path);
+  renderer_->ResizeTarget(options.width, options.height);
+  main_camera_.projection_matrix(30.0F, static_cast<float>(options.width),
+                                 static_cast<float>(options.height), 0.1F,
+                                 10000);
+  *renderer_->tess_level() =
+      std::clamp(options.tessellation_level, 1, renderer_->max_tessel_level());
+  *renderer_->adaptive_tessellation() = options.adaptive_tessellation;
+  if (!options.merge_buffers.empty()) {
+    for (IRenderableObject* object : scene->objects()) {
+      StaticModel* model = dynamic_cast<StaticModel*>(object);
+      if (model != nullptr) {
+        model->merge_buffers(options.merge_buffers == "on");
+      }
+    }
+  }
+
+  if (!options.output.empty()) {
+    std::filesystem::create_directories(options.output);
+  }
+  std::vector<unsigned char> pixels;
+  char file_name[32];
+
+  LOG_INFO("rendering {} frames at {}x{}", options.frames, options.width,
+           options.height);
+  // the CPU side of the draws, summed over the frames
+  double submit_ms = 0.0;
+  long long draws = 0;
+  long long commands = 0;
+  const std::chrono::time_point<hr_clock> begin_time = hr_clock::now();
+  for (int frame = 0; frame < options.frames; frame++) {
+    Profiler::Instance().BeginFrame();
+    path.Apply(frame, options.frames, &main_camera_);
+    renderer_->Render(*scene, main_camera_);
+    const RenderStats& stats = renderer_->stats();
+    submit_ms += stats.submit_ms;
+    draws += stats.draws;
+    commands += stats.commands;
+    // the frame time is the whole frame, not just the commands sent
+    glFinish();
+    if (!options.output.empty()) {
+      renderer_->target().ReadPixels(&pixels);
+      std::snprintf(file_name, sizeof(file_name), "frame_%05d.png", frame);
+      if (!WritePng(options.output / file_name, options.width, options.height,
+                    pixels)) {
+        throw std::runtime_error("can't write the frames to " +
+                                 options.output.string());
+      }
+    }
+    Profiler::Instance().EndFrame();
+  }
+  const std::chrono::duration<double, std::milli> total =
+      hr_clock::now() - begin_time;
+
+  const Profiler::Summary summary = Profiler::Instance().FrameSummary();
+  LOG_INFO("{} frames in {:.1f} ms: {:.3f} ms/frame ({:.1f} FPS), p95 {:.3f} "
+           "ms, p99 {:.3f} ms (of the last {})",
+           options.frames, total.count(), total.count() / options.frames,
+           1000.0 * options.frames / total.count(), summary.p95_ms,
+           summary.p99_ms, Profiler::kHistory);
+  LOG_INFO("RenderQueue::Submit {:.4f} ms/frame, {:.1f} draws and {:.1f} "
+           "commands per frame",
+           submit_ms / options.frames,
+           static_cast<double>(draws) / options.frames,
+           static_cast<double>(commands) / options.frames);
+  for (const auto& [name, stage] : Profiler::Instance().GpuSummaries()) {
+    LOG_INFO("GPU {}: {:.3f} ms/frame, p95 {:.3f} ms", name, stage.average_ms,
+             stage.p95_ms);
+  }
+  if (!options.output.empty()) {
+    Profiler::Instance().ExportChromeTrace(options.output / "trace.json");
+  }
 }
 
 void Application::Run() {
+  if (headless_) {
+    RunHeadless();
+    return;
+  }
+
   double xpos, ypos;
 
   std::chrono::duration<float, std::chrono::seconds::period> delta_time{16ms};
   std::chrono::time_point<hr_clock> begin_time = hr_clock::now();
 
   while (!glfwWindowShouldClose(window_)) {
+    Profiler::Instance().BeginFrame();
+
     // Poll for and process events
     glfwPollEvents();
 
+    // makes the objects of a scene whose models have been read
+    scene_loader_->Update();
+    TextureManager::Instance().Update();
+
     if (app_state_ == APP_STATE::VIEWPORT_FOCUS) {
       glfwGetCursorPos(window_, &xpos, &ypos);
       CameraControl(xpos, ypos, delta_time.count());
@@ -585,6 +880,7 @@ void Application::Run() {
 
     // Swap front and back buffers
     glfwSwapBuffers(window_);
+    Profiler::Instance().EndFrame();
 
     std::chrono::time_point<hr_clock> end_time = hr_clock::now();
     delta_time = std::chrono::duration_cast<clock_ms>(end_time - begin_time);
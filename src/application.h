@@ -1,6 +1,7 @@
 #ifndef APPLICATION_H
 #define APPLICATION_H
 
+#include <optional>
 #include <vector>
 #include <string>
 
@@ -13,9 +14,11 @@
 
 #include "renderer.h"
 #include "scene.h"
+#include "scene_loader.h"
 #include "camera.h"
 #include "shader.h"
 #include "framebuffer.h"
+#include "headless.h"
 #include "logger.h"
 
 enum class APP_STATE {
@@ -39,6 +42,9 @@ class Application {
   static Renderer& GetRenderer();
   static APP_STATE GetAppState();
   static void SetAppState(const APP_STATE to_add);
+  // renders without window (see RunHeadless()), it must be called before the
+  // first Instance()
+  static void SetHeadless(const HeadlessOptions& options);
   void Run();
 
  private:
@@ -50,6 +56,10 @@ class Application {
   void CameraControl(const double xpos, const double ypos,
                      const float delta_time);
 
+  // waits for the scene, renders the frames along the camera path and logs
+  // the frame times
+  void RunHeadless();
+
   void DrawImGuiLayer();
   void DrawControls();
   void DrawViewport();
@@ -66,8 +76,12 @@ class Application {
     }
   };
 
+  inline static std::optional<HeadlessOptions> headless_;
+
   Props properties_;
+  // nullptr in headless mode, headless_context_ is used instead
   GLFWwindow* window_;
+  HeadlessContext* headless_context_;
   bool vsync_;
 
   // for mouse toggle
@@ -77,6 +91,8 @@ class Application {
   Camera main_camera_;
   Renderer* renderer_;
   std::vector<Scene*> scenes_;
+  // fills scenes_ in the background
+  SceneLoader* scene_loader_;
   int number_of_scenes_;
   int current_scene_index_;
   int selected_obj_index_;
@@ -0,0 +1,135 @@
+#include "bounds.h"
+
+#include <algorithm>
+#include <cmath>
+
+bool BoundingVolume::empty() const {
+  return radius < 0.0F;
+}
+
+BoundingVolume BoundingVolume::FromVertices(
+    const std::vector<Vertex*>& vertices) {
+  BoundingVolume out;
+  if (vertices.empty()) {
+    return out;
+  }
+
+  glm::vec3 min = vertices[0]->position;
+  glm::vec3 max = vertices[0]->position;
+  for (const Vertex* v : vertices) {
+    min = glm::min(min, v->position);
+    max = glm::max(max, v->position);
+  }
+  out.center = (min + max) * 0.5F;
+  out.extent = (max - min) * 0.5F;
+
+  float radius2 = 0.0F;
+  for (const Vertex* v : vertices) {
+    const glm::vec3 d = v->position - out.center;
+    radius2 = std::max(radius2, glm::dot(d, d));
+  }
+  out.radius = std::sqrt(radius2);
+  return out;
+}
+
+BoundingVolume BoundingVolume::Merge(const BoundingVolume& other) const {
+  if (empty()) {
+    return other;
+  }
+  if (other.empty()) {
+    return *this;
+  }
+
+  const glm::vec3 min = glm::min(center - extent, other.center - other.extent);
+  const glm::vec3 max = glm::max(center + extent, other.center + other.extent);
+  BoundingVolume out;
+  out.center = (min + max) * 0.5F;
+  out.extent = (max - min) * 0.5F;
+  // the spheres moved to the new center, still conservative
+  out.radius = std::max(glm::length(center - out.center) + radius,
+                        glm::length(other.center - out.center) + other.radius);
+  out.patch_radius = std::max(patch_radius, other.patch_radius);
+  return out;
+}
+
+BoundingVolume BoundingVolume::Transformed(const glm::mat4& matrix) const {
+  if (empty()) {
+    return *this;
+  }
+
+  BoundingVolume out;
+  out.center = glm::vec3(matrix * glm::vec4(center, 1.0F));
+  // https://www.realtimerendering.com/resources/GraphicsGems/gems/TransBox.c
+  // (Arvo) with the box stored as center and extent
+  float max_scale2 = 0.0F;
+  out.extent = glm::vec3(0.0F);
+  for (int j = 0; j < 3; j++) {
+    const glm::vec3 column = glm::vec3(matrix[j]);
+    out.extent += glm::abs(column) * extent[j];
+    max_scale2 = std::max(max_scale2, glm::dot(column, column));
+  }
+  out.radius = radius * std::sqrt(max_scale2);
+  out.patch_radius = patch_radius * std::sqrt(max_scale2);
+  return out;
+}
+
+Frustum::Frustum(const glm::mat4& view_projection) {
+  // glm is column major, m[column][row]
+  const glm::mat4& m = view_projection;
+  const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+  const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+  const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+  const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+  planes_[0] = row3 + row0;  // left
+  planes_[1] = row3 - row0;  // right
+  planes_[2] = row3 + row1;  // bottom
+  planes_[3] = row3 - row1;  // top
+  planes_[4] = row3 + row2;  // near
+  planes_[5] = row3 - row2;  // far
+  for (glm::vec4& plane : planes_) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+}
+
+void Frustum::Test(const std::vector<BoundingVolume>& volumes,
+                   std::vector<uint8_t>* visible) const {
+  visible->resize(volumes.size());
+
+  constexpr std::size_t kBatch = 64;
+  float cx[kBatch], cy[kBatch], cz[kBatch];
+  float ex[kBatch], ey[kBatch], ez[kBatch];
+  float radius[kBatch];
+  uint8_t outside[kBatch];
+
+  for (std::size_t first = 0; first < volumes.size(); first += kBatch) {
+    const std::size_t n = std::min(kBatch, volumes.size() - first);
+    for (std::size_t i = 0; i < n; i++) {
+      const BoundingVolume& v = volumes[first + i];
+      cx[i] = v.center.x;
+      cy[i] = v.center.y;
+      cz[i] = v.center.z;
+      ex[i] = v.extent.x;
+      ey[i] = v.extent.y;
+      ez[i] = v.extent.z;
+      radius[i] = v.radius;
+      outside[i] = v.empty() ? 1 : 0;
+    }
+
+    for (const glm::vec4& p : planes_) {
+      const glm::vec3 abs_normal = glm::abs(glm::vec3(p));
+      // no branches and no dependency between the iterations
+      for (std::size_t i = 0; i < n; i++) {
+        const float distance = p.x * cx[i] + p.y * cy[i] + p.z * cz[i] + p.w;
+        const float box_radius =
+            abs_normal.x * ex[i] + abs_normal.y * ey[i] + abs_normal.z * ez[i];
+        const float r = std::min(box_radius, radius[i]);
+        outside[i] |= static_cast<uint8_t>(distance < -r);
+      }
+    }
+
+    for (std::size_t i = 0; i < n; i++) {
+      (*visible)[first + i] = outside[i] == 0 ? 1 : 0;
+    }
+  }
+}
@@ -0,0 +1,53 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "./mesh/vertex.h"
+
+// Axis aligned box and sphere around the same center: the box is tighter for
+// long thin meshes, the sphere for round ones and for rotated boxes, the
+// frustum test uses whichever is smaller on each plane
+struct BoundingVolume {
+  glm::vec3 center = glm::vec3(0.0F);
+  // half the size of the box on each axis
+  glm::vec3 extent = glm::vec3(-1.0F);
+  float radius = -1.0F;
+  // the largest radius of its triangles around their center, phong
+  // tessellation bulges them by up to alpha times twice that (the same margin
+  // as the control shaders). 0 without triangles, the quads aren't bulged
+  float patch_radius = 0.0F;
+
+  // nothing is inside an empty volume (the default one)
+  [[nodiscard]] bool empty() const;
+
+  [[nodiscard]] static BoundingVolume FromVertices(
+      const std::vector<Vertex*>& vertices);
+  // a volume containing both
+  [[nodiscard]] BoundingVolume Merge(const BoundingVolume& other) const;
+  // the box of the transformed box (still axis aligned, so it grows with the
+  // rotations) and the transformed sphere
+  [[nodiscard]] BoundingVolume Transformed(const glm::mat4& matrix) const;
+};
+
+// the 6 planes of a view frustum, pointing inside
+class Frustum {
+ public:
+  // the planes are extracted from the rows of projection * view (Gribb and
+  // Hartmann), in world space
+  explicit Frustum(const glm::mat4& view_projection);
+
+  // visible[i] = volumes[i] is not completely outside one of the planes. The
+  // volumes are tested in batches with a structure of arrays layout so the
+  // compiler vectorizes the loops over them
+  void Test(const std::vector<BoundingVolume>& volumes,
+            std::vector<uint8_t>* visible) const;
+
+ private:
+  glm::vec4 planes_[6];
+};
+
+#endif  // BOUNDS_H
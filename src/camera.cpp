@@ -1,5 +1,6 @@
 #include "camera.h"
 
+#include <cmath>
 #include <iostream>
 
 #define GLM_FORCE_RADIANS
@@ -77,6 +78,13 @@ const glm::vec3& Camera::up() const {
   return up_;
 }
 
+void Camera::LookAt(const glm::vec3& position, const glm::vec3& target) {
+  const glm::vec3 direction = glm::normalize(target - position);
+  yaw_deg_ = glm::degrees(std::atan2(direction.z, direction.x));
+  pitch_deg_ = glm::degrees(std::asin(direction.y));
+  SetCameraView(position, target, glm::vec3(0.0F, 1.0F, 0.0F));
+}
+
 void Camera::Move(const CameraMovements movement, const float timestep) {
   glm::vec3 tmp, new_position;
   const float camera_speed = movement_speed_ * timestep;
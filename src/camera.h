@@ -68,6 +68,10 @@ class Camera {
   float* sensitivity();
   void sensitivity(const float sensitivity);
 
+  // moves the camera to position looking at target (the yaw and the pitch
+  // follow, so the mouse keeps rotating from there)
+  void LookAt(const glm::vec3& position, const glm::vec3& target);
+
   void Move(const CameraMovements movement, const float timestep);
   // the timestep is not needed because of how the rotation is calculated (glfw
   // mouse offset)
@@ -1,5 +1,6 @@
 #include "framebuffer.h"
 
+#include <algorithm>
 #include <iostream>
 
 #include <GL/glew.h>
@@ -45,6 +46,25 @@ glm::vec2 FrameBuffer::size_vector() const {
   return {width_, height_};
 }
 
+void FrameBuffer::ReadPixels(std::vector<unsigned char>* out) const {
+  const std::size_t row = static_cast<std::size_t>(width_) * 4;
+  out->resize(row * height_);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, out->data());
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  // OpenGL starts from the bottom row
+  std::vector<unsigned char> swap(row);
+  for (int y = 0; y < height_ / 2; y++) {
+    unsigned char* top = out->data() + row * y;
+    unsigned char* bottom = out->data() + row * (height_ - 1 - y);
+    std::copy(top, top + row, swap.data());
+    std::copy(bottom, bottom + row, top);
+    std::copy(swap.data(), swap.data() + row, bottom);
+  }
+}
+
 void FrameBuffer::Check() const {
   glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
 
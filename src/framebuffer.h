@@ -1,6 +1,8 @@
 #ifndef FRAMEBUFFER_H
 #define FRAMEBUFFER_H
 
+#include <vector>
+
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
@@ -31,6 +33,9 @@ class FrameBuffer {
    */
   GLuint color_attachment_id() const;
   glm::vec2 size_vector() const;
+  // the RGBA8 pixels of the color attachment, top row first (as the image
+  // files want them)
+  void ReadPixels(std::vector<unsigned char>* out) const;
 
   void Resize(const int new_width, const int new_height);
 
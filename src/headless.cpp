@@ -0,0 +1,235 @@
+#include "headless.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <EGL/eglext.h>
+#endif  // __linux__
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include "logger.h"
+#include "utilities.h"
+
+namespace {
+
+int ParseInt(const std::string& name, const char* value) {
+  char* end = nullptr;
+  const long parsed = std::strtol(value, &end, 10);
+  if (end == value || *end != '\0' || parsed <= 0) {
+    throw std::invalid_argument(name + " wants a positive integer");
+  }
+  return static_cast<int>(parsed);
+}
+
+}  // namespace
+
+bool ParseHeadlessOptions(const int argc, char* argv[], HeadlessOptions* out) {
+  bool headless = false;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--headless") {
+      headless = true;
+      continue;
+    }
+    if (arg == "--adaptive") {
+      out->adaptive_tessellation = true;
+      continue;
+    }
+
+    // the rest have a value
+    if (i + 1 >= argc) {
+      throw std::invalid_argument("missing value or unknown argument " + arg);
+    }
+    const char* value = argv[++i];
+    if (arg == "--scene") {
+      out->scene = value;
+    } else if (arg == "--frames") {
+      out->frames = ParseInt(arg, value);
+    } else if (arg == "--width") {
+      out->width = ParseInt(arg, value);
+    } else if (arg == "--height") {
+      out->height = ParseInt(arg, value);
+    } else if (arg == "--output") {
+      out->output = value;
+    } else if (arg == "--camera-path") {
+      out->camera_path = value;
+    } else if (arg == "--tessellation") {
+      out->tessellation_level = ParseInt(arg, value);
+    } else if (arg == "--merge-buffers") {
+      out->merge_buffers = value;
+      if (out->merge_buffers != "on" && out->merge_buffers != "off") {
+        throw std::invalid_argument(arg + " wants on or off");
+      }
+    } else {
+      throw std::invalid_argument("unknown argument " + arg);
+    }
+  }
+  return headless;
+}
+
+#ifdef __linux__
+
+HeadlessContext::HeadlessContext() {
+  LOG_TRACE("HeadlessContext()");
+
+  // the surfaceless platform needs no display server at all, the default
+  // display is the fallback (EGL_PLATFORM picks it on Mesa)
+  const auto get_platform_display =
+      reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+          eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  if (get_platform_display != nullptr) {
+    display_ = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                    EGL_DEFAULT_DISPLAY, nullptr);
+  }
+  EGLint major = 0;
+  EGLint minor = 0;
+  if (display_ == EGL_NO_DISPLAY || !eglInitialize(display_, &major, &minor)) {
+    display_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display_ == EGL_NO_DISPLAY ||
+        !eglInitialize(display_, &major, &minor)) {
+      LOG_ERROR("EGL Init fail");
+      throw AppInitException();
+    }
+  }
+  LOG_INFO("Initialized EGL {}.{} ({})", major, minor,
+           eglQueryString(display_, EGL_VENDOR));
+
+  const EGLint config_attributes[] = {EGL_SURFACE_TYPE,
+                                      EGL_PBUFFER_BIT,
+                                      EGL_RENDERABLE_TYPE,
+                                      EGL_OPENGL_BIT,
+                                      EGL_RED_SIZE,
+                                      8,
+                                      EGL_GREEN_SIZE,
+                                      8,
+                                      EGL_BLUE_SIZE,
+                                      8,
+                                      EGL_ALPHA_SIZE,
+                                      8,
+                                      EGL_NONE};
+  EGLConfig config = nullptr;
+  EGLint num_configs = 0;
+  if (!eglChooseConfig(display_, config_attributes, &config, 1,
+                       &num_configs) ||
+      num_configs == 0 || !eglBindAPI(EGL_OPENGL_API)) {
+    LOG_ERROR("no EGL config for an OpenGL pbuffer");
+    eglTerminate(display_);
+    throw AppInitException();
+  }
+
+  const EGLint surface_attributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+  surface_ = eglCreatePbufferSurface(display_, config, surface_attributes);
+
+  // the same version as the window context
+  const EGLint context_attributes[] = {EGL_CONTEXT_MAJOR_VERSION_KHR,
+                                       4,
+                                       EGL_CONTEXT_MINOR_VERSION_KHR,
+                                       2,
+                                       EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR,
+                                       EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+                                       EGL_NONE};
+  context_ = eglCreateContext(display_, config, EGL_NO_CONTEXT,
+                              context_attributes);
+  if (surface_ == EGL_NO_SURFACE || context_ == EGL_NO_CONTEXT ||
+      !eglMakeCurrent(display_, surface_, surface_, context_)) {
+    LOG_ERROR("EGL context creation fail (0x{:x})", eglGetError());
+    eglTerminate(display_);
+    throw AppInitException();
+  }
+  LOG_INFO("Created the headless OpenGL context");
+}
+
+HeadlessContext::~HeadlessContext() {
+  LOG_TRACE("~HeadlessContext()");
+  eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  eglDestroyContext(display_, context_);
+  eglDestroySurface(display_, surface_);
+  eglTerminate(display_);
+}
+
+#else
+
+HeadlessContext::HeadlessContext() {
+  LOG_ERROR("the headless mode needs EGL, it's only available on Linux");
+  throw AppInitException();
+}
+
+HeadlessContext::~HeadlessContext() = default;
+
+#endif  // __linux__
+
+CameraPath CameraPath::Load(const std::filesystem::path& path) {
+  std::ifstream file(path);
+  if (!file) {
+    LOG_ERROR("can't open the camera path {}", path.string());
+    throw FileNotFoundException();
+  }
+
+  CameraPath out;
+  std::string line;
+  int line_number = 0;
+  while (std::getline(file, line)) {
+    line_number++;
+    line = line.substr(0, line.find('#'));
+    std::istringstream fields(line);
+    Key key;
+    if (!(fields >> key.position.x)) {
+      continue;  // empty line
+    }
+    if (!(fields >> key.position.y >> key.position.z >> key.target.x >>
+          key.target.y >> key.target.z)) {
+      throw std::invalid_argument(path.string() + ":" +
+                                  std::to_string(line_number) +
+                                  " wants px py pz tx ty tz");
+    }
+    out.keys_.push_back(key);
+  }
+  if (out.keys_.empty()) {
+    throw std::invalid_argument(path.string() + " has no camera keys");
+  }
+  return out;
+}
+
+CameraPath CameraPath::Orbit(const float radius, const float height,
+                             const int keys) {
+  CameraPath out;
+  // the last key is the first one, the orbit is closed
+  for (int i = 0; i <= keys; i++) {
+    const float angle = 2.0F * 3.14159265F * static_cast<float>(i) / keys;
+    out.keys_.push_back({glm::vec3(radius * std::cos(angle), height,
+                                   radius * std::sin(angle)),
+                         glm::vec3(0.0F)});
+  }
+  return out;
+}
+
+void CameraPath::Apply(const int frame, const int frames,
+                       Camera* camera) const {
+  if (keys_.size() == 1 || frames <= 1) {
+    camera->LookAt(keys_[0].position, keys_[0].target);
+    return;
+  }
+
+  const float t = static_cast<float>(frame) / (frames - 1) *
+                  static_cast<float>(keys_.size() - 1);
+  const std::size_t i = std::min(static_cast<std::size_t>(t), keys_.size() - 2);
+  const float f = t - static_cast<float>(i);
+  camera->LookAt(glm::mix(keys_[i].position, keys_[i + 1].position, f),
+                 glm::mix(keys_[i].target, keys_[i + 1].target, f));
+}
+
+bool WritePng(const std::filesystem::path& path, const int width,
+              const int height, const std::vector<unsigned char>& pixels) {
+  if (stbi_write_png(path.string().c_str(), width, height, 4, pixels.data(),
+                     width * 4) == 0) {
+    LOG_ERROR("can't write {}", path.string());
+    return false;
+  }
+  return true;
+}
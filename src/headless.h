@@ -0,0 +1,88 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#endif  // __linux__
+
+#include "camera.h"
+
+// the settings of a run without window (see Application::RunHeadless())
+struct HeadlessOptions {
+  // the scene to render, the first one if empty
+  std::string scene;
+  int frames = 120;
+  int width = 1280;
+  int height = 720;
+  // the frames are written there as frame_00000.png..., nothing is written if
+  // it's empty (for the benchmarks)
+  std::filesystem::path output;
+  // see CameraPath
+  std::filesystem::path camera_path;
+  int tessellation_level = 1;
+  bool adaptive_tessellation = false;
+  // the "Merge buffers" option of the static models, left as the scene sets
+  // it if empty (to compare the draws with and without it)
+  std::string merge_buffers;
+};
+
+// false if there is no --headless in the arguments. Throws
+// std::invalid_argument for the unknown or malformed ones
+bool ParseHeadlessOptions(int argc, char* argv[], HeadlessOptions* out);
+
+// An OpenGL 4.2 core context without any window: EGL with a pbuffer surface
+// (the frames are rendered to the Renderer FrameBuffer anyway), on Mesa's
+// surfaceless platform when there is one, so llvmpipe works on machines
+// without display and GPU. Only available on Linux
+class HeadlessContext {
+ public:
+  // throws AppInitException if the context can't be created
+  HeadlessContext();
+  ~HeadlessContext();
+  HeadlessContext(const HeadlessContext& other) = delete;
+  HeadlessContext& operator=(const HeadlessContext& other) = delete;
+  HeadlessContext(HeadlessContext&& other) = delete;
+  HeadlessContext& operator=(HeadlessContext&& other) = delete;
+
+ private:
+#ifdef __linux__
+  EGLDisplay display_ = EGL_NO_DISPLAY;
+  EGLSurface surface_ = EGL_NO_SURFACE;
+  EGLContext context_ = EGL_NO_CONTEXT;
+#endif  // __linux__
+};
+
+// The camera of a scripted run: a text file with one key per line, the
+// position and the point looked at ("px py pz tx ty tz", # starts a comment).
+// The frames are spread evenly along the path and the camera moves linearly
+// between the keys. Without a file it orbits around the origin
+class CameraPath {
+ public:
+  // throws FileNotFoundException, or std::invalid_argument for a malformed
+  // line
+  static CameraPath Load(const std::filesystem::path& path);
+  static CameraPath Orbit(float radius, float height, int keys);
+
+  // frame goes from 0 to frames - 1
+  void Apply(int frame, int frames, Camera* camera) const;
+
+ private:
+  struct Key {
+    glm::vec3 position;
+    glm::vec3 target;
+  };
+
+  std::vector<Key> keys_;
+};
+
+// the RGBA pixels are top row first. False if the file can't be written
+bool WritePng(const std::filesystem::path& path, int width, int height,
+              const std::vector<unsigned char>& pixels);
+
+#endif  // HEADLESS_H
@@ -1,6 +1,27 @@
+#include <exception>
+#include <stdexcept>
+
 #include "application.h"
+#include "headless.h"
 
 int main(int argc, char* argv[]) {
-  Application::Instance().Run();
+  HeadlessOptions options;
+  try {
+    if (ParseHeadlessOptions(argc, argv, &options)) {
+      Application::SetHeadless(options);
+    }
+  } catch (const std::invalid_argument& e) {
+    LOG_ERROR("{}", e.what());
+    return 1;
+  }
+
+  // the exceptions of the app (see utilities.h) are logged where they're
+  // thrown, a failed headless run must still exit with an error
+  try {
+    Application::Instance().Run();
+  } catch (const std::exception& e) {
+    LOG_ERROR("Tesselatior stopped: {}", e.what());
+    return 1;
+  }
   return 0;
 }
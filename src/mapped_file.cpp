@@ -0,0 +1,107 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "logger.h"
+#include "utilities.h"  // FileNotFoundException
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+    : data_(nullptr), size_(0), file_(nullptr), mapping_(nullptr) {
+  HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  LARGE_INTEGER size;
+  if (file == INVALID_HANDLE_VALUE || GetFileSizeEx(file, &size) == 0) {
+    if (file != INVALID_HANDLE_VALUE) {
+      CloseHandle(file);
+    }
+    LOG_ERROR("File not found: {}", path.string());
+    throw FileNotFoundException();
+  }
+  file_ = file;
+  size_ = static_cast<std::size_t>(size.QuadPart);
+  if (size_ == 0) {
+    return;  // empty files can't be mapped
+  }
+
+  mapping_ = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping_ != nullptr) {
+    data_ = static_cast<const char*>(
+        MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+  }
+  if (data_ == nullptr) {
+    if (mapping_ != nullptr) {
+      CloseHandle(mapping_);
+    }
+    CloseHandle(file);
+    LOG_ERROR("Could not map file: {}", path.string());
+    throw FileNotFoundException();
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_ != nullptr) {
+    CloseHandle(mapping_);
+  }
+  CloseHandle(file_);
+}
+
+#else
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+    : data_(nullptr), size_(0), fd_(-1) {
+  fd_ = open(path.c_str(), O_RDONLY);
+  struct stat info;
+  if (fd_ < 0 || fstat(fd_, &info) != 0) {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+    LOG_ERROR("File not found: {}", path.string());
+    throw FileNotFoundException();
+  }
+  size_ = static_cast<std::size_t>(info.st_size);
+  if (size_ == 0) {
+    return;  // empty files can't be mapped
+  }
+
+  void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+  if (mapped == MAP_FAILED) {
+    close(fd_);
+    LOG_ERROR("Could not map file: {}", path.string());
+    throw FileNotFoundException();
+  }
+  // the whole file is going to be read front to back
+  madvise(mapped, size_, MADV_SEQUENTIAL);
+  data_ = static_cast<const char*>(mapped);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+  close(fd_);
+}
+
+#endif
+
+const char* MappedFile::data() const {
+  return data_;
+}
+
+std::size_t MappedFile::size() const {
+  return size_;
+}
@@ -0,0 +1,35 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <filesystem>
+
+// read only memory mapping of a whole file (mmap on unix-like systems and
+// CreateFileMapping on windows). The pages are loaded by the OS on first
+// access, so parsing straight from data() costs no extra copy.
+// Throws FileNotFoundException if the file can't be opened or mapped
+class MappedFile {
+ public:
+  explicit MappedFile(const std::filesystem::path& path);
+  ~MappedFile();
+
+  MappedFile(const MappedFile& other) = delete;
+  MappedFile& operator=(const MappedFile& other) = delete;
+  MappedFile(MappedFile&& other) = delete;
+  MappedFile& operator=(MappedFile&& other) = delete;
+
+  [[nodiscard]] const char* data() const;
+  [[nodiscard]] std::size_t size() const;
+
+ private:
+  const char* data_;
+  std::size_t size_;
+#ifdef _WIN32
+  void* file_;
+  void* mapping_;
+#else
+  int fd_;
+#endif
+};
+
+#endif  // MAPPED_FILE_H
@@ -23,6 +23,10 @@ void Material::AddTexture(const Texture& to_add) {
   textures_.push_back(to_add);
 }
 
+const std::vector<Texture>& Material::textures() const {
+  return textures_;
+}
+
 void Material::BindTextures() const {
   glBindTexture(GL_TEXTURE_2D, 0);
   for (const Texture& t : textures_) {
@@ -21,6 +21,7 @@ class Material {
   Material& operator=(Material&& other) = default;
 
   void AddTexture(const Texture& to_add);
+  const std::vector<Texture>& textures() const;
 
   /**
    * @brief binds all the textures of the material
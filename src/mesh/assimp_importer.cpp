@@ -4,10 +4,11 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
-#include <map>
+#include <exception>
 
 #include "../logger.h"
 #include "../material.h"
+#include "../parallel.h"
 
 AssimpImporter::AssimpImporter() {
   importer_ = new Assimp::Importer();
@@ -19,7 +20,7 @@ AssimpImporter::~AssimpImporter() {
   delete importer_;
 }
 
-std::vector<IMesh*> AssimpImporter::import(
+std::vector<ImportedMesh> AssimpImporter::read(
     const std::filesystem::path& filepath, const Options& opts) {
   unsigned int flags = 0;
   if (opts.triangulate) {
@@ -46,41 +47,27 @@ std::vector<IMesh*> AssimpImporter::import(
   LOG_INFO("The number of embedded textures in the current file is: {}",
            p_scene->mNumTextures);
 
-  std::vector<IMesh*> out_meshes;
-
-  for (int i = 0; i < p_scene->mNumMeshes; i++) {
-    const aiMesh* pai_mesh = p_scene->mMeshes[i];
-    IMesh* my_mesh;
-
-    const MESH_TYPE current_mesh_type = DetectMeshType(pai_mesh);
-    bool to_do_compute_normals = !pai_mesh->HasNormals();
-
-    HalfEdgeData* curr_hfd = GenerateHalfedgeData(pai_mesh, current_mesh_type);
-
-    // NOTE A mesh has one and only one material
-
-    // NOTE If a material has not been found by Assimp, it loads a
-    // "DefaultMaterial" (with ambient 0, diffuse 0.6 and specular 0.6... and
-    // I think it even changes from format to format, for example a .blend
-    // file has a different default material than a .obj file)
-    const unsigned int material_i = pai_mesh->mMaterialIndex;
-    const aiMaterial* material = p_scene->mMaterials[material_i];
-    LOG_INFO("Processing material: {}", material->GetName().C_Str());
-
-    if (current_mesh_type == MESH_TYPE::TRI) {
-      my_mesh =
-          new TriMesh(curr_hfd, ProcessMaterial(material, p_scene, filepath));
-    } else if (current_mesh_type == MESH_TYPE::QUAD) {
-      my_mesh =
-          new QuadMesh(curr_hfd, ProcessMaterial(material, p_scene, filepath));
-    } else {
-      // TODO mixed meshes
+  // halfedges, normals and texture decoding of every mesh are independent, so
+  // they run in parallel (one task per mesh)
+  std::vector<ImportedMesh> out_meshes(p_scene->mNumMeshes);
+  std::vector<std::exception_ptr> errors(p_scene->mNumMeshes);
+  ParallelFor(
+      0, p_scene->mNumMeshes,
+      [&](const std::size_t i) {
+        try {
+          out_meshes[i] =
+              ReadMesh(p_scene->mMeshes[i], p_scene, filepath, opts);
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+      },
+      1);
+
+  for (const std::exception_ptr& error : errors) {
+    if (error) {
+      DeleteImportedMeshes(out_meshes);
+      std::rethrow_exception(error);
     }
-
-    if (to_do_compute_normals) {
-      my_mesh->ApplySmoothNormals();
-    }
-    out_meshes.push_back(my_mesh);
   }
 
   importer_->FreeScene();  // not really necessary because ReadFile() calls it
@@ -89,6 +76,32 @@ std::vector<IMesh*> AssimpImporter::import(
   // ShaderManager::Instance().GetShader("TriangleShader"));
 }
 
+ImportedMesh AssimpImporter::ReadMesh(const aiMesh* pai_mesh,
+                                      const aiScene* p_scene,
+                                      const std::filesystem::path& filepath,
+                                      const Options& opts) {
+  ImportedMesh out;
+  out.type = DetectMeshType(pai_mesh);
+  out.hf_data =
+      GenerateHalfedgeData(pai_mesh, out.type, opts.weld_vertices);
+
+  // NOTE A mesh has one and only one material
+
+  // NOTE If a material has not been found by Assimp, it loads a
+  // "DefaultMaterial" (with ambient 0, diffuse 0.6 and specular 0.6... and
+  // I think it even changes from format to format, for example a .blend
+  // file has a different default material than a .obj file)
+  const unsigned int material_i = pai_mesh->mMaterialIndex;
+  const aiMaterial* material = p_scene->mMaterials[material_i];
+  LOG_INFO("Processing material: {}", material->GetName().C_Str());
+  out.material = ProcessMaterial(material, p_scene, filepath, &out.textures);
+
+  if (!pai_mesh->HasNormals()) {
+    out.hf_data->ShadeSmooth();
+  }
+  return out;
+}
+
 MESH_TYPE AssimpImporter::DetectMeshType(const aiMesh* pai_mesh) {
   MESH_TYPE current_mesh_type = MESH_TYPE::TRI;
   if (pai_mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE) {
@@ -117,18 +130,13 @@ MESH_TYPE AssimpImporter::DetectMeshType(const aiMesh* pai_mesh) {
 }
 
 HalfEdgeData* AssimpImporter::GenerateHalfedgeData(
-    const aiMesh* pai_mesh, const MESH_TYPE current_mesh_type) {
+    const aiMesh* pai_mesh, const MESH_TYPE current_mesh_type,
+    const bool weld) {
   const aiVector3D zero_3d(0.0F, 0.0F, 0.0F);
   // I only care about the vertices for being contiguous since it is
   // required for OpenGL for rendering
   std::vector<Vertex*>* vertices = new std::vector<Vertex*>();
-  std::vector<HalfEdge*>* halfedges = new std::vector<HalfEdge*>();
-  std::vector<Face*>* faces = new std::vector<Face*>();
-  std::vector<Edge*>* edges = new std::vector<Edge*>();
-
   vertices->reserve(pai_mesh->mNumVertices);
-  halfedges->reserve(to_underlying(current_mesh_type) * pai_mesh->mNumFaces);
-  faces->reserve(pai_mesh->mNumFaces);
 
   const bool has_normals = pai_mesh->HasNormals();
 
@@ -147,81 +155,36 @@ HalfEdgeData* AssimpImporter::GenerateHalfedgeData(
     vertices->push_back(x);
   }
 
-  // edges map
-  std::map<std::pair<unsigned int, unsigned int>, HalfEdge*> edges_m;
+  if (current_mesh_type == MESH_TYPE::POLY && pai_mesh->mNumFaces > 0) {
+    LOG_ERROR("polygon meshes can't be read with Assimp, triangulate them");
+    throw MeshImportException();
+  }
 
+  // the same index buffer layout as the native importers, so the halfedges
+  // are built (and the vertices welded) the same way.
+  // This works because I added the vertices in the same order of Assimp
+  const unsigned int sides = to_underlying(current_mesh_type);
+  std::vector<unsigned int> indices;
+  std::vector<unsigned int> face_starts = {0};
+  indices.reserve(static_cast<std::size_t>(sides) * pai_mesh->mNumFaces);
+  face_starts.reserve(pai_mesh->mNumFaces + 1);
   for (unsigned int j = 0; j < pai_mesh->mNumFaces; j++) {
     const aiFace& ai_face = pai_mesh->mFaces[j];
-
-    std::pair<unsigned int, unsigned int> x;
-    std::pair<unsigned int, unsigned int> s;  // swapped
-    std::vector<unsigned int> current_indices;
-    Face* f = new Face();
-    faces->push_back(f);
-
-    switch (current_mesh_type) {
-      case MESH_TYPE::TRI:
-        current_indices = {0, 1, 2};
-        break;
-      case MESH_TYPE::QUAD:
-        // For some reason the first 2 indices need to be swapped otherwise
-        // the hardware tessellator does not triangulate the quad properly
-        current_indices = {0, 1, 2, 3};
-        break;
-      default:
-        // TODO unsupported polygon type
-        throw;
-        break;
-    }
-
-    HalfEdge* current_hf;
-    std::vector<HalfEdge*> faces_halfedges;
-    for (int k = 0; k < current_indices.size(); k++) {
-      x = {ai_face.mIndices[k],
-           ai_face.mIndices[(k + 1) % to_underlying(current_mesh_type)]};
-      s = {x.second, x.first};
-      current_hf = new HalfEdge(f);
-      faces_halfedges.push_back(current_hf);
-      f->halfedge = current_hf;
-
-      // This works because I added the vertices in the same order of Assimp
-      current_hf->vert = vertices->at(x.second);
-      vertices->at(x.first)->halfedge = current_hf;
-
-      if (edges_m.find(s) != edges_m.end()) {
-        current_hf->twin = edges_m[s];
-        edges_m[s]->twin = current_hf;
-      } else {
-        edges_m[x] = current_hf;
-      }
-
-      halfedges->push_back(current_hf);
-    }
-
-    // setting the next
-    for (int z = 0; z < faces_halfedges.size(); z++) {
-      faces_halfedges[z]->next =
-          faces_halfedges[(z + 1) % faces_halfedges.size()];
+    for (unsigned int k = 0; k < sides; k++) {
+      indices.push_back(ai_face.mIndices[k]);
     }
+    face_starts.push_back(static_cast<unsigned int>(indices.size()));
   }
 
-  edges->reserve(edges_m.size());
-  for (const auto [_, he] : edges_m) {
-    Edge* e = new Edge();
-    e->halfedge = he;
-    he->edge = e;
-    if (!he->IsBoundary()) {
-      he->twin->edge = e;
-    }
-    edges->push_back(e);
+  if (weld) {
+    WeldVertices(vertices, &indices, &face_starts);
   }
-
-  return new HalfEdgeData(vertices, halfedges, faces, edges);
+  return BuildHalfEdgeData(vertices, indices, face_starts);
 }
 
 Material* AssimpImporter::ProcessMaterial(
     const aiMaterial* material, const aiScene* p_scene,
-    const std::filesystem::path filepath) {
+    const std::filesystem::path filepath, std::vector<TextureImage>* textures) {
   Material* x = new Material();
 
   aiColor3D color;
@@ -249,32 +212,21 @@ Material* AssimpImporter::ProcessMaterial(
     x->diffuse_reflectivity(glm::vec3(1.0F, 1.0F, 1.0F));
     if (const auto* _texture =
             p_scene->GetEmbeddedTexture(diffuse_path.C_Str())) {
-      // returned pointer is not null, aka the texture is embedded
-      // the texture is compressed (png, jpeg...), so we load it with stb
-      if (_texture->mHeight == 0) {
-        Texture texture(_texture, TEXTURE_TYPE::DIFFUSE);
-        x->AddTexture(texture);
-      } else {
-        // the texture is not compressed
-        // _texture->mWidth;
-        // _texture->mHeight;
-        // _texture->pcData;
-        LOG_ERROR("Unsupported uncompressed texture");
-        x->AddTexture(Texture(TEXTURE_TYPE::DIFFUSE));
-      }
+      // returned pointer is not null, aka the texture is embedded, either
+      // compressed (png, jpeg...) or as raw texels
+      textures->push_back(DecodeTexture(_texture, TEXTURE_TYPE::DIFFUSE));
     } else {
       // the texture could be an external file, so we try to load it
       std::filesystem::path texture_path = filepath;
       texture_path.replace_filename(diffuse_path.data);
       // if we can't find a texture with this path, then there will still be
       // a texture created automatically with the default "white.png"
-      Texture texture(texture_path, TEXTURE_TYPE::DIFFUSE);
-      x->AddTexture(texture);
+      textures->push_back(DecodeTexture(texture_path, TEXTURE_TYPE::DIFFUSE));
     }
   } else {
     // the default white texture that doesn't influence the base color
     // (because the base color gets multiplied by 1)
-    x->AddTexture(Texture(TEXTURE_TYPE::DIFFUSE));
+    textures->push_back(DecodeDefaultTexture(TEXTURE_TYPE::DIFFUSE));
   }
 
   aiString displacement_path;
@@ -282,19 +234,9 @@ Material* AssimpImporter::ProcessMaterial(
                     displacement_path) == aiReturn_SUCCESS) {
     if (const auto* _texture =
             p_scene->GetEmbeddedTexture(displacement_path.C_Str())) {
-      // returned pointer is not null, aka the texture is embedded
-      // the texture is compressed (png, jpeg...), so we load it with stb
-      if (_texture->mHeight == 0) {
-        Texture texture(_texture, TEXTURE_TYPE::DISPLACEMENT);
-        x->AddTexture(texture);
-      } else {
-        // the texture is not compressed
-        // _texture->mWidth;
-        // _texture->mHeight;
-        // _texture->pcData;
-        LOG_ERROR("Unsupported uncompressed texture");
-        // x.AddTexture(Texture(TEXTURE_TYPE::DISPLACEMENT));
-      }
+      // returned pointer is not null, aka the texture is embedded, either
+      // compressed (png, jpeg...) or as raw texels
+      textures->push_back(DecodeTexture(_texture, TEXTURE_TYPE::DISPLACEMENT));
     } else {
       //! For some reason ASSIMP does NOT find a displacement  texture in a
       //! obj material file (even if it is specified with disp as per
@@ -304,8 +246,8 @@ Material* AssimpImporter::ProcessMaterial(
       texture_path.replace_filename(displacement_path.data);
       // if we can't find a texture with this path, then there will still be
       // a texture created automatically with the default "black.png"
-      Texture texture(texture_path, TEXTURE_TYPE::DISPLACEMENT);
-      x->AddTexture(texture);
+      textures->push_back(
+          DecodeTexture(texture_path, TEXTURE_TYPE::DISPLACEMENT));
     }
   } else {
     // Texture texture(Texture(TEXTURE_TYPE::DISPLACEMENT));
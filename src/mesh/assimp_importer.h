@@ -2,6 +2,7 @@
 #define ASSIMP_IMPORTER_H
 
 #include <filesystem>
+#include <vector>
 
 #include <assimp/Importer.hpp>
 #include <assimp/mesh.h>
@@ -19,16 +20,23 @@ class AssimpImporter : public IImporter {
   AssimpImporter&& operator=(AssimpImporter&& other) = delete;
   ~AssimpImporter();
 
-  std::vector<IMesh*> import(const std::filesystem::path& filepath,
-                             const Options& opts = Options()) override;
+  std::vector<ImportedMesh> read(const std::filesystem::path& filepath,
+                                 const Options& opts = Options()) override;
 
  private:
+  // safe to run concurrently for different meshes of the scene
+  ImportedMesh ReadMesh(const aiMesh* pai_mesh, const aiScene* p_scene,
+                        const std::filesystem::path& filepath,
+                        const Options& opts);
   MESH_TYPE DetectMeshType(const aiMesh* pai_mesh);
   HalfEdgeData* GenerateHalfedgeData(const aiMesh* pai_mesh,
-                                     const MESH_TYPE current_mesh_type);
+                                     const MESH_TYPE current_mesh_type,
+                                     bool weld);
 
+  // the textures are only decoded, they get uploaded by UploadMeshes()
   Material* ProcessMaterial(const aiMaterial* material, const aiScene* p_scene,
-                            const std::filesystem::path filepath);
+                            const std::filesystem::path filepath,
+                            std::vector<TextureImage>* textures);
 
   Assimp::Importer* importer_;
 };
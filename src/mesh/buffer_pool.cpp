@@ -0,0 +1,155 @@
+#include "buffer_pool.h"
+
+#include <algorithm>
+
+#include "../logger.h"
+
+namespace {
+
+// the storage is allocated in steps of this, so sizes a bit apart still fit
+constexpr GLsizeiptr kGranularity = 256;
+
+}  // namespace
+
+BufferPool& BufferPool::Instance() {
+  static BufferPool instance_;
+  return instance_;
+}
+
+bool BufferPool::persistent() const {
+  return GLEW_ARB_buffer_storage;
+}
+
+MeshBuffer BufferPool::Create(const GLsizeiptr capacity) {
+  MeshBuffer buffer;
+  buffer.capacity = capacity;
+  glGenBuffers(1, &buffer.id);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.id);
+  if (persistent()) {
+    const GLbitfield flags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    // dynamic so the fallback of Unmap() can still glBufferSubData() it
+    glBufferStorage(GL_COPY_WRITE_BUFFER, capacity, nullptr,
+                    flags | GL_DYNAMIC_STORAGE_BIT);
+    buffer.mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, capacity, flags);
+    if (buffer.mapped == nullptr) {
+      // Acquire() maps it every time instead
+      LOG_WARN("Could not map the mesh buffer persistently");
+    }
+  } else {
+    glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STATIC_DRAW);
+  }
+  return buffer;
+}
+
+bool BufferPool::Ready(Kept* kept) {
+  if (kept->fence == nullptr) {
+    return true;
+  }
+  // polled, never waited for
+  const GLenum status =
+      glClientWaitSync(kept->fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+  if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+    return false;
+  }
+  glDeleteSync(kept->fence);
+  kept->fence = nullptr;
+  return true;
+}
+
+void BufferPool::Delete(const Kept& kept) {
+  if (kept.fence != nullptr) {
+    glDeleteSync(kept.fence);
+  }
+  // deleting a mapped buffer unmaps it
+  glDeleteBuffers(1, &kept.buffer.id);
+}
+
+MeshBuffer BufferPool::Acquire(const GLsizeiptr size, void** out) {
+  const GLsizeiptr capacity =
+      std::max<GLsizeiptr>(kGranularity,
+                           (size + kGranularity - 1) / kGranularity *
+                               kGranularity);
+
+  // the smallest kept one that fits, if it doesn't waste more than half. The
+  // ones the GPU could still be reading are skipped, a new buffer is better
+  // than waiting for the draws already sent
+  int best = -1;
+  for (int i = 0; i < static_cast<int>(kept_.size()); i++) {
+    const GLsizeiptr kept_capacity = kept_[i].buffer.capacity;
+    if (kept_capacity >= capacity && kept_capacity <= 2 * capacity &&
+        (best == -1 || kept_capacity < kept_[best].buffer.capacity) &&
+        Ready(&kept_[i])) {
+      best = i;
+    }
+  }
+
+  MeshBuffer buffer;
+  if (best != -1) {
+    const Kept kept = kept_[best];
+    kept_.erase(kept_.begin() + best);
+    kept_bytes_ -= kept.buffer.capacity;
+    buffer = kept.buffer;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.id);
+  } else {
+    buffer = Create(capacity);
+  }
+
+  if (buffer.mapped != nullptr) {
+    *out = buffer.mapped;
+    return buffer;
+  }
+  *out = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, buffer.capacity,
+                          GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (*out == nullptr) {
+    LOG_WARN("Could not map the mesh buffer, uploading from a copy");
+    scratch_.resize(buffer.capacity);
+    *out = scratch_.data();
+  }
+  return buffer;
+}
+
+void BufferPool::Unmap(const MeshBuffer& buffer, const GLsizeiptr size) {
+  if (buffer.mapped != nullptr) {
+    // coherent, the writes are seen by the commands sent after them
+    return;
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.id);
+  if (!scratch_.empty()) {
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, size, scratch_.data());
+    scratch_.clear();
+  } else if (glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_FALSE) {
+    LOG_ERROR("the mesh buffer {} was lost while mapped", buffer.id);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void BufferPool::Release(const MeshBuffer& buffer) {
+  if (buffer.id == 0) {
+    return;
+  }
+  if (stop_) {
+    Delete({buffer, nullptr});
+    return;
+  }
+  // the mapped ones are the only ones written without invalidating them
+  const Kept kept = {buffer, buffer.mapped != nullptr
+                                 ? glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)
+                                 : nullptr};
+  kept_.push_back(kept);
+  kept_bytes_ += buffer.capacity;
+  while (kept_bytes_ > kMaxKeptBytes) {
+    kept_bytes_ -= kept_.front().buffer.capacity;
+    Delete(kept_.front());
+    kept_.erase(kept_.begin());
+  }
+}
+
+void BufferPool::Shutdown() {
+  for (const Kept& kept : kept_) {
+    Delete(kept);
+  }
+  kept_.clear();
+  kept_bytes_ = 0;
+  stop_ = true;
+}
@@ -0,0 +1,82 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+// a vertex or index buffer of the meshes, capacity is the size of its storage
+// (at least the size it was asked for)
+struct MeshBuffer {
+  GLuint id = 0;
+  GLsizeiptr capacity = 0;
+  // the persistent mapping, nullptr without ARB_buffer_storage
+  void* mapped = nullptr;
+};
+
+// The storage of the mesh buffers. The meshes write their vertices and indices
+// straight into mapped buffer memory, there is no copy in between:
+// - with ARB_buffer_storage the buffers are immutable (glBufferStorage) and
+//   mapped once, persistent and coherent, for their whole life
+// - otherwise they're mapped with glMapBufferRange for every upload (the old
+//   content is invalidated so nothing waits for the GPU)
+// A released buffer isn't deleted but kept for the next Acquire() of about its
+// size, so a mesh that is subdivided or shaded again reuses the storage of its
+// previous buffers. A kept persistent buffer can still be read by the draws
+// already sent, it's only reused once its fence has signaled (Acquire() never
+// waits, it creates a new buffer instead)
+class BufferPool {
+ public:
+  BufferPool(const BufferPool& other) = delete;
+  BufferPool& operator=(const BufferPool& other) = delete;
+  BufferPool(BufferPool&& other) = delete;
+  BufferPool& operator=(BufferPool&& other) = delete;
+
+  static BufferPool& Instance();
+
+  // a buffer with at least size bytes of storage, *out is where they must be
+  // written before Unmap(). It's bound to GL_COPY_WRITE_BUFFER so the VAO
+  // bindings are left alone
+  MeshBuffer Acquire(GLsizeiptr size, void** out);
+  // the writes of the last Acquire() are done, size is how many bytes were
+  // written
+  void Unmap(const MeshBuffer& buffer, GLsizeiptr size);
+  // the buffer must not be used anymore (it's kept for the next Acquire())
+  void Release(const MeshBuffer& buffer);
+
+  // deletes the kept buffers, it must be called while the OpenGL context
+  // still exists. The buffers released afterwards are deleted right away
+  void Shutdown();
+
+  // true if the buffers are persistently mapped
+  [[nodiscard]] bool persistent() const;
+
+ private:
+  BufferPool() = default;
+  ~BufferPool() = default;
+
+  // the kept buffers can't take more than this, the oldest ones are deleted
+  static constexpr GLsizeiptr kMaxKeptBytes = 256 << 20;
+
+  struct Kept {
+    MeshBuffer buffer;
+    // signaled when the GPU is done with the draws sent before the release
+    GLsync fence;
+  };
+
+  MeshBuffer Create(GLsizeiptr capacity);
+  // true if the GPU is done with the kept buffer, its fence is deleted then
+  static bool Ready(Kept* kept);
+  void Delete(const Kept& kept);
+
+  // oldest first
+  std::vector<Kept> kept_;
+  GLsizeiptr kept_bytes_ = 0;
+  bool stop_ = false;
+  // written by the fallback when the driver can't map a buffer, uploaded by
+  // Unmap()
+  std::vector<unsigned char> scratch_;
+};
+
+#endif  // BUFFER_POOL_H
@@ -0,0 +1,356 @@
+#include "decimation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "../logger.h"
+
+// symmetric 4x4 matrix (only the upper triangle is stored), doubles because
+// the sums over many planes lose too much precision in floats
+struct Quadric {
+  double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+
+  Quadric()
+      : a2(0), ab(0), ac(0), ad(0), b2(0), bc(0), bd(0), c2(0), cd(0), d2(0) {}
+
+  // plane ax + by + cz + d = 0 (with a unit normal) weighted by w
+  Quadric(const glm::dvec3& n, double d, double w)
+      : a2(w * n.x * n.x),
+        ab(w * n.x * n.y),
+        ac(w * n.x * n.z),
+        ad(w * n.x * d),
+        b2(w * n.y * n.y),
+        bc(w * n.y * n.z),
+        bd(w * n.y * d),
+        c2(w * n.z * n.z),
+        cd(w * n.z * d),
+        d2(w * d * d) {}
+
+  Quadric& operator+=(const Quadric& o) {
+    a2 += o.a2;
+    ab += o.ab;
+    ac += o.ac;
+    ad += o.ad;
+    b2 += o.b2;
+    bc += o.bc;
+    bd += o.bd;
+    c2 += o.c2;
+    cd += o.cd;
+    d2 += o.d2;
+    return *this;
+  }
+
+  // v^T Q v
+  [[nodiscard]] double Error(const glm::dvec3& v) const {
+    return a2 * v.x * v.x + 2 * ab * v.x * v.y + 2 * ac * v.x * v.z +
+           2 * ad * v.x + b2 * v.y * v.y + 2 * bc * v.y * v.z + 2 * bd * v.y +
+           c2 * v.z * v.z + 2 * cd * v.z + d2;
+  }
+
+  // the point that minimizes the error, false if the 3x3 system is singular
+  // (flat or cylindrical neighbourhoods) and there is no single minimum
+  bool Minimizer(glm::dvec3* out) const {
+    const double det = a2 * (b2 * c2 - bc * bc) - ab * (ab * c2 - bc * ac) +
+                       ac * (ab * bc - b2 * ac);
+    if (std::abs(det) < 1e-12) {
+      return false;
+    }
+    // Cramer's rule on A x = -b
+    const double bx = -ad;
+    const double by = -bd;
+    const double bz = -cd;
+    out->x = (bx * (b2 * c2 - bc * bc) - ab * (by * c2 - bc * bz) +
+              ac * (by * bc - b2 * bz)) /
+             det;
+    out->y = (a2 * (by * c2 - bz * bc) - bx * (ab * c2 - bc * ac) +
+              ac * (ab * bz - by * ac)) /
+             det;
+    out->z = (a2 * (b2 * bz - bc * by) - ab * (ab * bz - by * ac) +
+              bx * (ab * bc - b2 * ac)) /
+             det;
+    return true;
+  }
+};
+
+// kept small because the queue ends up holding millions of them (most of
+// them stale, it is cheaper than updating entries in place)
+struct Collapse {
+  double cost;
+  HalfEdge* he;  // collapses he->twin->vert into he->vert
+  // the two vertices (by index) and their stamps when the collapse was
+  // computed, if any of the two has been touched since then the entry is stale
+  uint32_t a;
+  uint32_t b;
+  uint32_t stamp_a;
+  uint32_t stamp_b;
+
+  bool operator>(const Collapse& o) const { return cost > o.cost; }
+};
+
+// where the merged vertex goes: the minimizer of q if it exists (and does not
+// shoot far away from the edge) otherwise the best among the endpoints and the
+// midpoint. If b is on the boundary it can't move
+static double Placement(const Quadric& q, const glm::dvec3& pa,
+                        const glm::dvec3& pb, bool b_is_boundary,
+                        glm::dvec3* out) {
+  *out = pb;
+  double best_cost = q.Error(pb);
+  if (b_is_boundary) {
+    return best_cost;
+  }
+
+  glm::dvec3 opt;
+  const double edge_len2 = glm::dot(pb - pa, pb - pa);
+  const glm::dvec3 mid = (pa + pb) * 0.5;
+  if (q.Minimizer(&opt) && glm::dot(opt - mid, opt - mid) < 4 * edge_len2) {
+    *out = opt;
+    return q.Error(opt);
+  }
+  for (const glm::dvec3& p : {pa, mid}) {
+    const double c = q.Error(p);
+    if (c < best_cost) {
+      *out = p;
+      best_cost = c;
+    }
+  }
+  return best_cost;
+}
+
+// true if moving v to new_pos flips (or degenerates) one of the faces around
+// v, the faces in skip are going to be deleted so they are not checked
+static bool FlipsAFace(const Vertex* v, const glm::vec3& new_pos,
+                       const Face* skip_a, const Face* skip_b) {
+  const HalfEdge* start = v->halfedge;
+  const HalfEdge* curr = start;
+  // go back to the first outgoing halfedge so that boundary vertices get
+  // visited entirely too
+  while (!curr->Previous()->IsBoundary() && curr->Previous()->twin != start) {
+    curr = curr->Previous()->twin;
+  }
+  start = curr;
+  do {
+    if (curr->face != skip_a && curr->face != skip_b) {
+      const glm::vec3& p1 = curr->vert->position;
+      const glm::vec3& p2 = curr->next->vert->position;
+      const glm::vec3 before = glm::cross(p1 - v->position, p2 - v->position);
+      const glm::vec3 after = glm::cross(p1 - new_pos, p2 - new_pos);
+      // degenerate or upside down
+      if (glm::dot(after, after) < 1e-20F || glm::dot(before, after) <= 0.0F) {
+        return true;
+      }
+    }
+    if (curr->IsBoundary()) {
+      break;
+    }
+    curr = curr->twin->next;
+  } while (curr != start);
+  return false;
+}
+
+void QEMDecimation::fixed_vertices(const bool enabled) {
+  fixed_vertices_ = enabled;
+}
+
+bool QEMDecimation::fixed_vertices() const {
+  return fixed_vertices_;
+}
+
+int QEMDecimation::Decimate(
+    HalfEdgeData* m, int target_faces,
+    const std::function<void(const HalfEdge*)>& on_collapse) const {
+  if (!m->IsValidType(MESH_TYPE::TRI)) {
+    throw std::invalid_argument("QEM decimation only supports triangle meshes");
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+
+  std::vector<Vertex*>& verts = *m->vertices();
+  std::unordered_map<const Vertex*, std::size_t> index;
+  index.reserve(verts.size());
+  for (std::size_t i = 0; i < verts.size(); i++) {
+    index[verts[i]] = i;
+  }
+
+  std::vector<Quadric> quadrics(verts.size());
+  std::vector<uint32_t> stamps(verts.size(), 0);
+  std::vector<char> boundary(verts.size(), 0);
+  for (const HalfEdge* he : *m->half_edges()) {
+    if (he->IsBoundary()) {
+      boundary[index[he->vert]] = 1;
+      boundary[index[he->Previous()->vert]] = 1;
+    }
+  }
+
+  // every face adds its (area weighted) plane to its three vertices
+  for (const Face* f : *m->faces()) {
+    const HalfEdge* he = f->halfedge;
+    const glm::dvec3 p0(he->vert->position);
+    const glm::dvec3 p1(he->next->vert->position);
+    const glm::dvec3 p2(he->next->next->vert->position);
+    const glm::dvec3 n = glm::cross(p1 - p0, p2 - p0);
+    const double len = glm::length(n);
+    if (len == 0.0) {
+      continue;
+    }
+    const glm::dvec3 unit_n = n / len;
+    const Quadric q(unit_n, -glm::dot(unit_n, p0), len * 0.5);
+    for (int k = 0; k < 3; k++) {
+      quadrics[index[he->vert]] += q;
+      he = he->next;
+    }
+  }
+
+  std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> queue;
+
+  // pushes the cheapest valid direction for the edge of he (if any)
+  auto push_edge = [&](HalfEdge* he) {
+    if (he->IsBoundary()) {
+      return;  // boundary edges are kept as they are
+    }
+    std::size_t from = index[he->twin->vert];
+    std::size_t to = index[he->vert];
+    if (boundary[from]) {
+      if (boundary[to]) {
+        return;
+      }
+      // the removed vertex must be the interior one
+      he = he->twin;
+      std::swap(from, to);
+    }
+
+    Quadric q = quadrics[from];
+    q += quadrics[to];
+    const glm::dvec3 pa(he->twin->vert->position);
+    const glm::dvec3 pb(he->vert->position);
+    double cost = 0.0;
+    if (fixed_vertices_) {
+      cost = q.Error(pb);
+      // both directions are legal when both are interior, keep the cheaper
+      if (!boundary[to] && q.Error(pa) < cost) {
+        cost = q.Error(pa);
+        he = he->twin;
+        std::swap(from, to);
+      }
+    } else {
+      glm::dvec3 position;
+      cost = Placement(q, pa, pb, boundary[to], &position);
+    }
+
+    queue.push({cost, he, static_cast<uint32_t>(from),
+                static_cast<uint32_t>(to), stamps[from], stamps[to]});
+  };
+
+  for (const Edge* e : *m->edges()) {
+    push_edge(e->halfedge);
+  }
+
+  int live_faces = static_cast<int>(m->faces()->size());
+  int collapses = 0;
+  while (live_faces > target_faces && !queue.empty()) {
+    const Collapse c = queue.top();
+    queue.pop();
+
+    if (stamps[c.a] != c.stamp_a || stamps[c.b] != c.stamp_b) {
+      continue;  // stale
+    }
+    HalfEdge* he = c.he;
+    if (he->face == nullptr || he->twin == nullptr) {
+      continue;  // deleted
+    }
+    Vertex* va = verts[c.a];
+    Vertex* vb = verts[c.b];
+    if (he->twin->vert != va || he->vert != vb) {
+      continue;  // not the same edge anymore
+    }
+
+    Quadric q = quadrics[c.a];
+    q += quadrics[c.b];
+    glm::vec3 position = vb->position;
+    if (!fixed_vertices_) {
+      glm::dvec3 dposition;
+      Placement(q, glm::dvec3(va->position), glm::dvec3(vb->position),
+                boundary[c.b], &dposition);
+      position = glm::vec3(dposition);
+    }
+
+    if (!m->CanCollapse(he) ||
+        FlipsAFace(va, position, he->face, he->twin->face) ||
+        FlipsAFace(vb, position, he->face, he->twin->face)) {
+      continue;
+    }
+
+    if (!fixed_vertices_) {
+      // interpolate the attributes along the edge where the new position
+      // projects onto it
+      const glm::vec3 ab = vb->position - va->position;
+      const float t = glm::clamp(
+          glm::dot(position - va->position, ab) / glm::dot(ab, ab), 0.0F,
+          1.0F);
+      vb->text_coords = glm::mix(va->text_coords, vb->text_coords, t);
+      vb->normal = glm::mix(va->normal, vb->normal, t);
+      if (glm::dot(vb->normal, vb->normal) > 0.0F) {
+        vb->normal = glm::normalize(vb->normal);
+      }
+    }
+
+    if (on_collapse) {
+      on_collapse(he);
+    }
+    m->Collapse(he);
+    vb->position = position;
+    quadrics[c.b] = q;
+    stamps[c.a]++;
+    stamps[c.b]++;
+    live_faces -= 2;
+    collapses++;
+
+    // all the edges around b changed cost
+    HalfEdge* curr = vb->halfedge;
+    while (!curr->Previous()->IsBoundary() &&
+           curr->Previous()->twin != vb->halfedge) {
+      curr = curr->Previous()->twin;
+    }
+    const HalfEdge* first = curr;
+    do {
+      push_edge(curr);
+      if (curr->IsBoundary()) {
+        break;
+      }
+      curr = curr->twin->next;
+    } while (curr != first);
+  }
+
+  m->RemoveDeleted();
+
+  const auto end = std::chrono::steady_clock::now();
+  LOG_INFO("QEM decimation: {} collapses, {} faces left, took {:.3f} ms",
+           collapses, m->faces()->size(),
+           std::chrono::duration<double, std::milli>(end - start).count());
+  return collapses;
+}
+
+TriMesh* QEMDecimation::decimate(TriMesh* in, int target_faces) const {
+  HalfEdgeData* decimated = new HalfEdgeData(*in->half_edge_data());
+  Decimate(decimated, target_faces);
+  return new TriMesh(decimated, in->material());
+}
+
+std::vector<TriMesh*> QEMDecimation::GenerateLODChain(
+    TriMesh* in, std::vector<int> target_faces) const {
+  std::sort(target_faces.begin(), target_faces.end(), std::greater<>());
+
+  std::vector<TriMesh*> lods;
+  lods.reserve(target_faces.size());
+  HalfEdgeData work(*in->half_edge_data());
+  for (const int target : target_faces) {
+    Decimate(&work, target);
+    lods.push_back(new TriMesh(new HalfEdgeData(work),
+                               in->material()));
+  }
+  return lods;
+}
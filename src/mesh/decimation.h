@@ -0,0 +1,45 @@
+#ifndef DECIMATION_H
+#define DECIMATION_H
+
+#include <functional>
+#include <vector>
+
+#include "mesh.h"
+
+// Quadric error metric edge collapse decimation
+// https://www.cs.cmu.edu/~garland/Papers/quadrics.pdf
+// Only triangle meshes are supported. Boundary vertices are never removed, so
+// open borders keep their exact shape. UV seams come out of the importer as
+// boundaries (the vertices are split there) so they are preserved as well.
+class QEMDecimation {
+ public:
+  // collapses edges of m in order of increasing quadric error until it has at
+  // most target_faces faces (or no valid collapse is left), dead elements are
+  // removed before returning. Returns the number of collapses done.
+  // on_collapse (if set) is called with each halfedge right before it gets
+  // collapsed, it can be used to record the collapse sequence.
+  // Throws std::invalid_argument if m isn't a triangle mesh
+  int Decimate(
+      HalfEdgeData* m, int target_faces,
+      const std::function<void(const HalfEdge*)>& on_collapse = nullptr) const;
+
+  // returns a new mesh (in is not modified)
+  [[nodiscard]] TriMesh* decimate(TriMesh* in, int target_faces) const;
+
+  // one mesh per target face count (sorted from the finest), every level is
+  // decimated from the previous one so the whole chain costs about as much as
+  // the coarsest level alone. You have the responsibility to delete the meshes
+  [[nodiscard]] std::vector<TriMesh*> GenerateLODChain(
+      TriMesh* in, std::vector<int> target_faces) const;
+
+  // when enabled only half-edge collapses are done (the merged vertex stays
+  // where it was instead of moving to the optimal position), the surviving
+  // vertices never change so their buffer can be reused for every LOD
+  void fixed_vertices(bool enabled);
+  [[nodiscard]] bool fixed_vertices() const;
+
+ private:
+  bool fixed_vertices_ = false;
+};
+
+#endif  // DECIMATION_H
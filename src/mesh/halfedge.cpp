@@ -1,10 +1,16 @@
 #include "halfedge.h"
 
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <new>
+#include <numeric>
 #include <unordered_map>
-#include <unordered_set>
 
 #include "../logger.h"
+#include "../parallel.h"
 #include "../utilities.h"
 #include "vertex.h"
 
@@ -268,53 +274,662 @@ bool HalfEdgeData::IsManifold() const {
                      [](const Edge* e) { return !e->halfedge->IsBoundary(); });
 }
 
-// ---
+// spreads the lower 21 bits of x so that there are two zero bits between each
+// of them (https://fgiesen.wordpress.com/2009/12/13/decoding-morton-codes/)
+static uint64_t SpreadBits(uint64_t x) {
+  x &= 0x1fffff;
+  x = (x | x << 32) & 0x1f00000000ffff;
+  x = (x | x << 16) & 0x1f0000ff0000ff;
+  x = (x | x << 8) & 0x100f00f00f00f00f;
+  x = (x | x << 4) & 0x10c30c30c30c30c3;
+  x = (x | x << 2) & 0x1249249249249249;
+  return x;
+}
 
-// you have the responsibility to delete the vector
-// TODO optimizable with RVO?
-std::vector<unsigned int>* CreateIndexBuffer(const HalfEdgeData* hf_data) {
-  std::vector<unsigned int>* index_buffer = new std::vector<unsigned int>();
+// 63 bit Morton code of a point inside the [min, min + extent] box
+static uint64_t MortonCode(const glm::vec3& p, const glm::vec3& min,
+                           const glm::vec3& inv_extent) {
+  constexpr float kCells = static_cast<float>((1 << 21) - 1);
+  const glm::vec3 n = glm::clamp((p - min) * inv_extent, 0.0F, 1.0F) * kCells;
+  return SpreadBits(static_cast<uint64_t>(n.x)) |
+         (SpreadBits(static_cast<uint64_t>(n.y)) << 1) |
+         (SpreadBits(static_cast<uint64_t>(n.z)) << 2);
+}
 
-  std::unordered_map<Vertex*, unsigned int> added_verts;
+void HalfEdgeData::SpatialReorder() {
+  if (vertices_->empty()) {
+    return;
+  }
 
-  int i = 0;
-  for (const Face* x : *hf_data->faces()) {
-    HalfEdge* start = x->halfedge;
+  glm::vec3 min = vertices_->front()->position;
+  glm::vec3 max = min;
+  for (const Vertex* v : *vertices_) {
+    min = glm::min(min, v->position);
+    max = glm::max(max, v->position);
+  }
+  // flat meshes have a zero extent on one axis
+  const glm::vec3 extent = glm::max(max - min, glm::vec3(1e-6F));
+  const glm::vec3 inv_extent = 1.0F / extent;
+
+  // (code, index) pairs, so the codes are computed only once and the sort
+  // moves small contiguous elements
+  std::vector<std::pair<uint64_t, size_t>> vert_order;
+  vert_order.reserve(vertices_->size());
+  for (size_t i = 0; i < vertices_->size(); i++) {
+    vert_order.emplace_back(
+        MortonCode(vertices_->at(i)->position, min, inv_extent), i);
+  }
+  std::sort(vert_order.begin(), vert_order.end());
+
+  std::vector<std::pair<uint64_t, size_t>> face_order;
+  face_order.reserve(faces_->size());
+  for (size_t i = 0; i < faces_->size(); i++) {
+    const HalfEdge* start = faces_->at(i)->halfedge;
+    const HalfEdge* curr = start;
+    glm::vec3 centroid = {0.0F, 0.0F, 0.0F};
+    int counter = 0;
+    do {
+      centroid += curr->vert->position;
+      counter++;
+      curr = curr->next;
+    } while (curr != start);
+    face_order.emplace_back(
+        MortonCode(centroid / static_cast<float>(counter), min, inv_extent),
+        i);
+  }
+  std::sort(face_order.begin(), face_order.end());
+
+  // The elements are allocated again in the new order, sorting only the
+  // vectors of pointers would not change where they live in memory.
+  // To map old to new without hashmaps (like the copy constructor does) the
+  // old elements are used as forwarding tables once their data has been
+  // copied:
+  // - old halfedge h        -> new one in h->next
+  // - old vertex v          -> new one in v->halfedge->vert
+  // - old face f            -> new one in f->halfedge->face
+  // - old edge e            -> new one in e->halfedge->edge
+  // every vertex/face/edge points to a different halfedge, so the slots never
+  // collide. The new elements keep the old links until the final remap.
+  std::vector<Vertex*>* new_vertices = new std::vector<Vertex*>();
+  std::vector<HalfEdge*>* new_half_edges = new std::vector<HalfEdge*>();
+  std::vector<Face*>* new_faces = new std::vector<Face*>();
+  std::vector<Edge*>* new_edges = new std::vector<Edge*>();
+  new_vertices->reserve(vertices_->size());
+  new_half_edges->reserve(half_edges_->size());
+  new_faces->reserve(faces_->size());
+  new_edges->reserve(edges_->size());
+
+  // the halfedges of a face are stored next to each other, and the faces
+  // follow their centroid order
+  std::vector<HalfEdge*> old_half_edges;
+  old_half_edges.reserve(half_edges_->size());
+  for (const auto [_, i] : face_order) {
+    Face* of = faces_->at(i);
+    HalfEdge* start = of->halfedge;
     HalfEdge* curr = start;
-
     do {
-      if (added_verts.find(curr->vert) == added_verts.end()) {
-        added_verts[curr->vert] = i;
-        i++;
-      }
-      index_buffer->push_back(added_verts[curr->vert]);
+      new_half_edges->push_back(new HalfEdge(*curr));
+      old_half_edges.push_back(curr);
       curr = curr->next;
     } while (curr != start);
   }
+  // only now, because the face loops above still needed the old next
+  for (size_t i = 0; i < old_half_edges.size(); i++) {
+    old_half_edges[i]->next = new_half_edges->at(i);
+  }
+
+  for (const auto [_, i] : vert_order) {
+    const Vertex* ov = vertices_->at(i);
+    Vertex* v = new Vertex(ov->position, ov->normal, ov->text_coords);
+    v->halfedge = ov->halfedge;
+    ov->halfedge->vert = v;
+    new_vertices->push_back(v);
+  }
 
-  return index_buffer;
+  for (const auto [_, i] : face_order) {
+    const Face* of = faces_->at(i);
+    Face* f = new Face();
+    f->halfedge = of->halfedge;
+    of->halfedge->face = f;
+    new_faces->push_back(f);
+  }
+
+  // edges in the order their first halfedge was met, an edge that has not
+  // been forwarded yet still finds itself in its slot
+  for (const HalfEdge* he : *new_half_edges) {
+    Edge* oe = he->edge;
+    if (oe->halfedge->edge == oe) {
+      Edge* e = new Edge();
+      e->halfedge = oe->halfedge;
+      oe->halfedge->edge = e;
+      new_edges->push_back(e);
+    }
+  }
+
+  for (HalfEdge* he : *new_half_edges) {
+    he->next = he->next->next;
+    he->twin = he->IsBoundary() ? nullptr : he->twin->next;
+    he->vert = he->vert->halfedge->vert;
+    he->face = he->face->halfedge->face;
+    he->edge = he->edge->halfedge->edge;
+  }
+  for (Vertex* v : *new_vertices) {
+    v->halfedge = v->halfedge->next;
+  }
+  for (Face* f : *new_faces) {
+    f->halfedge = f->halfedge->next;
+  }
+  for (Edge* e : *new_edges) {
+    e->halfedge = e->halfedge->next;
+  }
+
+  Clear();
+  vertices_ = new_vertices;
+  half_edges_ = new_half_edges;
+  faces_ = new_faces;
+  edges_ = new_edges;
 }
 
-// you have the responsibility to delete the vector
-// TODO optimizable with RVO?
-std::vector<Vertex>* CreateVertexBuffer(const HalfEdgeData* hf_data) {
-  std::vector<Vertex>* vertex_buffer = new std::vector<Vertex>();
-  vertex_buffer->reserve(hf_data->vertices()->size());
+bool IsAdjacent(const Vertex* v, const Vertex* x) {
+  const HalfEdge* curr = v->halfedge;
+  do {
+    if (curr->vert == x) {
+      return true;
+    }
+    if (curr->IsBoundary()) {
+      // go the other way up to the incoming boundary halfedge
+      curr = v->halfedge;
+      while (!curr->Previous()->IsBoundary()) {
+        curr = curr->Previous()->twin;
+        if (curr->vert == x) {
+          return true;
+        }
+      }
+      return curr->Previous()->Previous()->vert == x;
+    }
+    curr = curr->twin->next;
+  } while (curr != v->halfedge);
+  return false;
+}
 
-  std::unordered_set<Vertex*> added_verts;
+// valence of v, 0 if v is on the boundary
+static int InteriorValence(const Vertex* v) {
+  const HalfEdge* curr = v->halfedge;
+  int valence = 0;
+  do {
+    if (curr->IsBoundary()) {
+      return 0;
+    }
+    valence++;
+    curr = curr->twin->next;
+  } while (curr != v->halfedge);
+  return valence;
+}
 
-  for (const Face* x : *hf_data->faces()) {
-    HalfEdge* start = x->halfedge;
-    HalfEdge* curr = start;
+// no allocations in here, it runs once per candidate collapse
+bool HalfEdgeData::CanCollapse(const HalfEdge* h) const {
+  if (h->face == nullptr || h->IsBoundary()) {
+    return false;
+  }
 
-    do {
-      if (added_verts.find(curr->vert) == added_verts.end()) {
-        added_verts.insert(curr->vert);
-        vertex_buffer->push_back(*curr->vert);
+  const HalfEdge* t = h->twin;
+  const Vertex* b = h->vert;
+  const Vertex* c = h->next->vert;
+  const Vertex* d = t->next->vert;
+  if (c == d) {
+    return false;
+  }
+
+  // h goes out of a, walk around a checking that it's interior and that the
+  // only neighbours it shares with b are c and d
+  const HalfEdge* curr = h;
+  do {
+    if (curr->IsBoundary()) {
+      return false;
+    }
+    const Vertex* x = curr->vert;
+    if (x != b && x != c && x != d && IsAdjacent(b, x)) {
+      return false;
+    }
+    curr = curr->twin->next;
+  } while (curr != h);
+
+  // an interior vertex of valence 3 would end up with valence 2
+  const int valence_c = InteriorValence(c);
+  const int valence_d = InteriorValence(d);
+  return (valence_c == 0 || valence_c > 3) && (valence_d == 0 || valence_d > 3);
+}
+
+void HalfEdgeData::Collapse(HalfEdge* h) {
+  HalfEdge* t = h->twin;
+  Vertex* a = t->vert;
+  Vertex* b = h->vert;
+
+  // f0 = (a, b, c) and f1 = (b, a, d)
+  HalfEdge* h1 = h->next;   // b -> c
+  HalfEdge* h2 = h1->next;  // c -> a
+  HalfEdge* t1 = t->next;   // a -> d
+  HalfEdge* t2 = t1->next;  // d -> b
+  Vertex* c = h1->vert;
+  Vertex* d = t1->vert;
+
+  // every halfedge pointing to a now points to b (a is interior so we can
+  // rotate all the way around it)
+  HalfEdge* curr = a->halfedge;
+  do {
+    curr->twin->vert = b;
+    curr = curr->twin->next;
+  } while (curr != a->halfedge);
+
+  // the two sides of each deleted face are glued together, x2 and y1 always
+  // exist because they start/end at a
+  HalfEdge* x1 = h1->twin;  // c -> b
+  HalfEdge* x2 = h2->twin;  // a(b) -> c
+  HalfEdge* y1 = t1->twin;  // d -> a(b)
+  HalfEdge* y2 = t2->twin;  // b -> d
+
+  x2->twin = x1;
+  x2->edge = h1->edge;
+  h1->edge->halfedge = x2;
+  if (x1 != nullptr) {
+    x1->twin = x2;
+  }
+
+  y1->twin = y2;
+  y1->edge = t2->edge;
+  t2->edge->halfedge = y1;
+  if (y2 != nullptr) {
+    y2->twin = y1;
+  }
+
+  b->halfedge = x2;
+  c->halfedge = x2->next;
+  d->halfedge = y1;
+
+  a->halfedge = nullptr;
+  h->face->halfedge = nullptr;
+  t->face->halfedge = nullptr;
+  h->edge->halfedge = nullptr;
+  h2->edge->halfedge = nullptr;
+  t1->edge->halfedge = nullptr;
+  for (HalfEdge* x : {h, h1, h2, t, t1, t2}) {
+    x->face = nullptr;
+  }
+}
+
+template <typename T, typename IsDead>
+static void EraseDead(std::vector<T*>* elements, IsDead is_dead) {
+  std::size_t alive = 0;
+  for (T* x : *elements) {
+    if (is_dead(x)) {
+      delete x;
+    } else {
+      (*elements)[alive++] = x;
+    }
+  }
+  elements->resize(alive);
+}
+
+void HalfEdgeData::RemoveDeleted() {
+  EraseDead(vertices_, [](const Vertex* x) { return x->halfedge == nullptr; });
+  EraseDead(half_edges_, [](const HalfEdge* x) { return x->face == nullptr; });
+  EraseDead(faces_, [](const Face* x) { return x->halfedge == nullptr; });
+  EraseDead(edges_, [](const Edge* x) { return x->halfedge == nullptr; });
+}
+
+// ---
+
+void OneRing(const Vertex* v, std::vector<Vertex*>* out) {
+  const HalfEdge* start = v->halfedge;
+  const HalfEdge* curr = start;
+  bool boundary = false;
+  do {
+    out->push_back(curr->vert);
+    if (curr->IsBoundary()) {
+      boundary = true;
+      break;
+    }
+    curr = curr->twin->next;
+  } while (curr != start);
+
+  if (boundary) {
+    // hit the boundary going one way, go the other way from the start up to
+    // the incoming boundary halfedge
+    curr = start;
+    while (!curr->Previous()->IsBoundary()) {
+      curr = curr->Previous()->twin;
+      out->push_back(curr->vert);
+    }
+    // the origin of the incoming boundary halfedge
+    out->push_back(curr->Previous()->Previous()->vert);
+  }
+}
+
+HalfEdgeData* BuildHalfEdgeData(std::vector<Vertex*>* vertices,
+                                const std::vector<unsigned int>& indices,
+                                const std::vector<unsigned int>& face_starts) {
+  const std::size_t n_faces = face_starts.size() - 1;
+  std::vector<HalfEdge*>* halfedges = new std::vector<HalfEdge*>();
+  std::vector<Face*>* faces = new std::vector<Face*>();
+  std::vector<Edge*>* edges = new std::vector<Edge*>();
+  halfedges->reserve(indices.size());
+  faces->reserve(n_faces);
+
+  for (Vertex* v : *vertices) {
+    v->halfedge = nullptr;
+  }
+
+  // (undirected edge key, halfedge index), the key has the smaller vertex
+  // index in the high bits so that both directions end up next to each other
+  std::vector<std::pair<uint64_t, unsigned int>> keys;
+  keys.reserve(indices.size());
+
+  for (std::size_t f = 0; f < n_faces; f++) {
+    Face* face = new Face();
+    faces->push_back(face);
+    const unsigned int first = face_starts[f];
+    const unsigned int last = face_starts[f + 1];
+    for (unsigned int i = first; i < last; i++) {
+      const unsigned int from = indices[i];
+      const unsigned int to = indices[(i + 1 < last) ? i + 1 : first];
+      HalfEdge* he = new HalfEdge(face);
+      he->vert = vertices->at(to);
+      he->next = nullptr;
+      vertices->at(from)->halfedge = he;
+      halfedges->push_back(he);
+      keys.emplace_back(
+          (static_cast<uint64_t>(std::min(from, to)) << 32) | std::max(from, to),
+          static_cast<unsigned int>(halfedges->size() - 1));
+    }
+    for (unsigned int i = first; i < last; i++) {
+      halfedges->at(i)->next = halfedges->at((i + 1 < last) ? i + 1 : first);
+    }
+    face->halfedge = halfedges->at(first);
+  }
+
+  std::sort(keys.begin(), keys.end());
+
+  // every run of equal keys is one edge (two halfedges on a manifold, one on
+  // the boundary). Halfedges that can't be paired with one going the other
+  // way (non manifold edges or flipped faces) are left on the boundary
+  edges->reserve(keys.size() / 2 + 1);
+  std::size_t run_start = 0;
+  while (run_start < keys.size()) {
+    std::size_t run_end = run_start + 1;
+    while (run_end < keys.size() &&
+           keys[run_end].first == keys[run_start].first) {
+      run_end++;
+    }
+
+    for (std::size_t i = run_start; i < run_end; i++) {
+      HalfEdge* he = halfedges->at(keys[i].second);
+      if (he->edge != nullptr) {
+        continue;  // already paired
+      }
+      Edge* e = new Edge();
+      e->halfedge = he;
+      he->edge = e;
+      edges->push_back(e);
+      for (std::size_t j = i + 1; j < run_end; j++) {
+        HalfEdge* other = halfedges->at(keys[j].second);
+        if (other->edge == nullptr && other->vert != he->vert) {
+          he->twin = other;
+          other->twin = he;
+          other->edge = e;
+          break;
+        }
+      }
+    }
+    run_start = run_end;
+  }
+
+  const std::size_t n_vertices = vertices->size();
+  EraseDead(vertices, [](const Vertex* x) { return x->halfedge == nullptr; });
+  if (vertices->size() != n_vertices) {
+    LOG_WARN("{} unused vertices were removed",
+             n_vertices - vertices->size());
+  }
+
+  return new HalfEdgeData(vertices, halfedges, faces, edges);
+}
+
+// cells coordinates are 21 bits per axis, packed in one key without collisions
+static constexpr int kWeldCells = 1 << 21;
+
+static uint64_t WeldCellKey(const glm::ivec3& cell) {
+  return (static_cast<uint64_t>(cell.x) << 42) |
+         (static_cast<uint64_t>(cell.y) << 21) | static_cast<uint64_t>(cell.z);
+}
+
+void WeldVertices(std::vector<Vertex*>* vertices,
+                  std::vector<unsigned int>* indices,
+                  std::vector<unsigned int>* face_starts,
+                  const float relative_epsilon) {
+  using weld_clock = std::chrono::steady_clock;
+  const weld_clock::time_point start = weld_clock::now();
+
+  const std::size_t n = vertices->size();
+  if (n == 0) {
+    return;
+  }
+  glm::vec3 min = vertices->front()->position;
+  glm::vec3 max = min;
+  for (const Vertex* v : *vertices) {
+    min = glm::min(min, v->position);
+    max = glm::max(max, v->position);
+  }
+  const float epsilon =
+      std::max(glm::length(max - min) * relative_epsilon,
+               std::numeric_limits<float>::min());
+  const float epsilon2 = epsilon * epsilon;
+  // cells 4 epsilon wide: a vertex only looks into the cells next to its own
+  // when it is closer than epsilon to their side, which is rare. Huge meshes
+  // with a big epsilon would need more cells than the key has, then they are
+  // just wider
+  const float cell_size = std::max(
+      4.0F * epsilon,
+      (glm::max(max.x - min.x, glm::max(max.y - min.y, max.z - min.z))) /
+          (kWeldCells - 1));
+  auto cell_of = [min, cell_size](const glm::vec3& p) {
+    return glm::clamp(glm::ivec3(glm::floor((p - min) / cell_size)),
+                      glm::ivec3(0), glm::ivec3(kWeldCells - 1));
+  };
+
+  // sorted by cell and then by index, so every cell is a contiguous run with
+  // its vertices in index order. The positions are copied in, the searches
+  // below don't chase the vertex pointers
+  struct WeldPoint {
+    uint64_t cell;
+    unsigned int index;
+    glm::vec3 position;
+    bool operator<(const WeldPoint& other) const {
+      return cell != other.cell ? cell < other.cell : index < other.index;
+    }
+  };
+  std::vector<WeldPoint> points(n);
+  ParallelFor(0, n, [&](const std::size_t i) {
+    const glm::vec3& p = (*vertices)[i]->position;
+    points[i] = {WeldCellKey(cell_of(p)), static_cast<unsigned int>(i), p};
+  });
+  ParallelSort(points.begin(), points.end());
+
+  // every vertex is welded to the one with the smallest index within epsilon.
+  // The vertices are visited in cell order: the ones before in the same cell
+  // are right before in points, only the vertices close to a side of their
+  // cell look up the neighbouring cells
+  std::vector<unsigned int> welded(n);
+  auto closest_before = [epsilon2](auto first, const auto last,
+                                   const glm::vec3& p, unsigned int* best) {
+    // the smaller indices come first
+    for (; first != last && first->index < *best; ++first) {
+      const glm::vec3 d = first->position - p;
+      if (glm::dot(d, d) <= epsilon2) {
+        *best = first->index;
+        return;
+      }
+    }
+  };
+  ParallelFor(0, n, [&](const std::size_t s) {
+    const WeldPoint& point = points[s];
+    const glm::vec3& p = point.position;
+    unsigned int best = point.index;
+
+    std::size_t run_start = s;
+    while (run_start > 0 && points[run_start - 1].cell == point.cell) {
+      run_start--;
+    }
+    closest_before(points.begin() + run_start, points.begin() + s, p, &best);
+
+    const glm::ivec3 cell(
+        static_cast<int>(point.cell >> 42),
+        static_cast<int>((point.cell >> 21) & (kWeldCells - 1)),
+        static_cast<int>(point.cell & (kWeldCells - 1)));
+    const glm::vec3 cell_min = min + glm::vec3(cell) * cell_size;
+    glm::ivec3 from;
+    glm::ivec3 to;
+    for (int k = 0; k < 3; k++) {
+      from[k] = (p[k] - cell_min[k] < epsilon && cell[k] > 0) ? -1 : 0;
+      to[k] = (cell_min[k] + cell_size - p[k] < epsilon &&
+               cell[k] < kWeldCells - 1)
+                  ? 1
+                  : 0;
+    }
+    for (int dx = from.x; dx <= to.x; dx++) {
+      for (int dy = from.y; dy <= to.y; dy++) {
+        for (int dz = from.z; dz <= to.z; dz++) {
+          if (dx == 0 && dy == 0 && dz == 0) {
+            continue;
+          }
+          const uint64_t other = WeldCellKey(cell + glm::ivec3(dx, dy, dz));
+          const auto range = std::equal_range(
+              points.begin(), points.end(), WeldPoint{other, 0, p},
+              [](const WeldPoint& x, const WeldPoint& y) {
+                return x.cell < y.cell;
+              });
+          closest_before(range.first, range.second, p, &best);
+        }
       }
+    }
+    welded[point.index] = best;
+  });
+
+  // welded[i] <= i, so following the chains in index order always finds an
+  // already resolved vertex. Then the kept vertices are compacted
+  std::vector<unsigned int> new_index(n);
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < n; i++) {
+    welded[i] = welded[welded[i]];
+    if (welded[i] == i) {
+      new_index[i] = static_cast<unsigned int>(kept);
+      (*vertices)[kept++] = (*vertices)[i];
+    } else {
+      delete (*vertices)[i];
+      new_index[i] = new_index[welded[i]];
+    }
+  }
+  vertices->resize(kept);
+
+  // faces with a collapsed side are dropped, the others keep their number of
+  // sides (so the mesh type doesn't change)
+  std::size_t out = 0;
+  std::size_t n_faces = 0;
+  std::size_t n_degenerate = 0;
+  // both arrays are compacted in place, face_starts[f] may be overwritten
+  // before the face is read
+  unsigned int first = 0;
+  for (std::size_t f = 0; f + 1 < face_starts->size(); f++) {
+    const unsigned int last = (*face_starts)[f + 1];
+    const std::size_t face_start = out;
+    bool degenerate = false;
+    for (unsigned int i = first; i < last; i++) {
+      const unsigned int v = new_index[(*indices)[i]];
+      for (std::size_t j = face_start; j < out; j++) {
+        degenerate |= (*indices)[j] == v;
+      }
+      (*indices)[out++] = v;
+    }
+    if (degenerate) {
+      out = face_start;
+      n_degenerate++;
+    } else {
+      (*face_starts)[++n_faces] = static_cast<unsigned int>(out);
+    }
+    first = last;
+  }
+  indices->resize(out);
+  face_starts->resize(n_faces + 1);
+
+  LOG_INFO(
+      "welded {} vertices into {}, {} degenerate faces removed ({:.3f} ms)", n,
+      kept, n_degenerate,
+      std::chrono::duration<double, std::milli>(weld_clock::now() - start)
+          .count());
+}
+
+void TriangulateFaces(std::vector<unsigned int>* indices,
+                      std::vector<unsigned int>* face_starts) {
+  std::vector<unsigned int> triangles;
+  std::vector<unsigned int> triangle_starts = {0};
+  triangles.reserve(indices->size());
+  for (std::size_t f = 0; f + 1 < face_starts->size(); f++) {
+    const unsigned int first = (*face_starts)[f];
+    const unsigned int last = (*face_starts)[f + 1];
+    for (unsigned int k = first + 1; k + 1 < last; k++) {
+      triangles.push_back((*indices)[first]);
+      triangles.push_back((*indices)[k]);
+      triangles.push_back((*indices)[k + 1]);
+      triangle_starts.push_back(static_cast<unsigned int>(triangles.size()));
+    }
+  }
+  indices->swap(triangles);
+  face_starts->swap(triangle_starts);
+}
+
+MESH_TYPE FacesType(const std::vector<unsigned int>& face_starts) {
+  if (face_starts.size() < 2) {
+    return MESH_TYPE::POLY;  // no faces (all of them degenerate when welded)
+  }
+  const unsigned int sides = face_starts[1] - face_starts[0];
+  if (sides != 3 && sides != 4) {
+    return MESH_TYPE::POLY;
+  }
+  for (std::size_t f = 1; f + 1 < face_starts.size(); f++) {
+    if (face_starts[f + 1] - face_starts[f] != sides) {
+      return MESH_TYPE::POLY;
+    }
+  }
+  return (sides == 3) ? MESH_TYPE::TRI : MESH_TYPE::QUAD;
+}
+
+std::size_t CountIndices(const HalfEdgeData* hf_data) {
+  std::size_t count = 0;
+  for (const Face* x : *hf_data->faces()) {
+    const HalfEdge* start = x->halfedge;
+    const HalfEdge* curr = start;
+    do {
+      count++;
       curr = curr->next;
     } while (curr != start);
   }
+  return count;
+}
+
+void ExportVertices(const HalfEdgeData* hf_data, Vertex* out) {
+  const std::vector<Vertex*>& vertices = *hf_data->vertices();
+  for (std::size_t i = 0; i < vertices.size(); i++) {
+    vertices[i]->index = static_cast<unsigned int>(i);
+    new (out + i) Vertex(*vertices[i]);
+  }
+}
 
-  return vertex_buffer;
+void ExportIndices(const HalfEdgeData* hf_data, unsigned int* out) {
+  std::size_t i = 0;
+  for (const Face* x : *hf_data->faces()) {
+    const HalfEdge* start = x->halfedge;
+    const HalfEdge* curr = start;
+    do {
+      out[i++] = curr->vert->index;
+      curr = curr->next;
+    } while (curr != start);
+  }
 }
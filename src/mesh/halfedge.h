@@ -1,6 +1,7 @@
 #ifndef HALFEDGE_H
 #define HALFEDGE_H
 
+#include <cstddef>
 #include <vector>
 
 #include "vertex.h"
@@ -54,6 +55,30 @@ class HalfEdgeData {
 
   bool IsManifold() const;
 
+  // re-sorts the vertices along a Morton (Z-order) curve of their positions and
+  // the faces along the curve of their centroids, then reallocates every
+  // element in that order and remaps all the links. After a few split/flip
+  // rounds neighbouring elements end up far apart in memory, this brings them
+  // back together so the next one-ring traversals hit the cache
+  void SpatialReorder();
+
+  // --- edge collapses (triangle meshes only)
+  // Collapsing the halfedge h removes its origin vertex (h->twin->vert) and
+  // merges it into h->vert, deleting the two faces adjacent to h.
+  // Removed elements are not freed right away (pointers to them could still
+  // be around, for example in a priority queue), they are only marked as dead:
+  // vertices, faces and edges get a nullptr halfedge and halfedges a nullptr
+  // face. RemoveDeleted() frees them and compacts the vectors.
+
+  // true if collapsing h keeps the mesh a manifold: the origin must be an
+  // interior vertex (so boundaries are never modified), the one-rings of the
+  // two vertices must only share the two opposite vertices (link condition)
+  // and the opposite vertices must not drop below valence 3
+  [[nodiscard]] bool CanCollapse(const HalfEdge* h) const;
+  // collapses h (CanCollapse(h) must be true), the kept vertex does not move
+  void Collapse(HalfEdge* h);
+  void RemoveDeleted();
+
  private:
   std::vector<Vertex*>* vertices_;
   std::vector<HalfEdge*>* half_edges_;
@@ -61,7 +86,48 @@ class HalfEdgeData {
   std::vector<Edge*>* edges_;
 };
 
-std::vector<unsigned int>* CreateIndexBuffer(const HalfEdgeData* hf_data);
-std::vector<Vertex>* CreateVertexBuffer(const HalfEdgeData* hf_data);
+// the vertices adjacent to v (works for boundary vertices too)
+void OneRing(const Vertex* v, std::vector<Vertex*>* out);
+// true if there is an edge between v and x (v can be on the boundary)
+bool IsAdjacent(const Vertex* v, const Vertex* x);
+
+// builds the halfedge data of a polygon mesh from an index buffer, face f uses
+// the indices [face_starts[f], face_starts[f + 1]) so faces can have any
+// number of sides (face_starts has one more element than the faces).
+// Twins are found by sorting the halfedges by their (undirected) edge instead
+// of going through a map. Takes ownership of the vertices, the ones not used
+// by any face are deleted
+HalfEdgeData* BuildHalfEdgeData(std::vector<Vertex*>* vertices,
+                                const std::vector<unsigned int>& indices,
+                                const std::vector<unsigned int>& face_starts);
+
+// merges the vertices closer than relative_epsilon times the bounding box
+// diagonal (importers split them at uv and normal seams), so the halfedges
+// built on the indices afterwards are connected across the seams. The kept
+// vertex is the first one and keeps its attributes, the others are deleted
+// and the indices remapped. Faces left with two equal corners are removed.
+// Same face_starts layout as BuildHalfEdgeData(), runs on the worker threads
+void WeldVertices(std::vector<Vertex*>* vertices,
+                  std::vector<unsigned int>* indices,
+                  std::vector<unsigned int>* face_starts,
+                  float relative_epsilon = 1e-6F);
+
+// fan triangulation of every face with more than 3 sides (same face_starts
+// layout as BuildHalfEdgeData())
+void TriangulateFaces(std::vector<unsigned int>* indices,
+                      std::vector<unsigned int>* face_starts);
+// TRI or QUAD when every face has 3 or 4 sides, POLY otherwise
+MESH_TYPE FacesType(const std::vector<unsigned int>& face_starts);
+
+// the export to the OpenGL buffers, out is usually mapped buffer memory (see
+// BufferPool) so it's only written, in order
+// the number of indices of the faces, one per corner
+std::size_t CountIndices(const HalfEdgeData* hf_data);
+// the hf_data->vertices()->size() vertices, in the order of vertices(). It
+// also sets their Vertex::index
+void ExportVertices(const HalfEdgeData* hf_data, Vertex* out);
+// the CountIndices() indices of the faces, into the ExportVertices() order
+// (it must have been called first, the indices are the Vertex::index)
+void ExportIndices(const HalfEdgeData* hf_data, unsigned int* out);
 
 #endif  // HALFEDGE_H
@@ -2,4 +2,40 @@
 
 IImporter::~IImporter() {
   //
-};
\ No newline at end of file
+};
+
+std::vector<IMesh*> IImporter::import(const std::filesystem::path& filepath,
+                                      const Options& opts) {
+  return UploadMeshes(read(filepath, opts));
+}
+
+IMesh* CreateMeshOfType(const MESH_TYPE type, HalfEdgeData* hf_data,
+                        Material* material) {
+  switch (type) {
+    case MESH_TYPE::TRI:
+      return new TriMesh(hf_data, material);
+    case MESH_TYPE::QUAD:
+      return new QuadMesh(hf_data, material);
+    default:
+      return new PolyMesh(hf_data, material);
+  }
+}
+
+std::vector<IMesh*> UploadMeshes(const std::vector<ImportedMesh>& meshes) {
+  std::vector<IMesh*> out;
+  out.reserve(meshes.size());
+  for (const ImportedMesh& x : meshes) {
+    for (const TextureImage& image : x.textures) {
+      x.material->AddTexture(Texture(image));
+    }
+    out.push_back(CreateMeshOfType(x.type, x.hf_data, x.material));
+  }
+  return out;
+}
+
+void DeleteImportedMeshes(const std::vector<ImportedMesh>& meshes) {
+  for (const ImportedMesh& x : meshes) {
+    delete x.hf_data;
+    delete x.material;
+  }
+}
@@ -2,20 +2,39 @@
 #define IMPORTER_H
 
 #include <filesystem>
+#include <vector>
 
 #include "mesh.h"
+#include "../texture.h"
 
 struct Options {
   bool triangulate;
   bool pre_transform;
   bool require_single_mesh;
+  // merges the vertices split at uv/normal seams (see WeldVertices()), a
+  // welded vertex keeps the uv of one side of the seam
+  bool weld_vertices;
 
   Options()
-      : triangulate(false), pre_transform(true), require_single_mesh(false) {
+      : triangulate(false),
+        pre_transform(true),
+        require_single_mesh(false),
+        weld_vertices(false) {
     //
   }
 };
 
+// a mesh as it comes out of an importer, before any OpenGL object is made for
+// it. Reading a model only fills these, so it can run on any thread; the
+// buffers and textures are made later by UploadMeshes() on the GL thread
+struct ImportedMesh {
+  MESH_TYPE type = MESH_TYPE::TRI;
+  HalfEdgeData* hf_data = nullptr;
+  // without textures, they are added when uploaded
+  Material* material = nullptr;
+  std::vector<TextureImage> textures;
+};
+
 class IImporter {
  public:
   IImporter() = default;
@@ -26,10 +45,25 @@ class IImporter {
 
   virtual ~IImporter() = 0;
 
-  virtual std::vector<IMesh*> import(const std::filesystem::path& filepath,
-                                     const Options& opts = Options()) = 0;
+  // everything that doesn't need OpenGL, safe to call from any thread
+  virtual std::vector<ImportedMesh> read(const std::filesystem::path& filepath,
+                                         const Options& opts = Options()) = 0;
+
+  // read() and UploadMeshes(), on the GL thread
+  std::vector<IMesh*> import(const std::filesystem::path& filepath,
+                             const Options& opts = Options());
 
  private:
 };
 
+// wraps hf_data in the mesh class of the given type
+IMesh* CreateMeshOfType(MESH_TYPE type, HalfEdgeData* hf_data,
+                        Material* material);
+
+// makes the meshes out of what an importer read (must run on the GL thread),
+// they take the ownership of the halfedges and materials
+std::vector<IMesh*> UploadMeshes(const std::vector<ImportedMesh>& meshes);
+// for the meshes that are not going to be uploaded
+void DeleteImportedMeshes(const std::vector<ImportedMesh>& meshes);
+
 #endif  // IMPORTER_H
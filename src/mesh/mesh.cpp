@@ -1,6 +1,9 @@
 #include "mesh.h"
 
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <new>
 #include <unordered_map>
 #include <map>
 #include <unordered_set>
@@ -12,9 +15,47 @@
 
 #include "vertex.h"
 #include "../logger.h"
+#include "../profiler.h"
 #include "../utilities.h"
 #include "halfedge.h"
 
+namespace {
+
+// a pool buffer with count elements, write() fills its mapped memory (only
+// writing, the memory can be uncached)
+template <typename T>
+MeshBuffer UploadBuffer(const std::size_t count,
+                        const std::function<void(T* out)>& write) {
+  BufferPool& pool = BufferPool::Instance();
+  const GLsizeiptr size = static_cast<GLsizeiptr>(sizeof(T) * count);
+  void* mapped = nullptr;
+  const MeshBuffer buffer = pool.Acquire(size, &mapped);
+  write(static_cast<T*>(mapped));
+  pool.Unmap(buffer, size);
+  return buffer;
+}
+
+// as the control shaders measure their patches: the distance from the
+// average of the corners to the farthest one
+float MaxTriangleRadius(const HalfEdgeData* data) {
+  float radius = 0.0F;
+  for (const Face* f : *data->faces()) {
+    const HalfEdge* he = f->halfedge;
+    if (he->next->next->next != he) {
+      continue;  // not a triangle
+    }
+    const glm::vec3& a = he->vert->position;
+    const glm::vec3& b = he->next->vert->position;
+    const glm::vec3& c = he->next->next->vert->position;
+    const glm::vec3 center = (a + b + c) / 3.0F;
+    radius = std::max({radius, glm::distance(center, a),
+                       glm::distance(center, b), glm::distance(center, c)});
+  }
+  return radius;
+}
+
+}  // namespace
+
 AbstractMesh::AbstractMesh(const MESH_TYPE type, HalfEdgeData* hf_data,
                            Material* material)
     : hf_data_(hf_data), material_(material) {
@@ -23,7 +64,7 @@ AbstractMesh::AbstractMesh(const MESH_TYPE type, HalfEdgeData* hf_data,
     throw;
   }
   // TODO FIX BAD CALL TO VIRTUAL FUNCTION IN CONSTRUCTOR
-  GenerateOpenGLBuffers();
+  GenerateOpenGLBuffers(hf_data_);
 }
 
 // this is weird because it is a pure virtual function but whatever
@@ -38,10 +79,22 @@ const GLuint& AbstractMesh::vao() const {
   return VAO_;
 }
 
+GLuint AbstractMesh::vbo() const {
+  return vertex_buffer_.id;
+}
+
+GLuint AbstractMesh::ibo() const {
+  return index_buffer_.id;
+}
+
 unsigned int AbstractMesh::num_indices() const {
   return num_indices_;
 }
 
+unsigned int AbstractMesh::num_buffer_vertices() const {
+  return num_buffer_vertices_;
+}
+
 const HalfEdgeData* AbstractMesh::half_edge_data() const {
   return hf_data_;
 }
@@ -61,6 +114,10 @@ void AbstractMesh::material(Material* m) {
   material_ = m;
 }
 
+const BoundingVolume& AbstractMesh::bounds() const {
+  return bounds_;
+}
+
 bool AbstractMesh::IsManifold() const {
   return hf_data_->IsManifold();
 }
@@ -81,16 +138,28 @@ void AbstractMesh::ApplySmoothNormals() {
   hf_data_->ShadeSmooth();
 }
 
-void AbstractMesh::GenerateOpenGLBuffers(std::vector<Vertex>* vertices,
-                                         std::vector<unsigned int>* indices) {
+void AbstractMesh::GenerateOpenGLBuffers(const HalfEdgeData* data) {
+  ScopedTimer timer("buffer generation");
+  const std::size_t num_vertices = data->vertices()->size();
+  const std::size_t num_indices = CountIndices(data);
+
+  // released first so the new buffers can take their storage
   ClearOpenGLBuffers();
-  if (vertices == nullptr) {
-    vertices = CreateVertexBuffer(hf_data_);
-  }
-  if (indices == nullptr) {
-    indices = CreateIndexBuffer(hf_data_);
-  }
-  num_indices_ = indices->size();
+  // the export writes straight into the buffers
+  vertex_buffer_ = UploadBuffer<Vertex>(
+      num_vertices, [data](Vertex* out) { ExportVertices(data, out); });
+  index_buffer_ = UploadBuffer<unsigned int>(
+      num_indices, [data](unsigned int* out) { ExportIndices(data, out); });
+  SetUpVertexArray(num_vertices, num_indices);
+}
+
+void AbstractMesh::SetUpVertexArray(const std::size_t num_vertices,
+                                    const std::size_t num_indices) {
+  num_buffer_vertices_ = num_vertices;
+  num_indices_ = num_indices;
+  // the flat shaded vertices are in the same positions
+  bounds_ = BoundingVolume::FromVertices(*hf_data_->vertices());
+  bounds_.patch_radius = MaxTriangleRadius(hf_data_);
 
   glGenVertexArrays(1, &VAO_);
   glBindVertexArray(VAO_);
@@ -100,11 +169,7 @@ void AbstractMesh::GenerateOpenGLBuffers(std::vector<Vertex>* vertices,
   // by glVertexAttribPointer
   // https://www.khronos.org/opengl/wiki/Vertex_Specification#Vertex_Buffer_Object
 
-  glGenBuffers(1, &VBO_);
-  glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices->size(),
-               vertices->data(), GL_STATIC_DRAW);
-
+  glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_.id);
   glVertexAttribPointer(to_underlying(ATTRIB_ID::POSITIONS), 3, GL_FLOAT,
                         GL_FALSE, sizeof(Vertex),
                         (GLvoid*)offsetof(struct Vertex, position));
@@ -114,66 +179,62 @@ void AbstractMesh::GenerateOpenGLBuffers(std::vector<Vertex>* vertices,
   glVertexAttribPointer(to_underlying(ATTRIB_ID::TEXTURE_COORDS), 2, GL_FLOAT,
                         GL_FALSE, sizeof(Vertex),
                         (GLvoid*)offsetof(struct Vertex, text_coords));
+  // the enabled arrays are part of the VAO state, once is enough
+  glEnableVertexAttribArray(to_underlying(ATTRIB_ID::POSITIONS));
+  glEnableVertexAttribArray(to_underlying(ATTRIB_ID::NORMALS));
+  glEnableVertexAttribArray(to_underlying(ATTRIB_ID::TEXTURE_COORDS));
 
-  glGenBuffers(1, &IBO_);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO_);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * num_indices_,
-               indices->data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_.id);
   glBindVertexArray(0);
-
-  // we don't need them anymore
-  delete vertices;
-  delete indices;
 }
 
 void AbstractMesh::GenerateOpenGLBuffersWithSmoothShading() {
-  ClearOpenGLBuffers();
   HalfEdgeData* shaded = new HalfEdgeData(*hf_data_);
   shaded->ShadeSmooth();
-  std::vector<Vertex>* vertex_buffer = CreateVertexBuffer(shaded);
-  std::vector<unsigned int>* index_buffer = CreateIndexBuffer(shaded);
-  GenerateOpenGLBuffers(vertex_buffer, index_buffer);
+  GenerateOpenGLBuffers(shaded);
   delete shaded;
 }
 
 void AbstractMesh::GenerateOpenGLBufferWithFlatShading() {
-  // custom vertex and index generation for duplicating vertices
-  std::vector<Vertex>* vertex_buffer = new std::vector<Vertex>();
-  std::vector<unsigned int>* index_buffer = new std::vector<unsigned int>();
-
-  for (const Face* f : *hf_data_->faces()) {
-    glm::vec3 face_normal = glm::normalize(f->ComputeNormalWithArea());
-
-    HalfEdge* start = f->halfedge;
-    HalfEdge* curr = start;
+  ScopedTimer timer("buffer generation");
+  // every corner gets its own vertex, with the normal of its face
+  const std::size_t num_corners = CountIndices(hf_data_);
 
-    do {
-      vertex_buffer->emplace_back(curr->vert->position, face_normal,
-                                  curr->vert->text_coords);
-      curr = curr->next;
-    } while (curr != start);
-  }
-
-  int i = 0;
-  for (const Face* x : *hf_data_->faces()) {
-    HalfEdge* start = x->halfedge;
-    HalfEdge* curr = start;
-
-    do {
-      index_buffer->push_back(i);
-      i++;
-      curr = curr->next;
-    } while (curr != start);
-  }
-
-  GenerateOpenGLBuffers(vertex_buffer, index_buffer);
+  ClearOpenGLBuffers();
+  vertex_buffer_ = UploadBuffer<Vertex>(num_corners, [this](Vertex* out) {
+    std::size_t i = 0;
+    for (const Face* f : *hf_data_->faces()) {
+      glm::vec3 face_normal = glm::normalize(f->ComputeNormalWithArea());
+
+      HalfEdge* start = f->halfedge;
+      HalfEdge* curr = start;
+
+      do {
+        new (out + i) Vertex(curr->vert->position, face_normal,
+                             curr->vert->text_coords);
+        i++;
+        curr = curr->next;
+      } while (curr != start);
+    }
+  });
+  index_buffer_ =
+      UploadBuffer<unsigned int>(num_corners, [num_corners](unsigned int* out) {
+        for (std::size_t i = 0; i < num_corners; i++) {
+          out[i] = static_cast<unsigned int>(i);
+        }
+      });
+  SetUpVertexArray(num_corners, num_corners);
 }
 
 void AbstractMesh::ClearOpenGLBuffers() {
-  glDeleteBuffers(1, &VBO_);
-  glDeleteBuffers(1, &IBO_);
+  BufferPool::Instance().Release(vertex_buffer_);
+  BufferPool::Instance().Release(index_buffer_);
+  vertex_buffer_ = MeshBuffer();
+  index_buffer_ = MeshBuffer();
   glDeleteVertexArrays(1, &VAO_);
+  VAO_ = 0;
   num_indices_ = 0;
+  num_buffer_vertices_ = 0;
 }
 
 TriMesh::TriMesh(HalfEdgeData* hf_data, Material* material)
@@ -189,6 +250,9 @@ std::vector<sa::SubDiv> TriMesh::CompatibleSubdivs() {
   std::vector<sa::SubDiv> res = {sa::SubDiv::NONE, sa::SubDiv::LOOP};
   if (IsManifold()) {
     res.push_back(sa::SubDiv::SQRT3);
+    // after pairing the triangles into quads (catmull-clark needs a closed
+    // mesh)
+    res.push_back(sa::SubDiv::CATMULL);
   }
   return res;
 }
@@ -225,6 +289,9 @@ int PolyMesh::PatchNumVertices() const {
 }
 
 std::vector<sa::SubDiv> PolyMesh::CompatibleSubdivs() {
+  if (IsManifold()) {
+    return {sa::SubDiv::NONE, sa::SubDiv::CATMULL};
+  }
   return {sa::SubDiv::NONE};
 }
 
@@ -4,7 +4,9 @@
 #include <unordered_map>
 
 #include <GL/glew.h>
+#include "buffer_pool.h"
 #include "halfedge.h"
+#include "../bounds.h"
 #include "../material.h"
 #include "../utilities.h"
 
@@ -35,7 +37,11 @@ inline const std::unordered_map<SubDiv, std::string> kSubdivisions = {
 enum class ATTRIB_ID {
   POSITIONS = 0,
   NORMALS = 1,
-  TEXTURE_COORDS = 2
+  TEXTURE_COORDS = 2,
+  // per instance, a mat4 so it takes the locations 3 to 6 (see RenderQueue)
+  MODEL_TO_WORLD = 3,
+  // per instance, the index of the material in the material buffer
+  MATERIAL = 7
 };
 
 enum class SHADING {
@@ -48,11 +54,17 @@ class IMesh {
  public:
   // opengl rendering
   [[nodiscard]] virtual const GLuint& vao() const = 0;
+  [[nodiscard]] virtual GLuint vbo() const = 0;
+  [[nodiscard]] virtual GLuint ibo() const = 0;
   [[nodiscard]] virtual unsigned int num_indices() const = 0;
+  // the vertices in vbo(), its storage can be bigger (see BufferPool)
+  [[nodiscard]] virtual unsigned int num_buffer_vertices() const = 0;
   [[nodiscard]] virtual const Material* material() const = 0;
   [[nodiscard]] virtual Material* material() = 0;
   virtual void material(Material* m) = 0;
   [[nodiscard]] virtual int PatchNumVertices() const = 0;
+  // in model space, of the vertices in the OpenGL buffers
+  [[nodiscard]] virtual const BoundingVolume& bounds() const = 0;
 
   [[nodiscard]] virtual IMesh* clone() = 0;
   [[nodiscard]] virtual int num_vertices() const = 0;
@@ -86,11 +98,15 @@ class AbstractMesh : public IMesh {
   AbstractMesh& operator=(AbstractMesh&& other) = delete;
 
   [[nodiscard]] const GLuint& vao() const override;
+  [[nodiscard]] GLuint vbo() const override;
+  [[nodiscard]] GLuint ibo() const override;
   [[nodiscard]] unsigned int num_indices() const override;
+  [[nodiscard]] unsigned int num_buffer_vertices() const override;
   [[nodiscard]] const HalfEdgeData* half_edge_data() const;
   [[nodiscard]] const Material* material() const override;
   [[nodiscard]] Material* material() override;
   void material(Material* m) override;
+  [[nodiscard]] const BoundingVolume& bounds() const override;
 
   [[nodiscard]] bool IsManifold() const override;
 
@@ -112,15 +128,20 @@ class AbstractMesh : public IMesh {
  protected:
   // we generate the buffers, as is, without any modification to the underlying
   // data, it overrides prev buffer
-  void GenerateOpenGLBuffers(std::vector<Vertex>* vertices = nullptr,
-                             std::vector<unsigned int>* indices = nullptr);
+  void GenerateOpenGLBuffers(const HalfEdgeData* data);
+  // the VAO of the vertex and index buffers just written
+  void SetUpVertexArray(std::size_t num_vertices, std::size_t num_indices);
+  // the buffers go back to the BufferPool, the next ones can reuse them
   void ClearOpenGLBuffers();
 
   // OpenGL specific
-  GLuint VAO_;  // Vertex Array Object
-  GLuint VBO_;  // Vertex Buffer Object
-  GLuint IBO_;  // Index Buffer Object
-  unsigned int num_indices_;
+  GLuint VAO_ = 0;            // Vertex Array Object
+  MeshBuffer vertex_buffer_;  // Vertex Buffer Object
+  MeshBuffer index_buffer_;   // Index Buffer Object
+  unsigned int num_indices_ = 0;
+  unsigned int num_buffer_vertices_ = 0;
+  // computed every time the buffers are generated
+  BoundingVolume bounds_;
 
   // Actual mesh data
   HalfEdgeData* hf_data_;
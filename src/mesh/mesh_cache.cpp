@@ -0,0 +1,497 @@
+#include "mesh_cache.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+
+#include "../logger.h"
+#include "../mapped_file.h"
+#include "../utilities.h"
+
+namespace {
+
+// bump it every time the layout below changes
+constexpr uint32_t kCacheVersion = 1;
+constexpr char kCacheMagic[8] = {'T', 'E', 'S', 'S', 'H', 'E', 'C', '\0'};
+// written as a number, read back as a number: if the bytes come out different
+// the file was written on a machine with the other endianness
+constexpr uint32_t kByteOrder = 0x01020304;
+// twin of the boundary halfedges
+constexpr uint32_t kNone = 0xFFFFFFFF;
+
+// everything is 4 bytes aligned, strings are padded to 4 bytes
+struct CacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t key;  // see CacheKey()
+  uint32_t path_length;
+  uint32_t mesh_count;
+};
+
+struct CachedMeshHeader {
+  uint32_t type;  // MESH_TYPE
+  uint32_t n_vertices;
+  uint32_t n_halfedges;
+  uint32_t n_faces;
+  uint32_t n_edges;
+  uint32_t n_textures;
+  float ambient[3];
+  float diffuse[3];
+  float specular[3];
+  float shininess;
+};
+
+struct CachedVertex {
+  float position[3];
+  float normal[3];
+  float text_coords[2];
+  uint32_t halfedge;
+};
+
+struct CachedHalfEdge {
+  uint32_t next;
+  uint32_t twin;
+  uint32_t vert;
+  uint32_t face;
+  uint32_t edge;
+};
+
+struct CachedTexture {
+  uint32_t type;         // TEXTURE_TYPE
+  uint32_t path_length;  // 0 for the default texture
+};
+
+uint64_t HashOptions(const Options& opts, const uint64_t hash) {
+  const unsigned char bits[4] = {
+      static_cast<unsigned char>(opts.triangulate),
+      static_cast<unsigned char>(opts.pre_transform),
+      static_cast<unsigned char>(opts.require_single_mesh),
+      static_cast<unsigned char>(opts.weld_vertices)};
+  return Fnv1a(bits, sizeof(bits), hash);
+}
+
+// what makes a cache file stale: the source path, its size and modification
+// time and the import options
+bool CacheKey(const std::filesystem::path& source, const Options& opts,
+              uint64_t* key) {
+  std::error_code error;
+  const uintmax_t size = std::filesystem::file_size(source, error);
+  if (error) {
+    return false;
+  }
+  const auto mtime = std::filesystem::last_write_time(source, error)
+                         .time_since_epoch()
+                         .count();
+  if (error) {
+    return false;
+  }
+  const std::string path = source.generic_string();
+  uint64_t hash = Fnv1a(path.data(), path.size());
+  hash = Fnv1a(&size, sizeof(size), hash);
+  hash = Fnv1a(&mtime, sizeof(mtime), hash);
+  *key = HashOptions(opts, hash);
+  return true;
+}
+
+class CacheWriter {
+ public:
+  explicit CacheWriter(std::ofstream* out) : out_(out) {}
+
+  template <typename T>
+  void Write(const T& value) {
+    out_->write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  void WriteString(const std::string& s) {
+    out_->write(s.data(), static_cast<std::streamsize>(s.size()));
+    const char padding[4] = {0, 0, 0, 0};
+    out_->write(padding, static_cast<std::streamsize>((4 - s.size() % 4) % 4));
+  }
+
+ private:
+  std::ofstream* out_;
+};
+
+// reads from the mapping, every read is bounds checked so a truncated or
+// corrupted file is rejected instead of crashing
+class CacheReader {
+ public:
+  CacheReader(const char* p, const char* end) : p_(p), end_(end) {}
+
+  template <typename T>
+  bool Read(T* out) {
+    if (static_cast<std::size_t>(end_ - p_) < sizeof(T)) {
+      return false;
+    }
+    std::memcpy(out, p_, sizeof(T));
+    p_ += sizeof(T);
+    return true;
+  }
+
+  bool ReadString(const uint32_t length, std::string* out) {
+    const std::size_t padded = (length + 3) / 4 * 4;
+    if (static_cast<std::size_t>(end_ - p_) < padded) {
+      return false;
+    }
+    out->assign(p_, length);
+    p_ += padded;
+    return true;
+  }
+
+  // start of an array of n T (nullptr if the file is too short)
+  template <typename T>
+  const char* Array(const std::size_t n) {
+    if (static_cast<std::size_t>(end_ - p_) / sizeof(T) < n) {
+      return nullptr;
+    }
+    const char* start = p_;
+    p_ += n * sizeof(T);
+    return start;
+  }
+
+ private:
+  const char* p_;
+  const char* end_;
+};
+
+bool IsMeshType(const uint32_t type) {
+  for (const MESH_TYPE x : {MESH_TYPE::TRI, MESH_TYPE::QUAD, MESH_TYPE::POLY}) {
+    if (type == static_cast<uint32_t>(to_underlying(x))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename T>
+T At(const char* array, const std::size_t i) {
+  T value;
+  std::memcpy(&value, array + i * sizeof(T), sizeof(T));
+  return value;
+}
+
+void StoreMesh(CacheWriter* out, const ImportedMesh& mesh) {
+  const HalfEdgeData* hfd = mesh.hf_data;
+  const Material* material = mesh.material;
+
+  std::unordered_map<const Vertex*, uint32_t> vertex_index;
+  std::unordered_map<const HalfEdge*, uint32_t> halfedge_index;
+  std::unordered_map<const Face*, uint32_t> face_index;
+  std::unordered_map<const Edge*, uint32_t> edge_index;
+  for (const Vertex* x : *hfd->vertices()) {
+    vertex_index.emplace(x, static_cast<uint32_t>(vertex_index.size()));
+  }
+  for (const HalfEdge* x : *hfd->half_edges()) {
+    halfedge_index.emplace(x, static_cast<uint32_t>(halfedge_index.size()));
+  }
+  for (const Face* x : *hfd->faces()) {
+    face_index.emplace(x, static_cast<uint32_t>(face_index.size()));
+  }
+  for (const Edge* x : *hfd->edges()) {
+    edge_index.emplace(x, static_cast<uint32_t>(edge_index.size()));
+  }
+
+  CachedMeshHeader header = {};
+  header.type = static_cast<uint32_t>(to_underlying(mesh.type));
+  header.n_vertices = static_cast<uint32_t>(hfd->vertices()->size());
+  header.n_halfedges = static_cast<uint32_t>(hfd->half_edges()->size());
+  header.n_faces = static_cast<uint32_t>(hfd->faces()->size());
+  header.n_edges = static_cast<uint32_t>(hfd->edges()->size());
+  header.n_textures = static_cast<uint32_t>(mesh.textures.size());
+  for (int k = 0; k < 3; k++) {
+    header.ambient[k] = material->ambient_reflectivity()[k];
+    header.diffuse[k] = material->diffuse_reflectivity()[k];
+    header.specular[k] = material->specular_reflectivity()[k];
+  }
+  header.shininess = material->shininess();
+  out->Write(header);
+
+  for (const Vertex* x : *hfd->vertices()) {
+    CachedVertex v = {};
+    for (int k = 0; k < 3; k++) {
+      v.position[k] = x->position[k];
+      v.normal[k] = x->normal[k];
+    }
+    v.text_coords[0] = x->text_coords.x;
+    v.text_coords[1] = x->text_coords.y;
+    v.halfedge = halfedge_index.at(x->halfedge);
+    out->Write(v);
+  }
+  for (const HalfEdge* x : *hfd->half_edges()) {
+    CachedHalfEdge he = {};
+    he.next = halfedge_index.at(x->next);
+    he.twin = x->IsBoundary() ? kNone : halfedge_index.at(x->twin);
+    he.vert = vertex_index.at(x->vert);
+    he.face = face_index.at(x->face);
+    he.edge = edge_index.at(x->edge);
+    out->Write(he);
+  }
+  for (const Face* x : *hfd->faces()) {
+    out->Write(halfedge_index.at(x->halfedge));
+  }
+  for (const Edge* x : *hfd->edges()) {
+    out->Write(halfedge_index.at(x->halfedge));
+  }
+
+  for (const TextureImage& t : mesh.textures) {
+    const std::string path = t.path.generic_string();
+    CachedTexture texture = {};
+    texture.type = static_cast<uint32_t>(to_underlying(t.type));
+    texture.path_length = static_cast<uint32_t>(path.size());
+    out->Write(texture);
+    out->WriteString(path);
+  }
+}
+
+// false if the data is not valid
+bool LoadMesh(CacheReader* in, ImportedMesh* out) {
+  CachedMeshHeader header;
+  if (!in->Read(&header) || !IsMeshType(header.type)) {
+    return false;
+  }
+  const char* cached_vertices = in->Array<CachedVertex>(header.n_vertices);
+  const char* cached_halfedges =
+      in->Array<CachedHalfEdge>(header.n_halfedges);
+  const char* cached_faces = in->Array<uint32_t>(header.n_faces);
+  const char* cached_edges = in->Array<uint32_t>(header.n_edges);
+  if (cached_vertices == nullptr || cached_halfedges == nullptr ||
+      cached_faces == nullptr || cached_edges == nullptr) {
+    return false;
+  }
+
+  // check every link before allocating anything
+  for (uint32_t i = 0; i < header.n_vertices; i++) {
+    if (At<CachedVertex>(cached_vertices, i).halfedge >= header.n_halfedges) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < header.n_halfedges; i++) {
+    const CachedHalfEdge he = At<CachedHalfEdge>(cached_halfedges, i);
+    if (he.next >= header.n_halfedges ||
+        (he.twin != kNone && he.twin >= header.n_halfedges) ||
+        he.vert >= header.n_vertices || he.face >= header.n_faces ||
+        he.edge >= header.n_edges) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < header.n_faces; i++) {
+    if (At<uint32_t>(cached_faces, i) >= header.n_halfedges) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < header.n_edges; i++) {
+    if (At<uint32_t>(cached_edges, i) >= header.n_halfedges) {
+      return false;
+    }
+  }
+
+  std::vector<std::pair<TEXTURE_TYPE, std::string>> textures;
+  for (uint32_t i = 0; i < header.n_textures; i++) {
+    CachedTexture texture;
+    std::string path;
+    if (!in->Read(&texture) || !in->ReadString(texture.path_length, &path)) {
+      return false;
+    }
+    textures.emplace_back(static_cast<TEXTURE_TYPE>(texture.type), path);
+  }
+
+  // allocate everything first, then link
+  std::vector<Vertex*>* vertices = new std::vector<Vertex*>();
+  std::vector<HalfEdge*>* halfedges = new std::vector<HalfEdge*>();
+  std::vector<Face*>* faces = new std::vector<Face*>();
+  std::vector<Edge*>* edges = new std::vector<Edge*>();
+  vertices->reserve(header.n_vertices);
+  halfedges->reserve(header.n_halfedges);
+  faces->reserve(header.n_faces);
+  edges->reserve(header.n_edges);
+  for (uint32_t i = 0; i < header.n_halfedges; i++) {
+    halfedges->push_back(new HalfEdge());
+  }
+  for (uint32_t i = 0; i < header.n_vertices; i++) {
+    const CachedVertex v = At<CachedVertex>(cached_vertices, i);
+    Vertex* x = new Vertex(
+        glm::vec3(v.position[0], v.position[1], v.position[2]),
+        glm::vec3(v.normal[0], v.normal[1], v.normal[2]),
+        glm::vec2(v.text_coords[0], v.text_coords[1]));
+    x->halfedge = (*halfedges)[v.halfedge];
+    vertices->push_back(x);
+  }
+  for (uint32_t i = 0; i < header.n_faces; i++) {
+    Face* x = new Face();
+    x->halfedge = (*halfedges)[At<uint32_t>(cached_faces, i)];
+    faces->push_back(x);
+  }
+  for (uint32_t i = 0; i < header.n_edges; i++) {
+    Edge* x = new Edge();
+    x->halfedge = (*halfedges)[At<uint32_t>(cached_edges, i)];
+    edges->push_back(x);
+  }
+  for (uint32_t i = 0; i < header.n_halfedges; i++) {
+    const CachedHalfEdge he = At<CachedHalfEdge>(cached_halfedges, i);
+    HalfEdge* x = (*halfedges)[i];
+    x->next = (*halfedges)[he.next];
+    x->twin = (he.twin == kNone) ? nullptr : (*halfedges)[he.twin];
+    x->vert = (*vertices)[he.vert];
+    x->face = (*faces)[he.face];
+    x->edge = (*edges)[he.edge];
+  }
+
+  Material* material = new Material();
+  material->ambient_reflectivity(
+      glm::vec3(header.ambient[0], header.ambient[1], header.ambient[2]));
+  material->diffuse_reflectivity(
+      glm::vec3(header.diffuse[0], header.diffuse[1], header.diffuse[2]));
+  material->specular_reflectivity(
+      glm::vec3(header.specular[0], header.specular[1], header.specular[2]));
+  material->shininess(header.shininess);
+
+  out->type = static_cast<MESH_TYPE>(header.type);
+  out->hf_data = new HalfEdgeData(vertices, halfedges, faces, edges);
+  out->material = material;
+  for (const auto& [type, path] : textures) {
+    out->textures.push_back(path.empty() ? DecodeDefaultTexture(type)
+                                         : DecodeTexture(path, type));
+  }
+  return true;
+}
+
+}  // namespace
+
+MeshCache::MeshCache(const std::filesystem::path& directory)
+    : directory_(directory) {
+  //
+}
+
+std::filesystem::path MeshCache::CachePath(const std::filesystem::path& source,
+                                           const Options& opts) const {
+  const std::string path = source.generic_string();
+  const uint64_t name = HashOptions(opts, Fnv1a(path.data(), path.size()));
+  char hex[17];
+  std::snprintf(hex, sizeof(hex), "%016llx",
+                static_cast<unsigned long long>(name));
+  return directory_ / (std::string(hex) + ".hec");
+}
+
+std::vector<ImportedMesh> MeshCache::Load(const std::filesystem::path& source,
+                                    const Options& opts) const {
+  using cache_clock = std::chrono::steady_clock;
+  const cache_clock::time_point start = cache_clock::now();
+
+  const std::filesystem::path cache_path = CachePath(source, opts);
+  uint64_t key = 0;
+  std::error_code error;
+  if (!std::filesystem::exists(cache_path, error) ||
+      !CacheKey(source, opts, &key)) {
+    return {};
+  }
+
+  std::vector<ImportedMesh> meshes;
+  try {
+    const MappedFile file(cache_path);
+    CacheReader in(file.data(), file.data() + file.size());
+
+    CacheHeader header;
+    std::string path;
+    if (!in.Read(&header) ||
+        std::memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) != 0 ||
+        header.version != kCacheVersion || header.byte_order != kByteOrder ||
+        header.key != key || !in.ReadString(header.path_length, &path) ||
+        path != source.generic_string()) {
+      LOG_INFO("mesh cache for {} is out of date", source.string());
+      return {};
+    }
+
+    for (uint32_t i = 0; i < header.mesh_count; i++) {
+      ImportedMesh mesh;
+      if (!LoadMesh(&in, &mesh)) {
+        LOG_WARN("mesh cache {} is corrupted", cache_path.string());
+        DeleteImportedMeshes(meshes);
+        return {};
+      }
+      meshes.push_back(mesh);
+    }
+  } catch (const FileNotFoundException&) {
+    return {};
+  }
+
+  LOG_INFO("loaded {} meshes of {} from the mesh cache in {:.3f} ms",
+           meshes.size(), source.string(),
+           std::chrono::duration<double, std::milli>(cache_clock::now() -
+                                                     start)
+               .count());
+  return meshes;
+}
+
+void MeshCache::Store(const std::filesystem::path& source, const Options& opts,
+                      const std::vector<ImportedMesh>& meshes) const {
+  uint64_t key = 0;
+  if (!CacheKey(source, opts, &key)) {
+    return;
+  }
+
+  for (const ImportedMesh& mesh : meshes) {
+    for (const TextureImage& t : mesh.textures) {
+      if (t.embedded) {
+        LOG_INFO("{} has embedded textures, it won't be cached",
+                 source.string());
+        return;
+      }
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(directory_, error);
+  const std::filesystem::path cache_path = CachePath(source, opts);
+  // written next to it and renamed at the end, so a crash never leaves half a
+  // cache file behind. The name is per thread because the same model can be
+  // read by two threads at once
+  std::filesystem::path temporary_path = cache_path;
+  temporary_path +=
+      "." +
+      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) +
+      ".tmp";
+  {
+    std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      LOG_WARN("could not write the mesh cache {}", cache_path.string());
+      std::filesystem::remove(temporary_path, error);
+      return;
+    }
+    CacheWriter out(&file);
+
+    const std::string path = source.generic_string();
+    CacheHeader header = {};
+    std::memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+    header.version = kCacheVersion;
+    header.byte_order = kByteOrder;
+    header.key = key;
+    header.path_length = static_cast<uint32_t>(path.size());
+    header.mesh_count = static_cast<uint32_t>(meshes.size());
+    out.Write(header);
+    out.WriteString(path);
+
+    for (const ImportedMesh& mesh : meshes) {
+      StoreMesh(&out, mesh);
+    }
+    if (!file) {
+      LOG_WARN("could not write the mesh cache {}", cache_path.string());
+      // closed first, an open file can't be removed on Windows
+      file.close();
+      std::filesystem::remove(temporary_path, error);
+      return;
+    }
+  }
+
+  std::filesystem::rename(temporary_path, cache_path, error);
+  if (error) {
+    LOG_WARN("could not write the mesh cache {}", cache_path.string());
+    std::filesystem::remove(temporary_path, error);
+  }
+}
@@ -0,0 +1,43 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <filesystem>
+#include <vector>
+
+#include "mesh.h"
+#include "importer.h"
+
+// Binary cache of imported meshes, so a model is only imported (and its
+// halfedges built) the first time it is loaded.
+// Every (source file, import Options) pair gets its own cache file with:
+// - a header with the format version, the source path and a hash of the
+//   source path, size, modification time and Options. A cache file whose
+//   header does not match the source anymore is ignored (and rewritten)
+// - per mesh: the element counts, the material (colors and texture file
+//   paths) and contiguous arrays of vertex attributes and of halfedge/face/
+//   edge links stored as indices
+// Loading memory maps the file and turns the index arrays back into the
+// pointer based HalfEdgeData in one linear pass (no parsing or twin matching).
+// Neither Load() nor Store() touch OpenGL.
+// Models with embedded textures are not cached (they can't be referenced by
+// path)
+class MeshCache {
+ public:
+  explicit MeshCache(const std::filesystem::path& directory);
+
+  // the cached meshes of source imported with opts, empty if there is no up to
+  // date cache for them
+  [[nodiscard]] std::vector<ImportedMesh> Load(
+      const std::filesystem::path& source, const Options& opts) const;
+  // errors are only logged, the cache is just an optimization
+  void Store(const std::filesystem::path& source, const Options& opts,
+             const std::vector<ImportedMesh>& meshes) const;
+
+ private:
+  [[nodiscard]] std::filesystem::path CachePath(
+      const std::filesystem::path& source, const Options& opts) const;
+
+  std::filesystem::path directory_;
+};
+
+#endif  // MESH_CACHE_H
@@ -1,5 +1,7 @@
 #include "model_importer.h"
 
+#include <algorithm>
+#include <cctype>
 #include <filesystem>
 #include <map>
 #include <unordered_map>
@@ -10,10 +12,14 @@
 #include <assimp/postprocess.h>
 
 #include "../logger.h"
+#include "../profiler.h"
 #include "../utilities.h"
 #include "mesh.h"
 #include "importer.h"
 #include "assimp_importer.h"
+#include "mesh_cache.h"
+#include "obj_importer.h"
+#include "ply_importer.h"
 
 #include <glm/gtx/hash.hpp>
 
@@ -21,28 +27,75 @@ IMeshCreator ::~IMeshCreator() {
   //
 }
 
+// formats with a native importer skip Assimp, everything else goes through it.
+// The obj importer only makes one mesh, so it's only used when that's what is
+// asked for
+static std::vector<ImportedMesh> ReadModelFromSource(
+    const std::filesystem::path& path, const Options& opts) {
+  std::string extension = path.extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+
+  if (extension == ".ply") {
+    PlyImporter ply;
+    return ply.read(path, opts);
+  }
+  if (extension == ".obj" && opts.require_single_mesh) {
+    ObjImporter obj;
+    return obj.read(path, opts);
+  }
+  AssimpImporter assimp;
+  return assimp.read(path, opts);
+}
+
+// the cache is tried first, a model is only really imported the first time
+// (or when it changed)
+std::vector<ImportedMesh> ReadModel(const std::filesystem::path& path,
+                                    const Options& opts) {
+  ScopedTimer timer("import");
+  const MeshCache cache("cache");
+  std::vector<ImportedMesh> result = cache.Load(path, opts);
+  if (!result.empty()) {
+    return result;
+  }
+
+  result = ReadModelFromSource(path, opts);
+  cache.Store(path, opts, result);
+  return result;
+}
+
 StaticModel* StaticModelCreator::CreateMesh(
     const std::string& name, const std::filesystem::path& model_path_,
     const Options& opts) {
-  AssimpImporter import_;
-  std::vector<IMesh*> result = import_.import(model_path_, opts);
+  return CreateMesh(name, ReadModel(model_path_, opts));
+}
+
+StaticModel* StaticModelCreator::CreateMesh(
+    const std::string& name, const std::vector<ImportedMesh>& meshes) {
+  std::vector<IMesh*> result = UploadMeshes(meshes);
   // do checks for the mesh (primitive type, mesh count...)
   // add shaders accordingly or throw
 
-  return new StaticModel(name, result,
-                         ShaderManager::Instance().GetShader("TriangleShader"));
+  StaticModel* model = new StaticModel(
+      name, result, ShaderManager::Instance().GetShader("TriangleShader"));
+  model->merge_buffers(true);
+  return model;
+}
+
+Options SubDivMeshCreator::ImportOptions(Options opts) {
+  opts.require_single_mesh = true;
+  return opts;
 }
 
 SubDivMesh* SubDivMeshCreator::CreateMesh(
     const std::string& name, const std::filesystem::path& model_path_,
     Options opts) {
-  opts.require_single_mesh = true;
+  return CreateMesh(name, ReadModel(model_path_, ImportOptions(opts)));
+}
 
-  // For now this will by default use ASSIMP
-  // TODO in the near future i want to add support for tinyobj because i don't
-  // like how assimp imports obj files
-  AssimpImporter a;
-  IMesh* result = a.import(model_path_, opts).at(0);
+SubDivMesh* SubDivMeshCreator::CreateMesh(
+    const std::string& name, const std::vector<ImportedMesh>& meshes) {
+  IMesh* result = UploadMeshes(meshes).at(0);
 
   const Shader* s;
   if (TriMesh* d = dynamic_cast<TriMesh*>(result); d != nullptr) {
@@ -58,6 +111,33 @@ SubDivMesh* SubDivMeshCreator::CreateMesh(
   return new SubDivMesh(name, result, s);
 }
 
+Options ProgressiveMeshCreator::ImportOptions(Options opts) {
+  opts.require_single_mesh = true;
+  opts.triangulate = true;
+  return opts;
+}
+
+ProgressiveMesh* ProgressiveMeshCreator::CreateMesh(
+    const std::string& name, const std::filesystem::path& model_path_,
+    Options opts) {
+  return CreateMesh(name, ReadModel(model_path_, ImportOptions(opts)));
+}
+
+ProgressiveMesh* ProgressiveMeshCreator::CreateMesh(
+    const std::string& name, const std::vector<ImportedMesh>& meshes) {
+  IMesh* result = UploadMeshes(meshes).at(0);
+
+  TriMesh* tri = dynamic_cast<TriMesh*>(result);
+  if (tri == nullptr) {
+    LOG_ERROR("progressive meshes need a triangle mesh ({})", name);
+    delete result;
+    throw MeshImportException();
+  }
+
+  return new ProgressiveMesh(
+      name, tri, ShaderManager::Instance().GetShader("TriangleShader"));
+}
+
 SubDivMesh* SubDivMeshCreator::CreateMesh(
     const std::string& name, const MESH_TYPE in_type,
     const std::vector<Vertex>& in_vertices,
@@ -7,6 +7,12 @@
 #include "object.h"
 #include "mesh.h"
 
+// imports a model (or loads it from the mesh cache) without touching OpenGL,
+// so it can run on any thread. The creators then make the objects out of the
+// result on the GL thread
+std::vector<ImportedMesh> ReadModel(const std::filesystem::path& path,
+                                    const Options& opts);
+
 // factory method class
 class IMeshCreator {
  public:
@@ -20,6 +26,9 @@ class StaticModelCreator final : public IMeshCreator {
   StaticModel* CreateMesh(const std::string& name,
                           const std::filesystem::path& model_path_,
                           const Options& opts = Options());
+  // out of meshes read with ReadModel()
+  StaticModel* CreateMesh(const std::string& name,
+                          const std::vector<ImportedMesh>& meshes);
 
   // StaticModel* CreateMesh(std::string url) {}
 
@@ -30,9 +39,15 @@ class SubDivMeshCreator : public IMeshCreator {
  public:
   ~SubDivMeshCreator() = default;
 
+  // what the models must be read with
+  static Options ImportOptions(Options opts = Options());
+
   SubDivMesh* CreateMesh(const std::string& name,
                          const std::filesystem::path& model_path_,
                          Options opts = Options());
+  // out of a model read with ReadModel() and ImportOptions()
+  SubDivMesh* CreateMesh(const std::string& name,
+                         const std::vector<ImportedMesh>& meshes);
 
   SubDivMesh* CreateMesh(const std::string& name, const MESH_TYPE in_type,
                          const std::vector<Vertex>& in_vertices,
@@ -41,4 +56,20 @@ class SubDivMeshCreator : public IMeshCreator {
  private:
 };
 
+class ProgressiveMeshCreator : public IMeshCreator {
+ public:
+  ~ProgressiveMeshCreator() = default;
+
+  // what the models must be read with
+  static Options ImportOptions(Options opts = Options());
+
+  // the model must be a single triangle mesh (it is triangulated on import)
+  ProgressiveMesh* CreateMesh(const std::string& name,
+                              const std::filesystem::path& model_path_,
+                              Options opts = Options());
+  // out of a model read with ReadModel() and ImportOptions()
+  ProgressiveMesh* CreateMesh(const std::string& name,
+                              const std::vector<ImportedMesh>& meshes);
+};
+
 #endif  // MODEL_H
@@ -0,0 +1,446 @@
+#include "obj_importer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../logger.h"
+#include "../mapped_file.h"
+#include "../parallel.h"
+#include "../text_parsing.h"
+#include "../utilities.h"
+
+namespace {
+
+// bits of ObjCorner::relative
+constexpr uint8_t kRelativeV = 1;
+constexpr uint8_t kRelativeVt = 2;
+constexpr uint8_t kRelativeVn = 4;
+
+// one v/vt/vn triple of a face, 0 based. Negative obj indices count back from
+// the last element read, inside a chunk they are stored relative to the start
+// of the chunk (the relative bit is set) and fixed once the chunk offsets are
+// known. vt and vn are -1 when missing
+struct ObjCorner {
+  int64_t v;
+  int64_t vt;
+  int64_t vn;
+  uint8_t relative;
+};
+
+struct ObjChunk {
+  const char* begin;
+  const char* end;
+
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec2> uvs;
+  std::vector<glm::vec3> normals;
+  std::vector<ObjCorner> corners;
+  std::vector<unsigned int> face_sizes;
+  // the first ones in the chunk
+  std::string mtllib;
+  std::string usemtl;
+
+  // exceptions can't leave the worker threads, the error is thrown after the
+  // parsing is done
+  bool failed = false;
+};
+
+bool StartsWith(const char* p, const char* end, const char* keyword) {
+  const std::size_t n = std::strlen(keyword);
+  return static_cast<std::size_t>(end - p) > n &&
+         std::memcmp(p, keyword, n) == 0 && IsBlank(p[n]);
+}
+
+// the rest of the line without the blanks around it
+std::string RestOfLine(const char* p, const char* end) {
+  SkipBlanks(p, end);
+  const char* last = p;
+  while (last < end && *last != '\n') {
+    last++;
+  }
+  while (last > p && IsBlank(last[-1])) {
+    last--;
+  }
+  return std::string(p, last);
+}
+
+// obj index (1 based, or negative from the end) to the ObjCorner convention
+bool ParseIndex(const char*& p, const char* end, const std::size_t local_count,
+                const uint8_t relative_bit, int64_t* out, uint8_t* relative) {
+  int64_t index = 0;
+  if (!ParseInt(p, end, &index) || index == 0) {
+    return false;
+  }
+  if (index > 0) {
+    *out = index - 1;
+  } else {
+    *out = static_cast<int64_t>(local_count) + index;
+    *relative |= relative_bit;
+  }
+  return true;
+}
+
+bool ParseFace(const char*& p, const char* end, ObjChunk* chunk) {
+  unsigned int sides = 0;
+  while (true) {
+    SkipBlanks(p, end);
+    if (p >= end || *p == '\n' || *p == '#') {
+      break;
+    }
+
+    ObjCorner corner = {-1, -1, -1, 0};
+    if (!ParseIndex(p, end, chunk->positions.size(), kRelativeV, &corner.v,
+                    &corner.relative)) {
+      return false;
+    }
+    if (p < end && *p == '/') {
+      p++;
+      if (p < end && *p != '/' &&
+          !ParseIndex(p, end, chunk->uvs.size(), kRelativeVt, &corner.vt,
+                      &corner.relative)) {
+        return false;
+      }
+      if (p < end && *p == '/') {
+        p++;
+        if (!ParseIndex(p, end, chunk->normals.size(), kRelativeVn,
+                        &corner.vn, &corner.relative)) {
+          return false;
+        }
+      }
+    }
+    chunk->corners.push_back(corner);
+    sides++;
+  }
+  if (sides < 3) {
+    return false;
+  }
+  chunk->face_sizes.push_back(sides);
+  return true;
+}
+
+void ParseChunk(ObjChunk* chunk) {
+  const char* p = chunk->begin;
+  const char* end = chunk->end;
+  while (p < end) {
+    SkipBlanks(p, end);
+    if (p >= end) {
+      break;
+    }
+
+    bool ok = true;
+    if (StartsWith(p, end, "v")) {
+      p += 1;
+      glm::vec3 position;
+      ok = ParseFloat(p, end, &position.x) && ParseFloat(p, end, &position.y) &&
+           ParseFloat(p, end, &position.z);
+      chunk->positions.push_back(position);
+    } else if (StartsWith(p, end, "vt")) {
+      p += 2;
+      glm::vec2 uv(0.0F, 0.0F);
+      ok = ParseFloat(p, end, &uv.x);
+      ParseFloat(p, end, &uv.y);  // optional
+      chunk->uvs.push_back(uv);
+    } else if (StartsWith(p, end, "vn")) {
+      p += 2;
+      glm::vec3 normal;
+      ok = ParseFloat(p, end, &normal.x) && ParseFloat(p, end, &normal.y) &&
+           ParseFloat(p, end, &normal.z);
+      chunk->normals.push_back(normal);
+    } else if (StartsWith(p, end, "f")) {
+      p += 1;
+      ok = ParseFace(p, end, chunk);
+    } else if (StartsWith(p, end, "mtllib")) {
+      if (chunk->mtllib.empty()) {
+        chunk->mtllib = RestOfLine(p + 6, end);
+      }
+    } else if (StartsWith(p, end, "usemtl")) {
+      if (chunk->usemtl.empty()) {
+        chunk->usemtl = RestOfLine(p + 6, end);
+      }
+    }
+    // comments, groups, smoothing groups, lines and points are ignored
+
+    if (!ok) {
+      chunk->failed = true;
+      return;
+    }
+    SkipLine(p, end);
+  }
+}
+
+// the chunks start right after a '\n' so that no record is split between two
+// of them. Small files are a single chunk (spawning threads costs more)
+std::vector<ObjChunk> SplitChunks(const char* data, const std::size_t size) {
+  constexpr std::size_t kMinChunkSize = 1 << 20;
+  const std::size_t n_chunks = std::clamp<std::size_t>(
+      size / kMinChunkSize, 1, static_cast<std::size_t>(WorkerCount()) * 4);
+
+  std::vector<ObjChunk> chunks;
+  const char* end = data + size;
+  const char* begin = data;
+  for (std::size_t i = 1; i <= n_chunks && begin < end; i++) {
+    const char* split = (i == n_chunks) ? end : data + size / n_chunks * i;
+    if (split < begin) {
+      split = begin;
+    }
+    SkipLine(split, end);
+    ObjChunk chunk;
+    chunk.begin = begin;
+    chunk.end = split;
+    chunks.push_back(std::move(chunk));
+    begin = split;
+  }
+  return chunks;
+}
+
+// from the corner convention to an index in the merged array, false if out of
+// range
+bool Resolve(const int64_t index, const bool relative,
+             const std::size_t chunk_offset, const std::size_t total,
+             int64_t* out) {
+  *out = relative ? static_cast<int64_t>(chunk_offset) + index : index;
+  return *out >= 0 && *out < static_cast<int64_t>(total);
+}
+
+// the material named usemtl (or the first one if usemtl is empty) in the mtl
+// file, with the same defaults as the assimp importer. Its textures are
+// decoded into textures, not uploaded
+Material* LoadMaterial(const std::filesystem::path& obj_path,
+                       const std::string& mtllib, const std::string& usemtl,
+                       std::vector<TextureImage>* textures) {
+  Material* x = new Material();
+
+  std::filesystem::path diffuse_path;
+  std::filesystem::path displacement_path;
+  if (!mtllib.empty()) {
+    std::filesystem::path mtl_path = obj_path;
+    mtl_path.replace_filename(mtllib);
+    std::ifstream mtl_file(mtl_path);
+    if (!mtl_file) {
+      LOG_WARN("Material file not found: {}", mtl_path.string());
+    }
+
+    bool in_material = false;
+    bool found = false;
+    std::string line;
+    while (std::getline(mtl_file, line)) {
+      std::istringstream in(line);
+      std::string keyword;
+      in >> keyword;
+      if (keyword == "newmtl") {
+        std::string name;
+        in >> name;
+        if (found) {
+          break;  // only the first match
+        }
+        in_material = usemtl.empty() || name == usemtl;
+        found = in_material;
+        continue;
+      }
+      if (!in_material) {
+        continue;
+      }
+
+      glm::vec3 color;
+      if (keyword == "Ka" && (in >> color.x >> color.y >> color.z)) {
+        x->ambient_reflectivity(color);
+      } else if (keyword == "Kd" && (in >> color.x >> color.y >> color.z)) {
+        x->diffuse_reflectivity(color);
+      } else if (keyword == "Ks" && (in >> color.x >> color.y >> color.z)) {
+        x->specular_reflectivity(color);
+      } else if (keyword == "Ns") {
+        float shininess = 0.0F;
+        if (in >> shininess) {
+          x->shininess(shininess);
+        }
+      } else if (keyword == "map_Kd" || keyword == "disp" ||
+                 keyword == "map_disp") {
+        // texture options (-s, -o...) come first, the file name is last
+        std::string word;
+        std::string file_name;
+        while (in >> word) {
+          file_name = word;
+        }
+        std::filesystem::path texture_path = obj_path;
+        texture_path.replace_filename(file_name);
+        if (keyword == "map_Kd") {
+          diffuse_path = texture_path;
+        } else {
+          displacement_path = texture_path;
+        }
+      }
+    }
+  }
+
+  if (!diffuse_path.empty()) {
+    x->diffuse_reflectivity(glm::vec3(1.0F, 1.0F, 1.0F));
+    // if we can't find a texture with this path, then there will still be a
+    // texture created automatically with the default "white.png"
+    textures->push_back(DecodeTexture(diffuse_path, TEXTURE_TYPE::DIFFUSE));
+  } else {
+    textures->push_back(DecodeDefaultTexture(TEXTURE_TYPE::DIFFUSE));
+  }
+  if (!displacement_path.empty()) {
+    textures->push_back(
+        DecodeTexture(displacement_path, TEXTURE_TYPE::DISPLACEMENT));
+  }
+  return x;
+}
+
+}  // namespace
+
+std::vector<ImportedMesh> ObjImporter::read(
+    const std::filesystem::path& filepath, const Options& opts) {
+  using obj_clock = std::chrono::steady_clock;
+  const obj_clock::time_point start = obj_clock::now();
+
+  const MappedFile file(filepath);
+  std::vector<ObjChunk> chunks = SplitChunks(file.data(), file.size());
+  ParallelFor(
+      0, chunks.size(), [&chunks](std::size_t i) { ParseChunk(&chunks[i]); },
+      1);
+
+  const double parse_ms =
+      std::chrono::duration<double, std::milli>(obj_clock::now() - start)
+          .count();
+
+  // offsets of every chunk in the merged arrays
+  std::vector<std::size_t> v_offset(chunks.size() + 1, 0);
+  std::vector<std::size_t> vt_offset(chunks.size() + 1, 0);
+  std::vector<std::size_t> vn_offset(chunks.size() + 1, 0);
+  std::size_t n_corners = 0;
+  std::size_t n_faces = 0;
+  std::string mtllib;
+  std::string usemtl;
+  for (std::size_t i = 0; i < chunks.size(); i++) {
+    if (chunks[i].failed) {
+      LOG_ERROR("invalid obj record in {}", filepath.string());
+      throw MeshImportException();
+    }
+    v_offset[i + 1] = v_offset[i] + chunks[i].positions.size();
+    vt_offset[i + 1] = vt_offset[i] + chunks[i].uvs.size();
+    vn_offset[i + 1] = vn_offset[i] + chunks[i].normals.size();
+    n_corners += chunks[i].corners.size();
+    n_faces += chunks[i].face_sizes.size();
+    if (mtllib.empty()) {
+      mtllib = chunks[i].mtllib;
+    }
+    if (usemtl.empty()) {
+      usemtl = chunks[i].usemtl;
+    }
+  }
+  if (n_faces == 0) {
+    LOG_ERROR("obj file without faces {}", filepath.string());
+    throw MeshImportException();
+  }
+
+  auto element = [&chunks](auto member, std::size_t global,
+                           const std::vector<std::size_t>& offsets) {
+    const std::size_t c =
+        std::upper_bound(offsets.begin(), offsets.end(), global) -
+        offsets.begin() - 1;
+    return (chunks[c].*member)[global - offsets[c]];
+  };
+
+  // one vertex per distinct (position, uv) pair, the vertices that share a
+  // position are chained through next_with_position
+  const std::size_t n_positions = v_offset.back();
+  std::vector<int64_t> first_with_position(n_positions, -1);
+  std::vector<int64_t> next_with_position;
+  std::vector<int64_t> vertex_uv;
+  std::vector<Vertex*>* vertices = new std::vector<Vertex*>();
+  vertices->reserve(n_positions);
+  next_with_position.reserve(n_positions);
+  vertex_uv.reserve(n_positions);
+
+  std::vector<unsigned int> indices;
+  std::vector<unsigned int> face_starts = {0};
+  indices.reserve(n_corners);
+  face_starts.reserve(n_faces + 1);
+  bool has_normals = false;
+
+  for (std::size_t c = 0; c < chunks.size(); c++) {
+    const ObjChunk& chunk = chunks[c];
+    std::size_t corner = 0;
+    for (const unsigned int sides : chunk.face_sizes) {
+      for (unsigned int k = 0; k < sides; k++, corner++) {
+        const ObjCorner& in = chunk.corners[corner];
+        int64_t v = 0;
+        int64_t vt = -1;
+        int64_t vn = -1;
+        bool valid = Resolve(in.v, (in.relative & kRelativeV) != 0,
+                             v_offset[c], n_positions, &v);
+        if (in.vt != -1 || (in.relative & kRelativeVt) != 0) {
+          valid &= Resolve(in.vt, (in.relative & kRelativeVt) != 0,
+                           vt_offset[c], vt_offset.back(), &vt);
+        }
+        if (in.vn != -1 || (in.relative & kRelativeVn) != 0) {
+          valid &= Resolve(in.vn, (in.relative & kRelativeVn) != 0,
+                           vn_offset[c], vn_offset.back(), &vn);
+        }
+        if (!valid) {
+          for (const Vertex* x : *vertices) {
+            delete x;
+          }
+          delete vertices;
+          LOG_ERROR("obj face index out of range in {}", filepath.string());
+          throw MeshImportException();
+        }
+
+        int64_t vertex = first_with_position[v];
+        while (vertex != -1 && vertex_uv[vertex] != vt) {
+          vertex = next_with_position[vertex];
+        }
+        if (vertex == -1) {
+          vertex = static_cast<int64_t>(vertices->size());
+          const glm::vec3 position =
+              element(&ObjChunk::positions, v, v_offset);
+          const glm::vec2 uv = (vt == -1)
+                                   ? glm::vec2(0.0F, 0.0F)
+                                   : element(&ObjChunk::uvs, vt, vt_offset);
+          const glm::vec3 normal =
+              (vn == -1) ? glm::vec3(0.0F, 0.0F, 0.0F)
+                         : element(&ObjChunk::normals, vn, vn_offset);
+          vertices->push_back(new Vertex(position, normal, uv));
+          next_with_position.push_back(first_with_position[v]);
+          vertex_uv.push_back(vt);
+          first_with_position[v] = vertex;
+        }
+        has_normals |= (vn != -1);
+        indices.push_back(static_cast<unsigned int>(vertex));
+      }
+      face_starts.push_back(static_cast<unsigned int>(indices.size()));
+    }
+  }
+
+  if (opts.triangulate) {
+    TriangulateFaces(&indices, &face_starts);
+  }
+  const std::size_t n_vertices = vertices->size();
+  if (opts.weld_vertices) {
+    WeldVertices(vertices, &indices, &face_starts);
+  }
+  ImportedMesh mesh;
+  mesh.type = FacesType(face_starts);
+  mesh.hf_data = BuildHalfEdgeData(vertices, indices, face_starts);
+  if (!has_normals) {
+    mesh.hf_data->ShadeSmooth();
+  }
+  mesh.material = LoadMaterial(filepath, mtllib, usemtl, &mesh.textures);
+
+  LOG_INFO(
+      "obj {}: {} vertices, {} faces, {} chunks (parsed in {:.3f} ms, {:.3f} "
+      "ms total)",
+      filepath.filename().string(), n_vertices, face_starts.size() - 1,
+      chunks.size(), parse_ms,
+      std::chrono::duration<double, std::milli>(obj_clock::now() - start)
+          .count());
+
+  return {mesh};
+}
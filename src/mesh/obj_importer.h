@@ -0,0 +1,32 @@
+#ifndef OBJ_IMPORTER_H
+#define OBJ_IMPORTER_H
+
+#include <filesystem>
+
+#include "mesh.h"
+#include "importer.h"
+
+// Native importer for wavefront .obj files, meant for the single mesh models
+// that get subdivided (it always returns one mesh, with the material of the
+// first usemtl).
+// The file is memory mapped and split into line aligned chunks that are
+// parsed in parallel (v, vt, vn and f records, everything else is ignored),
+// then the chunks are merged in file order so the result does not depend on
+// the number of threads. Faces keep their number of sides unless
+// Options::triangulate is set.
+// A vertex is made for every distinct position/uv pair (so uv seams become
+// boundaries), normals are taken from the first corner that uses the vertex
+class ObjImporter : public IImporter {
+ public:
+  ObjImporter() = default;
+  ObjImporter(const ObjImporter& other) = delete;
+  ObjImporter& operator=(const ObjImporter& other) = delete;
+  ObjImporter(ObjImporter&& other) = delete;
+  ObjImporter&& operator=(ObjImporter&& other) = delete;
+  ~ObjImporter() = default;
+
+  std::vector<ImportedMesh> read(const std::filesystem::path& filepath,
+                                 const Options& opts = Options()) override;
+};
+
+#endif  // OBJ_IMPORTER_H
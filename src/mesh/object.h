@@ -1,6 +1,9 @@
 #ifndef OBJECT_H
 #define OBJECT_H
 
+#include <memory>
+
+#include "../render_queue.h"
 #include "../shader.h"
 #include "../transform.h"
 #include "../subdiv/subdivision.h"
@@ -10,8 +13,15 @@ class IRenderableObject {
   virtual ~IRenderableObject() = 0;
   [[nodiscard]] virtual IRenderableObject* clone() = 0;
 
-  virtual void Draw() const = 0;
+  // adds the meshes to draw this frame to the queue, the renderer sorts and
+  // draws them
+  virtual void Submit(RenderQueue* queue) const = 0;
+  // called every frame before Submit(), objects with levels of detail pick the
+  // one to draw
+  virtual void SelectLOD(const glm::vec3& camera_position) = 0;
   [[nodiscard]] virtual const Shader* GetShader() const = 0;
+  // in model space, of what Submit() would draw
+  [[nodiscard]] virtual BoundingVolume bounds() const = 0;
   virtual void SetRenderSettings() const = 0;
   virtual void ShowSettingsGUI() = 0;
   [[nodiscard]] virtual const Transform& transform() const = 0;
@@ -29,8 +39,10 @@ class Terrain final : public IRenderableObject {
   ~Terrain();
   [[nodiscard]] Terrain* clone() override;
 
-  void Draw() const override;
+  void Submit(RenderQueue* queue) const override;
+  void SelectLOD(const glm::vec3& camera_position) override;
   [[nodiscard]] const Shader* GetShader() const override;
+  [[nodiscard]] BoundingVolume bounds() const override;
   void SetRenderSettings() const override;
   void ShowSettingsGUI() override;
   const Transform& transform() const override;
@@ -48,7 +60,11 @@ class Terrain final : public IRenderableObject {
   const Shader* shader_;
 };
 
-// A Static Model composed of multiple meshes
+// A Static Model composed of multiple meshes. The clones share the meshes
+// (they never change), each one just has its own transform.
+// The meshes with the same patch size can be copied in one vertex and index
+// buffer (merge_buffers()), then they only differ by their index range and the
+// queue draws all of them with one multi draw
 class StaticModel final : public IRenderableObject {
  public:
   StaticModel(const std::string& name, const std::vector<IMesh*>& model,
@@ -56,8 +72,10 @@ class StaticModel final : public IRenderableObject {
   ~StaticModel();
   [[nodiscard]] StaticModel* clone() override;
 
-  void Draw() const override;
+  void Submit(RenderQueue* queue) const override;
+  void SelectLOD(const glm::vec3& camera_position) override;
   [[nodiscard]] const Shader* GetShader() const override;
+  [[nodiscard]] BoundingVolume bounds() const override;
   void SetRenderSettings() const override;
   void ShowSettingsGUI() override;
   [[nodiscard]] const Transform& transform() const override;
@@ -66,10 +84,44 @@ class StaticModel final : public IRenderableObject {
   [[nodiscard]] const std::string& name() const override;
   void name(const std::string& name) override;
 
+  [[nodiscard]] bool merge_buffers() const;
+  void merge_buffers(bool merge);
+
  private:
+  // a clone of other with its own name, sharing its meshes
+  StaticModel(const std::string& name, const StaticModel& other);
+
+  // copies of the buffers of the meshes, one VAO per patch size
+  struct MergedBuffers {
+    struct Group {
+      GLuint vao;
+      GLuint vbo;
+      GLuint ibo;
+    };
+    // where a mesh is in its group
+    struct Range {
+      std::size_t group;
+      GLuint first_index;
+      GLint base_vertex;
+    };
+
+    explicit MergedBuffers(const std::vector<std::shared_ptr<IMesh>>& meshes);
+    ~MergedBuffers();
+    MergedBuffers(const MergedBuffers& other) = delete;
+    MergedBuffers& operator=(const MergedBuffers& other) = delete;
+    MergedBuffers(MergedBuffers&& other) = delete;
+    MergedBuffers& operator=(MergedBuffers&& other) = delete;
+
+    std::vector<Group> groups;
+    // one for each mesh of the model
+    std::vector<Range> ranges;
+  };
+
   std::string name_;
   std::filesystem::path model_path_;
-  std::vector<IMesh*> model_;
+  std::vector<std::shared_ptr<IMesh>> model_;
+  // shared with the clones like the meshes, nullptr if not merged
+  std::shared_ptr<const MergedBuffers> merged_;
   Transform transform_;
   // Not owning
   const Shader* shader_;
@@ -78,15 +130,20 @@ class StaticModel final : public IRenderableObject {
 };
 
 // A Model that also supports uniform subdivision (because there is only one
-// mesh). Owns and deletes a SubDiv Strategy
+// mesh). Owns and deletes a SubDiv Strategy.
+// The meshes are shared with the clones (same GPU buffers, so the renderer
+// draws them as instances of one mesh) until one of them subdivides, remeshes
+// or decimates: the new meshes are only its own
 class SubDivMesh final : public IRenderableObject {
  public:
   SubDivMesh(const std::string& name, IMesh* model, const Shader* shader);
   ~SubDivMesh();
   [[nodiscard]] SubDivMesh* clone() override;
 
-  void Draw() const override;
+  void Submit(RenderQueue* queue) const override;
+  void SelectLOD(const glm::vec3& camera_position) override;
   [[nodiscard]] const Shader* GetShader() const override;
+  [[nodiscard]] BoundingVolume bounds() const override;
   void SetRenderSettings() const override;
   void ShowSettingsGUI() override;
   void ApplySmoothShading();
@@ -97,15 +154,18 @@ class SubDivMesh final : public IRenderableObject {
   void name(const std::string& name) override;
 
  private:
+  // a clone of other with its own name, sharing its meshes
+  SubDivMesh(const std::string& name, const SubDivMesh& other);
+
   std::string name_;
   std::filesystem::path model_path_;
   // To submit to the subdivision algorithm (it always re-starts from the base
   // model because it's easier)
-  IMesh* base_model_;
-  // Not owning
+  std::shared_ptr<IMesh> base_model_;
+  // Not owning, the program of the base model (see GetShader())
   const Shader* shader_;
   // To be rendered
-  IMesh* subdiv_model_;
+  std::shared_ptr<IMesh> subdiv_model_;
   Transform transform_;
   // To be submitted to subdivision algorithm
   int subdiv_level_;
@@ -116,15 +176,127 @@ class SubDivMesh final : public IRenderableObject {
   sa::SubDiv current_subdiv_algo_;
   ISubdivision* subdiv_strategy_;
   int shading_ui_;
+  // Morton reordering of the halfedge data after every subdivision level
+  bool spatial_reorder_;
+  // isotropic remeshing of base_model_ (only for triangle meshes), the target
+  // edge length is relative to the current mean edge length
+  float remesh_length_ui_;
+  int remesh_iterations_ui_;
+
+  // the mesh actually drawn, subdiv_model_ or one of the LODs
+  [[nodiscard]] IMesh* current_model() const;
+  void ClearLODs();
+  // QEM decimated versions of subdiv_model_ (only for triangle meshes), each
+  // one has lod_ratio_ times the faces of the previous one
+  std::vector<std::shared_ptr<IMesh>> lods_;
+  int lod_count_ui_;
+  float lod_ratio_ui_;
+  // 0 is subdiv_model_, i is lods_[i - 1]
+  int current_lod_;
+  // when enabled the LOD is picked from the camera distance, one level every
+  // lod_distance_step_ units
+  bool lod_by_distance_;
+  float lod_distance_step_;
 };
 
-// Unsupported for now
-// https://hhoppe.com/pvdrpm.pdf
-// Need to learn the method and try to adapt it to the modern rendering pipeline
-// (aka Tessellation shaders or Mesh shaders)
-/*
-class ProgressiveMesh : public IRenderableObject {
+// Progressive mesh (https://hhoppe.com/pm.pdf) of a triangle mesh.
+// The whole collapse sequence is computed once with half-edge collapses
+// (ordered by quadric error), and every collapse is stored as a vertex split
+// record. Half-edge collapses never move a vertex so one vertex buffer works
+// for every LOD. Vertices and faces are sorted so the ones added by the first
+// splits come first, which makes a LOD a prefix of the index buffer with some
+// corners pointing to the parent vertex. Changing LOD only rewrites the
+// corners touched by the applied splits and uploads those index ranges.
+// The clones share all of that (and the vertex buffer), each one only has its
+// own LOD and index buffer
+class ProgressiveMesh final : public IRenderableObject {
+ public:
+  ProgressiveMesh(const std::string& name, TriMesh* model,
+                  const Shader* shader);
+  ~ProgressiveMesh();
+  [[nodiscard]] ProgressiveMesh* clone() override;
+
+  void Submit(RenderQueue* queue) const override;
+  void SelectLOD(const glm::vec3& camera_position) override;
+  [[nodiscard]] const Shader* GetShader() const override;
+  [[nodiscard]] BoundingVolume bounds() const override;
+  void SetRenderSettings() const override;
+  void ShowSettingsGUI() override;
+  [[nodiscard]] const Transform& transform() const override;
+  void transform(const Transform& transform) override;
+
+  [[nodiscard]] const std::string& name() const override;
+  void name(const std::string& name) override;
+
+  [[nodiscard]] int num_faces() const;
+
+ private:
+  struct VertexSplit {
+    unsigned int vertex;        // the vertex added back by the split
+    unsigned int parent;        // the vertex it had been collapsed into
+    unsigned int first_corner;  // its corners are in corners
+    unsigned int num_corners;
+  };
+
+  // the collapse sequence of the base model, it never changes after the
+  // constructor
+  struct Data {
+    // takes ownership of model
+    Data(const std::string& name, TriMesh* model);
+    ~Data();
+    Data(const Data& other) = delete;
+    Data& operator=(const Data& other) = delete;
+    Data(Data&& other) = delete;
+    Data& operator=(Data&& other) = delete;
+
+    TriMesh* base_model;
+    // coarsest to finest
+    std::vector<VertexSplit> splits;
+    // index buffer positions that change with each split
+    std::vector<unsigned int> corners;
+    // the index buffer of the finest mesh, sorted
+    std::vector<unsigned int> indices;
+    int base_faces = 0;
+    // the sorted vertices, the same for every LOD
+    GLuint VBO = 0;
+  };
+
+  // a clone of other with its own name, sharing its data
+  ProgressiveMesh(const std::string& name, const ProgressiveMesh& other);
+
+  // the VAO over the shared vertices and an index buffer of the finest mesh
+  void SetUpVertexArray();
+  // applies (or undoes) splits until level splits are applied, at most
+  // max_splits_per_frame_ at a time
+  void StepTowards(int level);
+  void UploadDirtyRanges();
+
+  std::string name_;
+  // shared with the clones
+  std::shared_ptr<const Data> data_;
+  // Not owning
+  const Shader* shader_;
+  Transform transform_;
+
+  // CPU copy of the index buffer of this object's LOD
+  std::vector<unsigned int> indices_;
+  // index buffer positions changed since the last upload
+  std::vector<unsigned int> dirty_;
+  // number of applied splits
+  int level_;
+
+  GLuint VAO_;
+  GLuint IBO_;
+
+  int target_faces_ui_;
+  // when enabled the face count goes down with the square of the distance
+  // (so it stays about the same on screen) after full_detail_distance_
+  bool lod_by_distance_;
+  float full_detail_distance_;
+  int max_splits_per_frame_;
+  // last upload stats for the UI
+  int uploaded_ranges_;
+  int uploaded_bytes_;
 };
-*/
 
 #endif  // OBJECT_H
@@ -0,0 +1,560 @@
+#include "ply_importer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "../logger.h"
+#include "../mapped_file.h"
+#include "../text_parsing.h"
+#include "../utilities.h"
+
+namespace {
+
+enum class PlyFormat {
+  ASCII,
+  BINARY_LITTLE_ENDIAN,
+  BINARY_BIG_ENDIAN
+};
+
+enum class PlyType {
+  INT8,
+  UINT8,
+  INT16,
+  UINT16,
+  INT32,
+  UINT32,
+  FLOAT32,
+  FLOAT64,
+  INVALID
+};
+
+// what a vertex property is used for
+enum class VertexSlot {
+  X,
+  Y,
+  Z,
+  NX,
+  NY,
+  NZ,
+  U,
+  V,
+  NONE
+};
+
+struct PlyProperty {
+  std::string name;
+  PlyType type;
+  bool is_list;
+  PlyType count_type;  // only for lists
+};
+
+struct PlyElement {
+  std::string name;
+  std::size_t count;
+  std::vector<PlyProperty> properties;
+};
+
+// the arrays the file is parsed into
+struct PlyData {
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec3> normals;
+  std::vector<glm::vec2> uvs;
+  std::vector<unsigned int> indices;
+  // face f uses indices [face_starts[f], face_starts[f + 1])
+  std::vector<unsigned int> face_starts;
+  bool has_normals = false;
+  bool has_uvs = false;
+};
+
+PlyType ParseType(const std::string& name) {
+  if (name == "char" || name == "int8") {
+    return PlyType::INT8;
+  }
+  if (name == "uchar" || name == "uint8") {
+    return PlyType::UINT8;
+  }
+  if (name == "short" || name == "int16") {
+    return PlyType::INT16;
+  }
+  if (name == "ushort" || name == "uint16") {
+    return PlyType::UINT16;
+  }
+  if (name == "int" || name == "int32") {
+    return PlyType::INT32;
+  }
+  if (name == "uint" || name == "uint32") {
+    return PlyType::UINT32;
+  }
+  if (name == "float" || name == "float32") {
+    return PlyType::FLOAT32;
+  }
+  if (name == "double" || name == "float64") {
+    return PlyType::FLOAT64;
+  }
+  return PlyType::INVALID;
+}
+
+std::size_t TypeSize(const PlyType type) {
+  switch (type) {
+    case PlyType::INT8:
+    case PlyType::UINT8:
+      return 1;
+    case PlyType::INT16:
+    case PlyType::UINT16:
+      return 2;
+    case PlyType::INT32:
+    case PlyType::UINT32:
+    case PlyType::FLOAT32:
+      return 4;
+    case PlyType::FLOAT64:
+      return 8;
+    default:
+      throw MeshImportException();
+  }
+}
+
+VertexSlot SlotOf(const std::string& name) {
+  if (name == "x") {
+    return VertexSlot::X;
+  }
+  if (name == "y") {
+    return VertexSlot::Y;
+  }
+  if (name == "z") {
+    return VertexSlot::Z;
+  }
+  if (name == "nx") {
+    return VertexSlot::NX;
+  }
+  if (name == "ny") {
+    return VertexSlot::NY;
+  }
+  if (name == "nz") {
+    return VertexSlot::NZ;
+  }
+  if (name == "u" || name == "s" || name == "texture_u" ||
+      name == "texture_s") {
+    return VertexSlot::U;
+  }
+  if (name == "v" || name == "t" || name == "texture_v" ||
+      name == "texture_t") {
+    return VertexSlot::V;
+  }
+  return VertexSlot::NONE;
+}
+
+bool IsFaceIndexList(const PlyProperty& property) {
+  return property.is_list &&
+         (property.name == "vertex_indices" || property.name == "vertex_index");
+}
+
+// returns the next whitespace separated word of the header line
+std::string NextWord(const char*& p, const char* end) {
+  SkipBlanks(p, end);
+  const char* start = p;
+  while (p < end && !IsBlank(*p) && *p != '\n') {
+    p++;
+  }
+  return std::string(start, p);
+}
+
+// parses the header and moves p to the first byte of the body
+void ParseHeader(const char*& p, const char* end, PlyFormat* format,
+                 std::vector<PlyElement>* elements) {
+  if (NextWord(p, end) != "ply") {
+    LOG_ERROR("not a ply file");
+    throw MeshImportException();
+  }
+  SkipLine(p, end);
+
+  bool has_format = false;
+  while (p < end) {
+    const std::string keyword = NextWord(p, end);
+    if (keyword == "format") {
+      const std::string name = NextWord(p, end);
+      if (name == "ascii") {
+        *format = PlyFormat::ASCII;
+      } else if (name == "binary_little_endian") {
+        *format = PlyFormat::BINARY_LITTLE_ENDIAN;
+      } else if (name == "binary_big_endian") {
+        *format = PlyFormat::BINARY_BIG_ENDIAN;
+      } else {
+        LOG_ERROR("unknown ply format {}", name);
+        throw MeshImportException();
+      }
+      has_format = true;
+    } else if (keyword == "element") {
+      PlyElement element;
+      element.name = NextWord(p, end);
+      uint64_t count = 0;
+      if (!ParseUint(p, end, &count)) {
+        LOG_ERROR("missing count for ply element {}", element.name);
+        throw MeshImportException();
+      }
+      element.count = count;
+      elements->push_back(element);
+    } else if (keyword == "property") {
+      if (elements->empty()) {
+        LOG_ERROR("ply property outside of an element");
+        throw MeshImportException();
+      }
+      PlyProperty property;
+      std::string type = NextWord(p, end);
+      property.is_list = (type == "list");
+      property.count_type = PlyType::INVALID;
+      if (property.is_list) {
+        property.count_type = ParseType(NextWord(p, end));
+        type = NextWord(p, end);
+      }
+      property.type = ParseType(type);
+      property.name = NextWord(p, end);
+      if (property.type == PlyType::INVALID ||
+          (property.is_list && property.count_type == PlyType::INVALID)) {
+        LOG_ERROR("unknown type for ply property {}", property.name);
+        throw MeshImportException();
+      }
+      elements->back().properties.push_back(property);
+    } else if (keyword == "end_header") {
+      SkipLine(p, end);
+      if (!has_format) {
+        LOG_ERROR("ply file without format");
+        throw MeshImportException();
+      }
+      return;
+    }
+    // comment, obj_info and empty lines
+    SkipLine(p, end);
+  }
+
+  LOG_ERROR("ply header without end_header");
+  throw MeshImportException();
+}
+
+// --- binary
+
+bool IsHostLittleEndian() {
+  const uint16_t x = 1;
+  uint8_t first_byte = 0;
+  std::memcpy(&first_byte, &x, 1);
+  return first_byte == 1;
+}
+
+template <typename T>
+T Load(const char* p, const bool swap) {
+  T value;
+  if (swap) {
+    char bytes[sizeof(T)];
+    for (std::size_t i = 0; i < sizeof(T); i++) {
+      bytes[i] = p[sizeof(T) - 1 - i];
+    }
+    std::memcpy(&value, bytes, sizeof(T));
+  } else {
+    std::memcpy(&value, p, sizeof(T));
+  }
+  return value;
+}
+
+double LoadScalar(const char* p, const PlyType type, const bool swap) {
+  switch (type) {
+    case PlyType::INT8:
+      return Load<int8_t>(p, swap);
+    case PlyType::UINT8:
+      return Load<uint8_t>(p, swap);
+    case PlyType::INT16:
+      return Load<int16_t>(p, swap);
+    case PlyType::UINT16:
+      return Load<uint16_t>(p, swap);
+    case PlyType::INT32:
+      return Load<int32_t>(p, swap);
+    case PlyType::UINT32:
+      return Load<uint32_t>(p, swap);
+    case PlyType::FLOAT32:
+      return Load<float>(p, swap);
+    case PlyType::FLOAT64:
+      return Load<double>(p, swap);
+    default:
+      throw MeshImportException();
+  }
+}
+
+// the binary reader keeps track of the end so that a truncated file throws
+// instead of reading past the mapping
+class BinaryReader {
+ public:
+  BinaryReader(const char* p, const char* end, bool swap)
+      : p_(p), end_(end), swap_(swap) {}
+
+  double Read(const PlyType type) {
+    const std::size_t size = TypeSize(type);
+    Require(size);
+    const double value = LoadScalar(p_, type, swap_);
+    p_ += size;
+    return value;
+  }
+
+  void Skip(const std::size_t bytes) {
+    Require(bytes);
+    p_ += bytes;
+  }
+
+  void Require(const std::size_t bytes) const {
+    if (static_cast<std::size_t>(end_ - p_) < bytes) {
+      LOG_ERROR("truncated ply file");
+      throw MeshImportException();
+    }
+  }
+
+  [[nodiscard]] const char* position() const { return p_; }
+
+ private:
+  const char* p_;
+  const char* end_;
+  bool swap_;
+};
+
+void ReadVertexBinary(BinaryReader* in, const PlyElement& element,
+                      const std::vector<VertexSlot>& slots, PlyData* out) {
+  float values[8];
+  for (std::size_t i = 0; i < element.count; i++) {
+    std::fill(std::begin(values), std::end(values), 0.0F);
+    for (std::size_t k = 0; k < element.properties.size(); k++) {
+      const PlyProperty& property = element.properties[k];
+      if (property.is_list) {
+        const std::size_t n =
+            static_cast<std::size_t>(in->Read(property.count_type));
+        in->Skip(n * TypeSize(property.type));
+      } else if (slots[k] == VertexSlot::NONE) {
+        in->Skip(TypeSize(property.type));
+      } else {
+        values[to_underlying(slots[k])] =
+            static_cast<float>(in->Read(property.type));
+      }
+    }
+
+    out->positions.emplace_back(values[0], values[1], values[2]);
+    out->normals.emplace_back(values[3], values[4], values[5]);
+    out->uvs.emplace_back(values[6], values[7]);
+  }
+}
+
+void ReadFaceBinary(BinaryReader* in, const PlyElement& element,
+                    PlyData* out) {
+  for (std::size_t i = 0; i < element.count; i++) {
+    for (const PlyProperty& property : element.properties) {
+      if (!property.is_list) {
+        in->Skip(TypeSize(property.type));
+        continue;
+      }
+      const std::size_t n =
+          static_cast<std::size_t>(in->Read(property.count_type));
+      if (!IsFaceIndexList(property)) {
+        in->Skip(n * TypeSize(property.type));
+        continue;
+      }
+      for (std::size_t j = 0; j < n; j++) {
+        out->indices.push_back(
+            static_cast<unsigned int>(in->Read(property.type)));
+      }
+      out->face_starts.push_back(
+          static_cast<unsigned int>(out->indices.size()));
+    }
+  }
+}
+
+void SkipElementBinary(BinaryReader* in, const PlyElement& element) {
+  for (std::size_t i = 0; i < element.count; i++) {
+    for (const PlyProperty& property : element.properties) {
+      if (property.is_list) {
+        const std::size_t n =
+            static_cast<std::size_t>(in->Read(property.count_type));
+        in->Skip(n * TypeSize(property.type));
+      } else {
+        in->Skip(TypeSize(property.type));
+      }
+    }
+  }
+}
+
+// --- ascii (one element per line)
+
+void ReadVertexAscii(const char*& p, const char* end,
+                     const PlyElement& element,
+                     const std::vector<VertexSlot>& slots, PlyData* out) {
+  float values[8];
+  for (std::size_t i = 0; i < element.count; i++) {
+    std::fill(std::begin(values), std::end(values), 0.0F);
+    for (std::size_t k = 0; k < element.properties.size(); k++) {
+      const PlyProperty& property = element.properties[k];
+      if (property.is_list) {
+        break;  // the rest of the line is skipped anyway
+      }
+      float value = 0.0F;
+      if (!ParseFloat(p, end, &value)) {
+        LOG_ERROR("invalid ply vertex {}", i);
+        throw MeshImportException();
+      }
+      if (slots[k] != VertexSlot::NONE) {
+        values[to_underlying(slots[k])] = value;
+      }
+    }
+    SkipLine(p, end);
+
+    out->positions.emplace_back(values[0], values[1], values[2]);
+    out->normals.emplace_back(values[3], values[4], values[5]);
+    out->uvs.emplace_back(values[6], values[7]);
+  }
+}
+
+void ReadFaceAscii(const char*& p, const char* end, const PlyElement& element,
+                   PlyData* out) {
+  for (std::size_t i = 0; i < element.count; i++) {
+    for (const PlyProperty& property : element.properties) {
+      if (!property.is_list) {
+        float ignored = 0.0F;
+        ParseFloat(p, end, &ignored);
+        continue;
+      }
+      uint64_t n = 0;
+      if (!ParseUint(p, end, &n)) {
+        LOG_ERROR("invalid ply face {}", i);
+        throw MeshImportException();
+      }
+      for (uint64_t j = 0; j < n; j++) {
+        int64_t index = 0;
+        if (!ParseInt(p, end, &index)) {
+          LOG_ERROR("invalid ply face {}", i);
+          throw MeshImportException();
+        }
+        if (IsFaceIndexList(property)) {
+          out->indices.push_back(static_cast<unsigned int>(index));
+        }
+      }
+      if (IsFaceIndexList(property)) {
+        out->face_starts.push_back(
+            static_cast<unsigned int>(out->indices.size()));
+      }
+    }
+    SkipLine(p, end);
+  }
+}
+
+}  // namespace
+
+std::vector<ImportedMesh> PlyImporter::read(
+    const std::filesystem::path& filepath, const Options& opts) {
+  using ply_clock = std::chrono::steady_clock;
+  const ply_clock::time_point start = ply_clock::now();
+
+  const MappedFile file(filepath);
+  const char* p = file.data();
+  const char* end = p + file.size();
+
+  PlyFormat format = PlyFormat::ASCII;
+  std::vector<PlyElement> elements;
+  ParseHeader(p, end, &format, &elements);
+
+  const bool swap =
+      (format == PlyFormat::BINARY_LITTLE_ENDIAN && !IsHostLittleEndian()) ||
+      (format == PlyFormat::BINARY_BIG_ENDIAN && IsHostLittleEndian());
+  BinaryReader binary(p, end, swap);
+
+  PlyData data;
+  data.face_starts.push_back(0);
+
+  for (const PlyElement& element : elements) {
+    if (element.name == "vertex") {
+      std::vector<VertexSlot> slots;
+      for (const PlyProperty& property : element.properties) {
+        const VertexSlot slot =
+            property.is_list ? VertexSlot::NONE : SlotOf(property.name);
+        data.has_normals |= (slot == VertexSlot::NX);
+        data.has_uvs |= (slot == VertexSlot::U);
+        slots.push_back(slot);
+      }
+      data.positions.reserve(element.count);
+      data.normals.reserve(element.count);
+      data.uvs.reserve(element.count);
+      if (format == PlyFormat::ASCII) {
+        ReadVertexAscii(p, end, element, slots, &data);
+      } else {
+        ReadVertexBinary(&binary, element, slots, &data);
+      }
+    } else if (element.name == "face") {
+      data.face_starts.reserve(element.count + 1);
+      data.indices.reserve(element.count * 3);
+      if (format == PlyFormat::ASCII) {
+        ReadFaceAscii(p, end, element, &data);
+      } else {
+        ReadFaceBinary(&binary, element, &data);
+      }
+    } else if (format == PlyFormat::ASCII) {
+      for (std::size_t i = 0; i < element.count; i++) {
+        SkipLine(p, end);
+      }
+    } else {
+      SkipElementBinary(&binary, element);
+    }
+  }
+
+  if (data.face_starts.size() == 1) {
+    LOG_ERROR("ply file without faces {}", filepath.string());
+    throw MeshImportException();
+  }
+  for (std::size_t f = 0; f + 1 < data.face_starts.size(); f++) {
+    if (data.face_starts[f + 1] - data.face_starts[f] < 3) {
+      LOG_ERROR("ply face {} has less than 3 vertices", f);
+      throw MeshImportException();
+    }
+  }
+  for (const unsigned int index : data.indices) {
+    if (index >= data.positions.size()) {
+      LOG_ERROR("ply face index {} out of range", index);
+      throw MeshImportException();
+    }
+  }
+
+  if (opts.triangulate) {
+    TriangulateFaces(&data.indices, &data.face_starts);
+  }
+  const std::size_t n_faces = data.face_starts.size() - 1;
+
+  const double parse_ms =
+      std::chrono::duration<double, std::milli>(ply_clock::now() - start)
+          .count();
+
+  std::vector<Vertex*>* vertices = new std::vector<Vertex*>();
+  vertices->reserve(data.positions.size());
+  for (std::size_t i = 0; i < data.positions.size(); i++) {
+    vertices->push_back(
+        new Vertex(data.positions[i], data.normals[i], data.uvs[i]));
+  }
+  if (opts.weld_vertices) {
+    WeldVertices(vertices, &data.indices, &data.face_starts);
+  }
+  HalfEdgeData* hfd =
+      BuildHalfEdgeData(vertices, data.indices, data.face_starts);
+
+  if (!data.has_normals) {
+    hfd->ShadeSmooth();
+  }
+
+  ImportedMesh mesh;
+  mesh.type = FacesType(data.face_starts);
+  mesh.hf_data = hfd;
+  // ply files have no materials, just the default one
+  mesh.material = new Material();
+  mesh.textures.push_back(DecodeDefaultTexture(TEXTURE_TYPE::DIFFUSE));
+
+  LOG_INFO(
+      "ply {}: {} vertices, {} faces (parsed in {:.3f} ms, {:.3f} ms total)",
+      filepath.filename().string(), data.positions.size(), n_faces, parse_ms,
+      std::chrono::duration<double, std::milli>(ply_clock::now() - start)
+          .count());
+
+  return {mesh};
+}
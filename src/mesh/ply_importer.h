@@ -0,0 +1,30 @@
+#ifndef PLY_IMPORTER_H
+#define PLY_IMPORTER_H
+
+#include <filesystem>
+
+#include "mesh.h"
+#include "importer.h"
+
+// Native importer for .ply files (ascii, binary little endian and binary big
+// endian) https://paulbourke.net/dataformats/ply/
+// The file is memory mapped and parsed straight into position/normal/uv arrays
+// and an index buffer, which are handed to BuildHalfEdgeData() without going
+// through an intermediate scene. Only the "vertex" (x, y, z, nx, ny, nz and
+// u, v / s, t / texture_u, texture_v) and "face" (vertex_indices) elements are
+// used, everything else in the file is skipped.
+// Always returns one mesh
+class PlyImporter : public IImporter {
+ public:
+  PlyImporter() = default;
+  PlyImporter(const PlyImporter& other) = delete;
+  PlyImporter& operator=(const PlyImporter& other) = delete;
+  PlyImporter(PlyImporter&& other) = delete;
+  PlyImporter&& operator=(PlyImporter&& other) = delete;
+  ~PlyImporter() = default;
+
+  std::vector<ImportedMesh> read(const std::filesystem::path& filepath,
+                                 const Options& opts = Options()) override;
+};
+
+#endif  // PLY_IMPORTER_H
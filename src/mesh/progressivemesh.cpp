@@ -0,0 +1,387 @@
+#include "object.h"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+#include <imgui.h>
+
+#include "../logger.h"
+#include "../utilities.h"
+#include "decimation.h"
+
+ProgressiveMesh::ProgressiveMesh(const std::string& name, TriMesh* model,
+                                 const Shader* shader)
+    : name_("Progressive | " + name),
+      data_(std::make_shared<const Data>(name_, model)),
+      shader_(shader),
+      level_(0),
+      VAO_(0),
+      IBO_(0),
+      target_faces_ui_(0),
+      lod_by_distance_(false),
+      full_detail_distance_(10.0F),
+      max_splits_per_frame_(500),
+      uploaded_ranges_(0),
+      uploaded_bytes_(0) {
+  LOG_TRACE("ProgressiveMesh(const std::string&, TriMesh*, const Shader*)");
+
+  SetUpVertexArray();
+  target_faces_ui_ = num_faces();
+}
+
+ProgressiveMesh::ProgressiveMesh(const std::string& name,
+                                 const ProgressiveMesh& other)
+    : name_("Progressive | " + name),
+      data_(other.data_),
+      shader_(other.shader_),
+      transform_(other.transform_),
+      level_(0),
+      VAO_(0),
+      IBO_(0),
+      target_faces_ui_(other.target_faces_ui_),
+      lod_by_distance_(other.lod_by_distance_),
+      full_detail_distance_(other.full_detail_distance_),
+      max_splits_per_frame_(other.max_splits_per_frame_),
+      uploaded_ranges_(0),
+      uploaded_bytes_(0) {
+  LOG_TRACE("ProgressiveMesh(const std::string&, const ProgressiveMesh&)");
+
+  SetUpVertexArray();
+}
+
+ProgressiveMesh::~ProgressiveMesh() {
+  LOG_TRACE("~ProgressiveMesh()");
+  glDeleteBuffers(1, &IBO_);
+  glDeleteVertexArrays(1, &VAO_);
+}
+
+static int counter = 0;
+ProgressiveMesh* ProgressiveMesh::clone() {
+  counter++;
+
+  return new ProgressiveMesh(name_.substr(14) + " - " + std::to_string(counter),
+                             *this);
+}
+
+ProgressiveMesh::Data::Data(const std::string& name, TriMesh* model)
+    : base_model(model) {
+  const auto start = std::chrono::steady_clock::now();
+
+  HalfEdgeData work(*base_model->half_edge_data());
+  // the normals of the finest mesh are used for every LOD
+  work.ShadeSmooth();
+
+  // (decimation compacts these vectors, only use them before it runs)
+  const std::vector<Vertex*>& verts = *work.vertices();
+  const std::vector<Face*>& faces = *work.faces();
+  const unsigned int n_vertices = verts.size();
+  const unsigned int n_faces = faces.size();
+
+  std::unordered_map<const Vertex*, unsigned int> vertex_id;
+  std::vector<Vertex> vertices;
+  vertices.reserve(verts.size());
+  for (unsigned int i = 0; i < verts.size(); i++) {
+    vertex_id[verts[i]] = i;
+    vertices.push_back(*verts[i]);
+  }
+
+  // a corner is a halfedge (it stands for the vertex it points to), its id is
+  // its position in the unsorted index buffer
+  std::unordered_map<const HalfEdge*, unsigned int> corner_id;
+  std::vector<unsigned int> corner_vertex(faces.size() * 3);
+  for (unsigned int f = 0; f < faces.size(); f++) {
+    const HalfEdge* he = faces[f]->halfedge;
+    for (unsigned int k = 0; k < 3; k++) {
+      corner_id[he] = f * 3 + k;
+      corner_vertex[f * 3 + k] = vertex_id[he->vert];
+      he = he->next;
+    }
+  }
+
+  // recorded in collapse order (finest to coarsest), with unsorted ids
+  std::vector<VertexSplit> collapses;
+  std::vector<unsigned int> collapse_corners;
+  std::vector<unsigned int> removed_faces;
+
+  QEMDecimation decimation;
+  decimation.fixed_vertices(true);
+  decimation.Decimate(&work, 0, [&](const HalfEdge* he) {
+    const Vertex* a = he->twin->vert;
+    const Face* f0 = he->face;
+    const Face* f1 = he->twin->face;
+    VertexSplit collapse = {
+        vertex_id[a], vertex_id[he->vert],
+        static_cast<unsigned int>(collapse_corners.size()), 0};
+
+    // every corner at a (outside of the two removed faces) will point to b
+    // after the collapse, a is always interior
+    const HalfEdge* curr = a->halfedge;
+    do {
+      const HalfEdge* incoming = curr->twin;
+      if (incoming->face != f0 && incoming->face != f1) {
+        collapse_corners.push_back(corner_id[incoming]);
+        collapse.num_corners++;
+      }
+      curr = curr->twin->next;
+    } while (curr != a->halfedge);
+
+    removed_faces.push_back(corner_id[he] / 3);
+    removed_faces.push_back(corner_id[he->twin] / 3);
+    collapses.push_back(collapse);
+  });
+
+  const unsigned int n_collapses = collapses.size();
+  base_faces = static_cast<int>(n_faces - 2 * n_collapses);
+
+  // the surviving vertices and faces first, then the ones removed by the last
+  // collapse and so on
+  std::vector<unsigned int> new_vertex(n_vertices, 0);
+  std::vector<bool> removed(n_vertices, false);
+  for (const VertexSplit& c : collapses) {
+    removed[c.vertex] = true;
+  }
+  unsigned int next = 0;
+  for (unsigned int i = 0; i < n_vertices; i++) {
+    if (!removed[i]) {
+      new_vertex[i] = next++;
+    }
+  }
+  for (unsigned int i = n_collapses; i-- > 0;) {
+    new_vertex[collapses[i].vertex] = next++;
+  }
+
+  std::vector<unsigned int> new_face(n_faces, 0);
+  std::vector<bool> removed_face(n_faces, false);
+  for (const unsigned int f : removed_faces) {
+    removed_face[f] = true;
+  }
+  next = 0;
+  for (unsigned int f = 0; f < n_faces; f++) {
+    if (!removed_face[f]) {
+      new_face[f] = next++;
+    }
+  }
+  for (unsigned int i = n_collapses; i-- > 0;) {
+    new_face[removed_faces[2 * i]] = next++;
+    new_face[removed_faces[2 * i + 1]] = next++;
+  }
+
+  auto sorted_corner = [&new_face](unsigned int corner) {
+    return new_face[corner / 3] * 3 + corner % 3;
+  };
+
+  indices.assign(n_faces * 3, 0);
+  for (unsigned int c = 0; c < corner_vertex.size(); c++) {
+    indices[sorted_corner(c)] = new_vertex[corner_vertex[c]];
+  }
+
+  std::vector<Vertex> sorted_vertices(vertices.size());
+  for (unsigned int i = 0; i < vertices.size(); i++) {
+    sorted_vertices[new_vertex[i]] = vertices[i];
+  }
+
+  splits.reserve(n_collapses);
+  corners.reserve(collapse_corners.size());
+  for (unsigned int i = n_collapses; i-- > 0;) {
+    const VertexSplit& c = collapses[i];
+    splits.push_back({new_vertex[c.vertex], new_vertex[c.parent],
+                      static_cast<unsigned int>(corners.size()),
+                      c.num_corners});
+    for (unsigned int j = 0; j < c.num_corners; j++) {
+      corners.push_back(sorted_corner(collapse_corners[c.first_corner + j]));
+    }
+  }
+
+  glGenBuffers(1, &VBO);
+  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * sorted_vertices.size(),
+               sorted_vertices.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  const auto end = std::chrono::steady_clock::now();
+  LOG_INFO(
+      "progressive mesh {}: {} vertex splits ({} corners), base mesh {} "
+      "faces, built in {:.3f} ms",
+      name, splits.size(), corners.size(), base_faces,
+      std::chrono::duration<double, std::milli>(end - start).count());
+}
+
+ProgressiveMesh::Data::~Data() {
+  glDeleteBuffers(1, &VBO);
+  delete base_model;
+}
+
+void ProgressiveMesh::SetUpVertexArray() {
+  // the index buffer holds the finest mesh
+  indices_ = data_->indices;
+  level_ = static_cast<int>(data_->splits.size());
+
+  glGenVertexArrays(1, &VAO_);
+  glBindVertexArray(VAO_);
+
+  glBindBuffer(GL_ARRAY_BUFFER, data_->VBO);
+  glVertexAttribPointer(to_underlying(ATTRIB_ID::POSITIONS), 3, GL_FLOAT,
+                        GL_FALSE, sizeof(Vertex),
+                        (GLvoid*)offsetof(struct Vertex, position));
+  glVertexAttribPointer(to_underlying(ATTRIB_ID::NORMALS), 3, GL_FLOAT,
+                        GL_FALSE, sizeof(Vertex),
+                        (GLvoid*)offsetof(struct Vertex, normal));
+  glVertexAttribPointer(to_underlying(ATTRIB_ID::TEXTURE_COORDS), 2, GL_FLOAT,
+                        GL_FALSE, sizeof(Vertex),
+                        (GLvoid*)offsetof(struct Vertex, text_coords));
+  // the enabled arrays are part of the VAO state, once is enough
+  glEnableVertexAttribArray(to_underlying(ATTRIB_ID::POSITIONS));
+  glEnableVertexAttribArray(to_underlying(ATTRIB_ID::NORMALS));
+  glEnableVertexAttribArray(to_underlying(ATTRIB_ID::TEXTURE_COORDS));
+
+  glGenBuffers(1, &IBO_);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO_);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices_.size(),
+               indices_.data(), GL_DYNAMIC_DRAW);
+  glBindVertexArray(0);
+}
+
+void ProgressiveMesh::StepTowards(const int level) {
+  int steps = 0;
+  while (level_ < level && steps < max_splits_per_frame_) {
+    const VertexSplit& s = data_->splits[level_];
+    for (unsigned int i = 0; i < s.num_corners; i++) {
+      const unsigned int corner = data_->corners[s.first_corner + i];
+      indices_[corner] = s.vertex;
+      dirty_.push_back(corner);
+    }
+    level_++;
+    steps++;
+  }
+  while (level_ > level && steps < max_splits_per_frame_) {
+    level_--;
+    const VertexSplit& s = data_->splits[level_];
+    for (unsigned int i = 0; i < s.num_corners; i++) {
+      const unsigned int corner = data_->corners[s.first_corner + i];
+      indices_[corner] = s.parent;
+      dirty_.push_back(corner);
+    }
+    steps++;
+  }
+}
+
+void ProgressiveMesh::UploadDirtyRanges() {
+  if (dirty_.empty()) {
+    return;
+  }
+
+  std::sort(dirty_.begin(), dirty_.end());
+  dirty_.erase(std::unique(dirty_.begin(), dirty_.end()), dirty_.end());
+
+  // close corners are merged in one range, re-uploading a few unchanged
+  // indices is cheaper than one more call
+  constexpr unsigned int kMaxGap = 16;
+
+  uploaded_ranges_ = 0;
+  uploaded_bytes_ = 0;
+  glBindVertexArray(VAO_);
+  std::size_t i = 0;
+  while (i < dirty_.size()) {
+    const unsigned int first = dirty_[i];
+    unsigned int last = first;
+    while (i + 1 < dirty_.size() && dirty_[i + 1] - last <= kMaxGap) {
+      last = dirty_[++i];
+    }
+    i++;
+
+    const GLsizeiptr size = sizeof(unsigned int) * (last - first + 1);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * first,
+                    size, &indices_[first]);
+    uploaded_ranges_++;
+    uploaded_bytes_ += static_cast<int>(size);
+  }
+  glBindVertexArray(0);
+
+  dirty_.clear();
+}
+
+int ProgressiveMesh::num_faces() const {
+  return data_->base_faces + 2 * level_;
+}
+
+void ProgressiveMesh::SelectLOD(const glm::vec3& camera_position) {
+  int target = target_faces_ui_;
+  if (lod_by_distance_) {
+    const glm::vec3 position = glm::vec3(transform_.matrix()[3]);
+    const float distance = glm::length(camera_position - position);
+    float ratio = 1.0F;
+    if (distance > full_detail_distance_) {
+      ratio = full_detail_distance_ / distance;
+      ratio *= ratio;
+    }
+    target = static_cast<int>(ratio * static_cast<float>(indices_.size() / 3));
+  }
+
+  const int level = std::clamp((target - data_->base_faces) / 2, 0,
+                               static_cast<int>(data_->splits.size()));
+  StepTowards(level);
+  UploadDirtyRanges();
+}
+
+BoundingVolume ProgressiveMesh::bounds() const {
+  // the collapses don't move the vertices, the finest mesh contains every LOD.
+  // Its triangles don't, those of the coarse LODs can span the whole mesh
+  BoundingVolume out = data_->base_model->bounds();
+  out.patch_radius = std::max(out.patch_radius, out.radius);
+  return out;
+}
+
+void ProgressiveMesh::Submit(RenderQueue* queue) const {
+  // the faces of the current LOD are a prefix of the index buffer
+  queue->Add(shader_, data_->base_model->material(), VAO_,
+             to_underlying(MESH_TYPE::TRI), num_faces() * 3,
+             transform_.matrix());
+}
+
+void ProgressiveMesh::SetRenderSettings() const {
+  glPatchParameteri(GL_PATCH_VERTICES, to_underlying(MESH_TYPE::TRI));
+}
+
+void ProgressiveMesh::ShowSettingsGUI() {
+  const int total_faces = static_cast<int>(indices_.size() / 3);
+
+  ImGui::Checkbox("LOD by camera distance", &lod_by_distance_);
+  if (lod_by_distance_) {
+    ImGui::SliderFloat("full detail distance", &full_detail_distance_, 1.0F,
+                       100.0F, "%.1f");
+  } else {
+    ImGui::SliderInt("target faces", &target_faces_ui_, data_->base_faces,
+                     total_faces);
+  }
+  ImGui::SliderInt("max vertex splits per frame", &max_splits_per_frame_, 1,
+                   std::max(1, static_cast<int>(data_->splits.size())));
+
+  ImGui::Spacing();
+  ImGui::Text("%d / %d faces (%d of %d vertex splits applied)", num_faces(),
+              total_faces, level_, static_cast<int>(data_->splits.size()));
+  ImGui::Text("last LOD change uploaded %d bytes in %d ranges",
+              uploaded_bytes_, uploaded_ranges_);
+  ImGui::Text("(the whole index buffer is %d bytes)",
+              static_cast<int>(indices_.size() * sizeof(unsigned int)));
+}
+
+const Transform& ProgressiveMesh::transform() const {
+  return transform_;
+}
+
+void ProgressiveMesh::transform(const Transform& transform) {
+  transform_ = transform;
+}
+
+const Shader* ProgressiveMesh::GetShader() const {
+  return shader_;
+}
+
+const std::string& ProgressiveMesh::name() const {
+  return name_;
+}
+
+void ProgressiveMesh::name(const std::string& name) {
+  name_ = name;
+}
@@ -0,0 +1,135 @@
+#include "quadrangulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include "../logger.h"
+
+float TrianglePairing::PairQuality(const HalfEdge* h) {
+  // f0 = (a, b, c) and f1 = (b, a, d) would become the quad (a, d, b, c)
+  const HalfEdge* t = h->twin;
+  const glm::vec3 quad[4] = {
+      t->vert->position,              // a
+      t->next->vert->position,        // d
+      h->vert->position,              // b
+      h->next->vert->position,        // c
+  };
+
+  const glm::vec3 n0 = glm::cross(quad[2] - quad[0], quad[3] - quad[0]);
+  const glm::vec3 n1 = glm::cross(quad[0] - quad[2], quad[1] - quad[2]);
+  const float l0 = glm::length(n0);
+  const float l1 = glm::length(n1);
+  if (l0 == 0.0F || l1 == 0.0F) {
+    return 0.0F;
+  }
+  const float planarity = glm::dot(n0, n1) / (l0 * l1);
+  if (planarity <= 0.0F) {
+    return 0.0F;
+  }
+  const glm::vec3 normal = n0 / l0 + n1 / l1;
+
+  float worst = 1.0F;
+  for (int k = 0; k < 4; k++) {
+    const glm::vec3 prev = quad[(k + 3) % 4] - quad[k];
+    const glm::vec3 next = quad[(k + 1) % 4] - quad[k];
+    // the corner has to turn the same way as the faces, or it's not convex
+    if (glm::dot(glm::cross(next, prev), normal) <= 0.0F) {
+      return 0.0F;
+    }
+    const float cos_angle =
+        glm::dot(prev, next) / (glm::length(prev) * glm::length(next));
+    worst = std::min(worst, 1.0F - std::abs(cos_angle));
+  }
+  return worst * planarity;
+}
+
+int TrianglePairing::Pair(HalfEdgeData* m) const {
+  if (!m->IsValidType(MESH_TYPE::TRI)) {
+    throw std::invalid_argument(
+        "triangle pairing only supports triangle meshes");
+  }
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+
+  std::vector<std::pair<float, Edge*>> candidates;
+  candidates.reserve(m->edges()->size());
+  for (Edge* e : *m->edges()) {
+    if (e->halfedge->IsBoundary()) {
+      continue;
+    }
+    const float quality = PairQuality(e->halfedge);
+    if (quality >= min_quality_) {
+      candidates.emplace_back(quality, e);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const std::pair<float, Edge*>& x,
+               const std::pair<float, Edge*>& y) { return x.first > y.first; });
+
+  int quads = 0;
+  for (const auto& [_, e] : candidates) {
+    HalfEdge* h = e->halfedge;  // a -> b
+    HalfEdge* t = h->twin;      // b -> a
+    Face* f0 = h->face;
+    Face* f1 = t->face;
+    // one of the two was merged already (merged faces are 4 sided)
+    if (h->next->next->next != h || t->next->next->next != t) {
+      continue;
+    }
+    Vertex* a = t->vert;
+    Vertex* b = h->vert;
+    // a vertex with 3 edges would be left with 2, which makes a degenerate
+    // vertex (on a closed mesh) that catmull-clark can't smooth
+    if (!a->IsBoundary() && a->Valence() <= 3) {
+      continue;
+    }
+    if (!b->IsBoundary() && b->Valence() <= 3) {
+      continue;
+    }
+
+    HalfEdge* h1 = h->next;   // b -> c
+    HalfEdge* h2 = h1->next;  // c -> a
+    HalfEdge* t1 = t->next;   // a -> d
+    HalfEdge* t2 = t1->next;  // d -> b
+
+    // f0 becomes (a, d, b, c) and f1 dies
+    h2->next = t1;
+    t1->next = t2;
+    t2->next = h1;
+    t1->face = f0;
+    t2->face = f0;
+    f0->halfedge = h1;
+
+    if (a->halfedge == h) {
+      a->halfedge = t1;
+    }
+    if (b->halfedge == t) {
+      b->halfedge = h1;
+    }
+
+    // same dead marking as HalfEdgeData::Collapse()
+    h->face = nullptr;
+    t->face = nullptr;
+    f1->halfedge = nullptr;
+    e->halfedge = nullptr;
+    quads++;
+  }
+  m->RemoveDeleted();
+
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  LOG_INFO("paired {} quads ({} faces left as triangles) in {:.3f} ms", quads,
+           m->faces()->size() - quads, elapsed.count());
+  return quads;
+}
+
+void TrianglePairing::min_quality(const float quality) {
+  min_quality_ = quality;
+}
+
+float TrianglePairing::min_quality() const {
+  return min_quality_;
+}
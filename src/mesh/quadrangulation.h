@@ -0,0 +1,34 @@
+#ifndef QUADRANGULATION_H
+#define QUADRANGULATION_H
+
+#include "halfedge.h"
+
+// Turns a triangle mesh into a quad dominant one by merging pairs of adjacent
+// triangles (removing the edge between them).
+// Every interior edge gets a score for the quad it would produce, then the
+// edges are taken greedily from the best one, skipping the ones with a face
+// that is already paired. The result is a maximal matching over the edges
+// whose quad is good enough, the triangles left out stay triangles.
+// Catmull-Clark turns a triangle into three quads and a quad into four, so a
+// mostly paired mesh is a lot smaller after the first level than splitting
+// every triangle into quads beforehand (which is a full extra level).
+class TrianglePairing {
+ public:
+  // pairs the triangles of m in place (m must be a triangle mesh), returns the
+  // number of quads created. Throws std::invalid_argument for other meshes
+  int Pair(HalfEdgeData* m) const;
+
+  // in [0, 1], 1 for a planar square, 0 for a degenerate/non convex quad.
+  // It's the worst corner (1 - |cos(angle)|) times how planar the two
+  // triangles are. h must not be on the boundary
+  [[nodiscard]] static float PairQuality(const HalfEdge* h);
+
+  // pairs below this quality are never merged
+  void min_quality(float quality);
+  [[nodiscard]] float min_quality() const;
+
+ private:
+  float min_quality_ = 0.3F;
+};
+
+#endif  // QUADRANGULATION_H
@@ -0,0 +1,461 @@
+#include "remeshing.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "../logger.h"
+#include "../parallel.h"
+
+using remesh_clock = std::chrono::steady_clock;
+
+static double MillisecondsSince(const remesh_clock::time_point& start) {
+  return std::chrono::duration<double, std::milli>(remesh_clock::now() - start)
+      .count();
+}
+
+// number of neighbours of v (works for boundary vertices too)
+static int NeighbourCount(const Vertex* v) {
+  const HalfEdge* curr = v->halfedge;
+  int count = 0;
+  do {
+    count++;
+    if (curr->IsBoundary()) {
+      // go the other way up to the incoming boundary halfedge
+      curr = v->halfedge;
+      while (!curr->Previous()->IsBoundary()) {
+        curr = curr->Previous()->twin;
+        count++;
+      }
+      return count + 1;
+    }
+    curr = curr->twin->next;
+  } while (curr != v->halfedge);
+  return count;
+}
+
+static glm::vec3 TriangleNormal(const glm::vec3& a, const glm::vec3& b,
+                                const glm::vec3& c) {
+  return glm::cross(b - a, c - a);
+}
+
+float IsotropicRemeshing::MeanEdgeLength(const HalfEdgeData* m) {
+  double sum = 0.0;
+  for (const Edge* e : *m->edges()) {
+    const HalfEdge* he = e->halfedge;
+    sum += glm::length(he->vert->position - he->Previous()->vert->position);
+  }
+  return m->edges()->empty() ? 0.0F
+                             : static_cast<float>(sum / m->edges()->size());
+}
+
+float IsotropicRemeshing::RegularVertexRatio(const HalfEdgeData* m) {
+  int interior = 0;
+  int regular = 0;
+  for (const Vertex* v : *m->vertices()) {
+    if (!v->IsBoundary()) {
+      interior++;
+      regular += (v->Valence() == 6) ? 1 : 0;
+    }
+  }
+  return interior == 0 ? 0.0F
+                       : static_cast<float>(regular) /
+                             static_cast<float>(interior);
+}
+
+TriMesh* IsotropicRemeshing::remesh(TriMesh* in, float target_edge_length,
+                                    int iterations) const {
+  HalfEdgeData* remeshed = new HalfEdgeData(*in->half_edge_data());
+  Remesh(remeshed, target_edge_length, iterations);
+  return new TriMesh(remeshed, in->material());
+}
+
+void IsotropicRemeshing::Remesh(HalfEdgeData* m, float target_edge_length,
+                                int iterations) const {
+  if (!m->IsValidType(MESH_TYPE::TRI)) {
+    throw std::invalid_argument(
+        "isotropic remeshing only supports triangle meshes");
+  }
+
+  const float high = target_edge_length * 4.0F / 3.0F;
+  const float low = target_edge_length * 4.0F / 5.0F;
+  LOG_INFO("remeshing to edge length {} ({} regular vertices before)",
+           target_edge_length, RegularVertexRatio(m));
+
+  for (int i = 0; i < iterations; i++) {
+    const remesh_clock::time_point start = remesh_clock::now();
+    SplitLongEdges(m, high);
+    const double split_ms = MillisecondsSince(start);
+    CollapseShortEdges(m, low, high);
+    const double collapse_ms = MillisecondsSince(start) - split_ms;
+    EqualizeValences(m);
+    const double flip_ms = MillisecondsSince(start) - split_ms - collapse_ms;
+    TangentialRelaxation(m);
+    const double relax_ms =
+        MillisecondsSince(start) - split_ms - collapse_ms - flip_ms;
+
+    LOG_INFO(
+        "remeshing iteration {}: {} faces, split {:.3f} ms, collapse {:.3f} "
+        "ms, flip {:.3f} ms, relax {:.3f} ms",
+        i + 1, m->faces()->size(), split_ms, collapse_ms, flip_ms, relax_ms);
+  }
+
+  for (Vertex* v : *m->vertices()) {
+    v->normal = glm::vec3(0.0F);
+  }
+  m->ShadeSmooth();
+
+  LOG_INFO("remeshing done ({} regular vertices after)",
+           RegularVertexRatio(m));
+}
+
+void IsotropicRemeshing::SplitLongEdges(HalfEdgeData* m, float high) const {
+  const float high2 = high * high;
+  // the two halves get appended, so they are checked again as well
+  for (std::size_t i = 0; i < m->edges()->size(); i++) {
+    Edge* e = m->edges()->at(i);
+    const HalfEdge* he = e->halfedge;
+    const glm::vec3 d = he->vert->position - he->Previous()->vert->position;
+    if (glm::dot(d, d) > high2) {
+      split(m, e);
+    }
+  }
+}
+
+// true if collapsing he (its origin goes to its target) does not create edges
+// longer than high and does not flip any of the faces around the origin
+static bool CollapseKeepsShape(const HalfEdge* he, float high) {
+  const Vertex* a = he->twin->vert;
+  const glm::vec3& target = he->vert->position;
+  const float high2 = high * high;
+
+  const HalfEdge* curr = he;
+  do {
+    const glm::vec3 d = curr->vert->position - target;
+    if (glm::dot(d, d) > high2) {
+      return false;
+    }
+    if (curr->face != he->face && curr->face != he->twin->face) {
+      const glm::vec3& p1 = curr->vert->position;
+      const glm::vec3& p2 = curr->next->vert->position;
+      const glm::vec3 before = TriangleNormal(a->position, p1, p2);
+      const glm::vec3 after = TriangleNormal(target, p1, p2);
+      if (glm::dot(before, after) <= 0.0F) {
+        return false;
+      }
+    }
+    curr = curr->twin->next;
+  } while (curr != he);
+  return true;
+}
+
+void IsotropicRemeshing::CollapseShortEdges(HalfEdgeData* m, float low,
+                                            float high) const {
+  const float low2 = low * low;
+  for (Edge* e : *m->edges()) {
+    HalfEdge* he = e->halfedge;
+    // dead or on the boundary
+    if (he == nullptr || he->IsBoundary()) {
+      continue;
+    }
+    const glm::vec3 d = he->vert->position - he->twin->vert->position;
+    if (glm::dot(d, d) >= low2) {
+      continue;
+    }
+    // CanCollapse also checks that the removed vertex is interior
+    for (HalfEdge* x : {he, he->twin}) {
+      if (m->CanCollapse(x) && CollapseKeepsShape(x, high)) {
+        m->Collapse(x);
+        break;
+      }
+    }
+  }
+  m->RemoveDeleted();
+}
+
+void IsotropicRemeshing::EqualizeValences(HalfEdgeData* m) const {
+  for (const Edge* e : *m->edges()) {
+    const HalfEdge* he = e->halfedge;
+    if (he->IsBoundary()) {
+      continue;
+    }
+    Vertex* a = he->twin->vert;
+    Vertex* b = he->vert;
+    Vertex* c = he->next->vert;
+    Vertex* d = he->twin->next->vert;
+    if (c == d || IsAdjacent(c, d)) {
+      continue;  // the flipped edge would already exist
+    }
+
+    Vertex* verts[4] = {a, b, c, d};
+    int valence[4];
+    int target[4];
+    for (int k = 0; k < 4; k++) {
+      valence[k] = NeighbourCount(verts[k]);
+      target[k] = verts[k]->IsBoundary() ? 4 : 6;
+    }
+    // a and b lose one edge, c and d get one
+    if (valence[0] <= target[0] / 2 || valence[1] <= target[1] / 2) {
+      continue;
+    }
+
+    int before = 0;
+    int after = 0;
+    for (int k = 0; k < 4; k++) {
+      before += std::abs(valence[k] - target[k]);
+      after += std::abs(valence[k] + (k < 2 ? -1 : 1) - target[k]);
+    }
+    if (after >= before) {
+      continue;
+    }
+
+    // no folds: the two new faces must face the same way as the old ones
+    const glm::vec3 old_normal =
+        TriangleNormal(a->position, b->position, c->position) +
+        TriangleNormal(b->position, a->position, d->position);
+    const glm::vec3 n0 = TriangleNormal(d->position, c->position, a->position);
+    const glm::vec3 n1 = TriangleNormal(c->position, d->position, b->position);
+    if (glm::dot(n0, old_normal) <= 0.0F || glm::dot(n1, old_normal) <= 0.0F) {
+      continue;
+    }
+
+    flip(e);
+  }
+}
+
+void IsotropicRemeshing::TangentialRelaxation(HalfEdgeData* m) const {
+  const std::vector<Vertex*>& verts = *m->vertices();
+  const std::size_t n = verts.size();
+
+  std::unordered_map<const Vertex*, unsigned int> index;
+  index.reserve(n);
+  for (unsigned int i = 0; i < n; i++) {
+    index[verts[i]] = i;
+  }
+
+  // one-rings in CSR form (in rotation order for interior vertices)
+  std::vector<unsigned int> ring_start(n + 1, 0);
+  std::vector<unsigned int> rings;
+  std::vector<char> boundary(n, 0);
+  std::vector<glm::vec3> positions(n);
+  std::vector<glm::vec2> uvs(n);
+  rings.reserve(m->half_edges()->size() + n);
+  std::vector<Vertex*> ring;
+  for (unsigned int i = 0; i < n; i++) {
+    ring.clear();
+    OneRing(verts[i], &ring);
+    for (const Vertex* x : ring) {
+      rings.push_back(index[x]);
+    }
+    ring_start[i + 1] = rings.size();
+    boundary[i] = verts[i]->IsBoundary();
+    positions[i] = verts[i]->position;
+    uvs[i] = verts[i]->text_coords;
+  }
+
+  // greedy colouring, most meshes end up with 4-7 colours
+  std::vector<int> colour(n, -1);
+  std::vector<std::vector<unsigned int>> by_colour;
+  std::vector<char> used;
+  for (unsigned int i = 0; i < n; i++) {
+    used.assign(by_colour.size() + 1, 0);
+    for (unsigned int k = ring_start[i]; k < ring_start[i + 1]; k++) {
+      if (colour[rings[k]] >= 0) {
+        used[colour[rings[k]]] = 1;
+      }
+    }
+    int c = 0;
+    while (used[c] != 0) {
+      c++;
+    }
+    colour[i] = c;
+    if (c == static_cast<int>(by_colour.size())) {
+      by_colour.emplace_back();
+    }
+    by_colour[c].push_back(i);
+  }
+
+  for (const std::vector<unsigned int>& group : by_colour) {
+    ParallelFor(0, group.size(), [&](std::size_t g) {
+      const unsigned int v = group[g];
+      if (boundary[v] != 0) {
+        return;
+      }
+      const unsigned int first = ring_start[v];
+      const unsigned int last = ring_start[v + 1];
+      const glm::vec3& p = positions[v];
+
+      glm::vec3 centroid(0.0F);
+      glm::vec2 uv_centroid(0.0F);
+      glm::vec3 normal(0.0F);
+      for (unsigned int k = first; k < last; k++) {
+        const unsigned int next = (k + 1 < last) ? k + 1 : first;
+        centroid += positions[rings[k]];
+        uv_centroid += uvs[rings[k]];
+        normal += TriangleNormal(p, positions[rings[next]], positions[rings[k]]);
+      }
+      const float inv = 1.0F / static_cast<float>(last - first);
+      centroid *= inv;
+      uv_centroid *= inv;
+
+      // only the tangential part of the move, the surface stays where it is
+      const float len = glm::length(normal);
+      if (len > 0.0F) {
+        normal /= len;
+        positions[v] = centroid + normal * glm::dot(normal, p - centroid);
+      } else {
+        positions[v] = centroid;
+      }
+      uvs[v] = uv_centroid;
+    });
+  }
+
+  ParallelFor(0, n, [&](std::size_t i) {
+    verts[i]->position = positions[i];
+    verts[i]->text_coords = uvs[i];
+  });
+}
+
+void IsotropicRemeshing::split(HalfEdgeData* m, Edge* e) const {
+  // f0 = (a, b, c) and f1 = (b, a, d), the new vertex x goes between a and b
+  HalfEdge* h = e->halfedge;  // a -> b
+  HalfEdge* h1 = h->next;     // b -> c
+  HalfEdge* h2 = h1->next;    // c -> a
+  Vertex* a = h2->vert;
+  Vertex* b = h->vert;
+  Vertex* c = h1->vert;
+  Face* f0 = h->face;
+
+  Vertex* x = new Vertex((a->position + b->position) * 0.5F,
+                         glm::normalize(a->normal + b->normal),
+                         (a->text_coords + b->text_coords) * 0.5F);
+  m->vertices()->push_back(x);
+
+  // f0 becomes (a, x, c) and f2 = (x, b, c)
+  Face* f2 = new Face();
+  HalfEdge* n1 = new HalfEdge(f0);  // x -> c
+  HalfEdge* n2 = new HalfEdge(f2);  // x -> b
+  HalfEdge* n3 = new HalfEdge(f2);  // c -> x
+  Edge* e1 = new Edge();            // x - b
+  Edge* e2 = new Edge();            // x - c
+
+  h->vert = x;
+  h->next = n1;
+  n1->vert = c;
+  n1->next = h2;
+
+  n2->vert = b;
+  n2->next = h1;
+  h1->face = f2;
+  h1->next = n3;
+  n3->vert = x;
+  n3->next = n2;
+
+  n1->twin = n3;
+  n3->twin = n1;
+  n1->edge = e2;
+  n3->edge = e2;
+  e2->halfedge = n1;
+  n2->edge = e1;
+  e1->halfedge = n2;
+  n2->twin = nullptr;
+
+  f0->halfedge = h;
+  f2->halfedge = n2;
+  x->halfedge = n2;
+
+  m->faces()->push_back(f2);
+  m->half_edges()->push_back(n1);
+  m->half_edges()->push_back(n2);
+  m->half_edges()->push_back(n3);
+  m->edges()->push_back(e1);
+  m->edges()->push_back(e2);
+
+  HalfEdge* t = h->twin;  // b -> a
+  if (t == nullptr) {
+    return;
+  }
+
+  // f1 becomes (b, x, d) and f3 = (x, a, d)
+  HalfEdge* t1 = t->next;   // a -> d
+  HalfEdge* t2 = t1->next;  // d -> b
+  Vertex* d = t1->vert;
+  Face* f1 = t->face;
+
+  Face* f3 = new Face();
+  HalfEdge* n4 = new HalfEdge(f1);  // x -> d
+  HalfEdge* n5 = new HalfEdge(f3);  // x -> a
+  HalfEdge* n6 = new HalfEdge(f3);  // d -> x
+  Edge* e3 = new Edge();            // x - d
+
+  t->vert = x;
+  t->next = n4;
+  n4->vert = d;
+  n4->next = t2;
+
+  n5->vert = a;
+  n5->next = t1;
+  t1->face = f3;
+  t1->next = n6;
+  n6->vert = x;
+  n6->next = n5;
+
+  n4->twin = n6;
+  n6->twin = n4;
+  n4->edge = e3;
+  n6->edge = e3;
+  e3->halfedge = n4;
+
+  // a -> x is h with x -> a, b -> x is t with x -> b
+  h->twin = n5;
+  n5->twin = h;
+  n5->edge = e;
+  t->twin = n2;
+  n2->twin = t;
+  t->edge = e1;
+
+  f1->halfedge = t;
+  f3->halfedge = n5;
+
+  m->faces()->push_back(f3);
+  m->half_edges()->push_back(n4);
+  m->half_edges()->push_back(n5);
+  m->half_edges()->push_back(n6);
+  m->edges()->push_back(e3);
+}
+
+void IsotropicRemeshing::flip(const Edge* e) const {
+  // f0 = (a, b, c) and f1 = (b, a, d) become (d, c, a) and (c, d, b)
+  HalfEdge* h = e->halfedge;  // a -> b, becomes d -> c
+  HalfEdge* h1 = h->next;     // b -> c
+  HalfEdge* h2 = h1->next;    // c -> a
+  HalfEdge* t = h->twin;      // b -> a, becomes c -> d
+  HalfEdge* t1 = t->next;     // a -> d
+  HalfEdge* t2 = t1->next;    // d -> b
+  Vertex* a = h2->vert;
+  Vertex* b = h->vert;
+  Vertex* c = h1->vert;
+  Vertex* d = t1->vert;
+  Face* f0 = h->face;
+  Face* f1 = t->face;
+
+  h->vert = c;
+  t->vert = d;
+
+  h->next = h2;
+  h2->next = t1;
+  t1->next = h;
+  t1->face = f0;
+
+  t->next = t2;
+  t2->next = h1;
+  h1->next = t;
+  h1->face = f1;
+
+  f0->halfedge = h;
+  f1->halfedge = t;
+  // a and b might have been using the flipped edge
+  a->halfedge = t1;
+  b->halfedge = h1;
+}
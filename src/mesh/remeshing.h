@@ -0,0 +1,46 @@
+#ifndef REMESHING_H
+#define REMESHING_H
+
+#include "mesh.h"
+
+// Isotropic remeshing of triangle meshes
+// http://www.graphics.rwth-aachen.de/media/papers/remeshing1.pdf
+// Every iteration splits the edges longer than 4/3 of the target length,
+// collapses the ones shorter than 4/5 of it, flips edges to bring the
+// valences closer to 6 (4 on the boundary) and then moves every vertex toward
+// the centroid of its neighbours along the tangent plane.
+// Boundaries are kept: boundary edges are only split and boundary vertices
+// never move.
+// The output is (almost) regular, which is what loop and sqrt3 like the most.
+class IsotropicRemeshing {
+ public:
+  // throws std::invalid_argument if m isn't a triangle mesh
+  void Remesh(HalfEdgeData* m, float target_edge_length, int iterations) const;
+  // returns a new mesh (in is not modified)
+  [[nodiscard]] TriMesh* remesh(TriMesh* in, float target_edge_length,
+                                int iterations) const;
+
+  [[nodiscard]] static float MeanEdgeLength(const HalfEdgeData* m);
+  // fraction of interior vertices with valence 6
+  [[nodiscard]] static float RegularVertexRatio(const HalfEdgeData* m);
+
+ private:
+  // the edge gets split in two by a vertex at its midpoint, the faces next to
+  // it are split in two as well
+  void split(HalfEdgeData* m, Edge* e) const;
+  /**
+   * @brief flips an edge (does not add any data to the mesh)
+   * @param e edge to flip
+   */
+  void flip(const Edge* e) const;
+
+  void SplitLongEdges(HalfEdgeData* m, float high) const;
+  void CollapseShortEdges(HalfEdgeData* m, float low, float high) const;
+  void EqualizeValences(HalfEdgeData* m) const;
+  // runs in parallel: vertices are greedily coloured so that no two
+  // neighbours share a colour, then every colour is relaxed in place
+  // concurrently (the vertices of one colour only read the others)
+  void TangentialRelaxation(HalfEdgeData* m) const;
+};
+
+#endif  // REMESHING_H
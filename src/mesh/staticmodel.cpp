@@ -1,5 +1,7 @@
 #include "object.h"
 
+#include <map>
+
 #include <imgui.h>
 
 #include "../logger.h"
@@ -8,7 +10,7 @@
 StaticModel::StaticModel(const std::string& name,
                          const std::vector<IMesh*>& model, const Shader* shader)
     : name_("Static | " + name),
-      model_(model),
+      model_(model.begin(), model.end()),
       shader_(shader),
       total_index_(0),
       total_verts_(0) {
@@ -16,56 +18,160 @@ StaticModel::StaticModel(const std::string& name,
       "StaticModel(const std::string&, const std::vector<IMesh*>&, const "
       "Shader*)");
 
-  for (const IMesh* mesh : model_) {
+  for (const std::shared_ptr<IMesh>& mesh : model_) {
     total_index_ += mesh->num_indices();
     total_verts_ += mesh->num_vertices();
   }
 }
 
+StaticModel::StaticModel(const std::string& name, const StaticModel& other)
+    : name_("Static | " + name),
+      model_path_(other.model_path_),
+      model_(other.model_),
+      merged_(other.merged_),
+      transform_(other.transform_),
+      shader_(other.shader_),
+      total_index_(other.total_index_),
+      total_verts_(other.total_verts_) {
+  LOG_TRACE("StaticModel(const std::string&, const StaticModel&)");
+}
+
 StaticModel::~StaticModel() {
   LOG_TRACE("~StaticModel()");
-
-  for (IMesh* mesh : model_) {
-    delete mesh;
-  }
 }
 
 static int counter = 0;  // TODO refactor static
 StaticModel* StaticModel::clone() {
   counter++;
 
-  std::vector<IMesh*> copy;
-  for (IMesh* m : model_) {
-    copy.push_back(m->clone());
-  }
-
   return new StaticModel(name_.substr(9) + " - " + std::to_string(counter),
-                         copy, shader_);
+                         *this);
 }
 
-void StaticModel::Draw() const {
-  for (const IMesh* mesh : model_) {
-    glBindVertexArray(mesh->vao());
-
-    mesh->material()->BindTextures();
+StaticModel::MergedBuffers::MergedBuffers(
+    const std::vector<std::shared_ptr<IMesh>>& meshes) {
+  // the size of every group first
+  std::map<int, std::size_t> group_of_patch;
+  std::vector<GLsizeiptr> group_vertices;
+  std::vector<GLsizeiptr> group_indices;
+  for (std::size_t i = 0; i < meshes.size(); i++) {
+    const auto [it, inserted] = group_of_patch.try_emplace(
+        meshes[i]->PatchNumVertices(), group_vertices.size());
+    if (inserted) {
+      group_vertices.push_back(0);
+      group_indices.push_back(0);
+    }
+    const std::size_t group = it->second;
+
+    ranges.push_back({group, static_cast<GLuint>(group_indices[group]),
+                      static_cast<GLint>(group_vertices[group])});
+    group_vertices[group] += meshes[i]->num_buffer_vertices();
+    group_indices[group] += meshes[i]->num_indices();
+  }
 
+  groups.resize(group_vertices.size());
+  for (std::size_t g = 0; g < groups.size(); g++) {
+    Group& group = groups[g];
+    glGenVertexArrays(1, &group.vao);
+    glBindVertexArray(group.vao);
+
+    glGenBuffers(1, &group.vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, group.vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * group_vertices[g], nullptr,
+                 GL_STATIC_DRAW);
+    glVertexAttribPointer(to_underlying(ATTRIB_ID::POSITIONS), 3, GL_FLOAT,
+                          GL_FALSE, sizeof(Vertex),
+                          (GLvoid*)offsetof(struct Vertex, position));
+    glVertexAttribPointer(to_underlying(ATTRIB_ID::NORMALS), 3, GL_FLOAT,
+                          GL_FALSE, sizeof(Vertex),
+                          (GLvoid*)offsetof(struct Vertex, normal));
+    glVertexAttribPointer(to_underlying(ATTRIB_ID::TEXTURE_COORDS), 2, GL_FLOAT,
+                          GL_FALSE, sizeof(Vertex),
+                          (GLvoid*)offsetof(struct Vertex, text_coords));
     glEnableVertexAttribArray(to_underlying(ATTRIB_ID::POSITIONS));
     glEnableVertexAttribArray(to_underlying(ATTRIB_ID::NORMALS));
     glEnableVertexAttribArray(to_underlying(ATTRIB_ID::TEXTURE_COORDS));
 
-    glPatchParameteri(GL_PATCH_VERTICES, mesh->PatchNumVertices());
-    // clang-format off
-    const Material* material = mesh->material();
-    shader_->SetUniformVec3("material_ambient_reflectivity", material->ambient_reflectivity());
-    shader_->SetUniformVec3("material_diffuse_reflectivity", material->diffuse_reflectivity());
-    shader_->SetUniformVec3("material_specular_reflectivity", material->specular_reflectivity());
-    shader_->SetUniformFloat("material_specular_glossiness_exponent", material->shininess());
-    // clang-format on
+    glGenBuffers(1, &group.ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, group.ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * group_indices[g],
+                 nullptr, GL_STATIC_DRAW);
+    glBindVertexArray(0);
+  }
 
-    glDrawElements(GL_PATCHES, mesh->num_indices(), GL_UNSIGNED_INT, nullptr);
+  // the indices are copied as they are, the base vertex of the draw offsets
+  // them to the vertices of their mesh
+  for (std::size_t i = 0; i < meshes.size(); i++) {
+    const Range& range = ranges[i];
+    const Group& group = groups[range.group];
+
+    glBindBuffer(GL_COPY_READ_BUFFER, meshes[i]->vbo());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, group.vbo);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+                        sizeof(Vertex) * range.base_vertex,
+                        sizeof(Vertex) * meshes[i]->num_buffer_vertices());
+
+    glBindBuffer(GL_COPY_READ_BUFFER, meshes[i]->ibo());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, group.ibo);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+                        sizeof(unsigned int) * range.first_index,
+                        sizeof(unsigned int) * meshes[i]->num_indices());
+  }
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    glBindVertexArray(0);
+  LOG_INFO("merged {} meshes in {} buffers", meshes.size(), groups.size());
+}
+
+StaticModel::MergedBuffers::~MergedBuffers() {
+  for (const Group& group : groups) {
+    glDeleteVertexArrays(1, &group.vao);
+    glDeleteBuffers(1, &group.vbo);
+    glDeleteBuffers(1, &group.ibo);
+  }
+}
+
+bool StaticModel::merge_buffers() const {
+  return merged_ != nullptr;
+}
+
+void StaticModel::merge_buffers(const bool merge) {
+  if (merge == merge_buffers()) {
+    return;
   }
+  // the clones keep theirs until they change it too
+  merged_ = merge ? std::make_shared<const MergedBuffers>(model_) : nullptr;
+}
+
+void StaticModel::Submit(RenderQueue* queue) const {
+  for (std::size_t i = 0; i < model_.size(); i++) {
+    const IMesh* mesh = model_[i].get();
+    if (merged_ != nullptr) {
+      const MergedBuffers::Range& range = merged_->ranges[i];
+      queue->Add(shader_, mesh->material(), merged_->groups[range.group].vao,
+                 mesh->PatchNumVertices(),
+                 static_cast<GLsizei>(mesh->num_indices()), transform_.matrix(),
+                 range.first_index, range.base_vertex);
+    } else {
+      queue->Add(shader_, mesh->material(), mesh->vao(),
+                 mesh->PatchNumVertices(),
+                 static_cast<GLsizei>(mesh->num_indices()),
+                 transform_.matrix());
+    }
+  }
+}
+
+BoundingVolume StaticModel::bounds() const {
+  BoundingVolume out;
+  for (const std::shared_ptr<IMesh>& mesh : model_) {
+    out = out.Merge(mesh->bounds());
+  }
+  return out;
+}
+
+void StaticModel::SelectLOD(const glm::vec3& /*camera_position*/) {
+  // no LODs
 }
 
 void StaticModel::SetRenderSettings() const {
@@ -76,6 +182,10 @@ void StaticModel::ShowSettingsGUI() {
   // TODO phong alpha
   ImGui::Text("this model contains %d vertices and %d indices", total_verts_,
               total_index_);
+  bool merge = merge_buffers();
+  if (ImGui::Checkbox("Merge buffers", &merge)) {
+    merge_buffers(merge);
+  }
 }
 
 const Transform& StaticModel::transform() const {
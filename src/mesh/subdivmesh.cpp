@@ -1,12 +1,17 @@
 #include "object.h"
 
+#include <algorithm>
+
 #include <imgui.h>
 
 #include "../logger.h"
+#include "../profiler.h"
 #include "../utilities.h"
 #include "../subdiv/loop.h"
 #include "../subdiv/sqrt3.h"
 #include "../subdiv/catmullclark.h"
+#include "decimation.h"
+#include "remeshing.h"
 
 SubDivMesh::SubDivMesh(const std::string& name, IMesh* model,
                        const Shader* shader)
@@ -20,16 +25,49 @@ SubDivMesh::SubDivMesh(const std::string& name, IMesh* model,
       current_subdiv_level_(0),
       compatible_subdivs_(model->CompatibleSubdivs()),
       shading_ui_(1),  // default smooth shading
-      current_subdiv_algo_(sa::SubDiv::NONE) {
+      spatial_reorder_(false),
+      remesh_length_ui_(1.0F),
+      remesh_iterations_ui_(5),
+      current_subdiv_algo_(sa::SubDiv::NONE),
+      lod_count_ui_(3),
+      lod_ratio_ui_(0.5F),
+      current_lod_(0),
+      lod_by_distance_(false),
+      lod_distance_step_(10.0F) {
   LOG_TRACE("SubDivMesh(const std::string&, const Model&, const Shader*)");
 
-  subdiv_model_ = model->clone();
+  subdiv_model_.reset(model->clone());
+}
+
+SubDivMesh::SubDivMesh(const std::string& name, const SubDivMesh& other)
+    : name_("SubDiv | " + name),
+      model_path_(other.model_path_),
+      base_model_(other.base_model_),
+      shader_(other.shader_),
+      subdiv_model_(other.subdiv_model_),
+      transform_(other.transform_),
+      subdiv_level_(other.subdiv_level_),
+      subdiv_algo_(other.subdiv_algo_),
+      current_subdiv_level_(other.current_subdiv_level_),
+      compatible_subdivs_(other.compatible_subdivs_),
+      current_subdiv_algo_(other.current_subdiv_algo_),
+      // made again by the next subdivision
+      subdiv_strategy_(nullptr),
+      shading_ui_(other.shading_ui_),
+      spatial_reorder_(other.spatial_reorder_),
+      remesh_length_ui_(other.remesh_length_ui_),
+      remesh_iterations_ui_(other.remesh_iterations_ui_),
+      lods_(other.lods_),
+      lod_count_ui_(other.lod_count_ui_),
+      lod_ratio_ui_(other.lod_ratio_ui_),
+      current_lod_(other.current_lod_),
+      lod_by_distance_(other.lod_by_distance_),
+      lod_distance_step_(other.lod_distance_step_) {
+  LOG_TRACE("SubDivMesh(const std::string&, const SubDivMesh&)");
 }
 
 SubDivMesh::~SubDivMesh() {
   LOG_TRACE("~SubDivMesh()");
-  delete base_model_;
-  delete subdiv_model_;
   delete subdiv_strategy_;
 }
 
@@ -38,36 +76,47 @@ SubDivMesh* SubDivMesh::clone() {
   counter++;
 
   return new SubDivMesh(name_.substr(9) + " - " + std::to_string(counter),
-                        base_model_->clone(), shader_);
+                        *this);
 }
 
-void SubDivMesh::Draw() const {
-  SetRenderSettings();
-  glBindVertexArray(subdiv_model_->vao());
+void SubDivMesh::Submit(RenderQueue* queue) const {
+  const IMesh* model = current_model();
+  queue->Add(GetShader(), model->material(), model->vao(),
+             model->PatchNumVertices(),
+             static_cast<GLsizei>(model->num_indices()), transform_.matrix());
+}
 
-  subdiv_model_->material()->BindTextures();
+BoundingVolume SubDivMesh::bounds() const {
+  return current_model()->bounds();
+}
 
-  glEnableVertexAttribArray(to_underlying(ATTRIB_ID::POSITIONS));
-  glEnableVertexAttribArray(to_underlying(ATTRIB_ID::NORMALS));
-  glEnableVertexAttribArray(to_underlying(ATTRIB_ID::TEXTURE_COORDS));
+void SubDivMesh::SelectLOD(const glm::vec3& camera_position) {
+  if (!lod_by_distance_ || lods_.empty()) {
+    return;
+  }
 
-  // clang-format off
-  const Material* material = subdiv_model_->material();
-  shader_->SetUniformVec3("material_ambient_reflectivity", material->ambient_reflectivity());
-  shader_->SetUniformVec3("material_diffuse_reflectivity", material->diffuse_reflectivity());
-  shader_->SetUniformVec3("material_specular_reflectivity", material->specular_reflectivity());
-  shader_->SetUniformFloat("material_specular_glossiness_exponent", material->shininess());
-  // clang-format on
+  const glm::vec3 position = glm::vec3(transform_.matrix()[3]);
+  const float distance = glm::length(camera_position - position);
+  current_lod_ = std::min(static_cast<int>(distance / lod_distance_step_),
+                          static_cast<int>(lods_.size()));
+}
 
-  glDrawElements(GL_PATCHES, subdiv_model_->num_indices(), GL_UNSIGNED_INT,
-                 nullptr);
+IMesh* SubDivMesh::current_model() const {
+  if (current_lod_ == 0) {
+    return subdiv_model_.get();
+  }
+  return lods_[current_lod_ - 1].get();
+}
 
-  glBindVertexArray(0);
+void SubDivMesh::ClearLODs() {
+  // the clones sharing them keep them
+  lods_.clear();
+  current_lod_ = 0;
 }
 
 // TODO move to mesh
 void SubDivMesh::SetRenderSettings() const {
-  glPatchParameteri(GL_PATCH_VERTICES, subdiv_model_->PatchNumVertices());
+  glPatchParameteri(GL_PATCH_VERTICES, current_model()->PatchNumVertices());
 }
 
 void SubDivMesh::ShowSettingsGUI() {
@@ -90,13 +139,16 @@ void SubDivMesh::ShowSettingsGUI() {
   ImGui::SameLine();
   ImGui::RadioButton("Smooth Shading", &shading_ui_, 1);
 
+  ImGui::Checkbox("Morton reorder after each level", &spatial_reorder_);
+
   ImGui::Text("Current subdiv algo is %s",
               sa::kSubdivisions.at(current_subdiv_algo_).c_str());
   ImGui::Text("Current subdiv level is %d", current_subdiv_level_);
 
   if (ImGui::Button("Apply Subdivision!")) {
     delete subdiv_strategy_;
-    delete subdiv_model_;
+    // they were decimated from the old model
+    ClearLODs();
 
     current_subdiv_algo_ = subdiv_algo_;
     current_subdiv_level_ = subdiv_level_;
@@ -119,9 +171,12 @@ void SubDivMesh::ShowSettingsGUI() {
         throw;
         break;
     }
+    subdiv_strategy_->spatial_reorder(spatial_reorder_);
+
     if (subdiv_model_ != nullptr) {
-      subdiv_model_ =
-          subdiv_strategy_->subdivide(base_model_, current_subdiv_level_);
+      ScopedTimer timer("subdivision");
+      subdiv_model_.reset(
+          subdiv_strategy_->subdivide(base_model_.get(), current_subdiv_level_));
 
       switch (shading_ui_) {
         case 1:
@@ -134,7 +189,32 @@ void SubDivMesh::ShowSettingsGUI() {
           throw;  // invalid for some reason
       }
     } else {
-      subdiv_model_ = base_model_->clone();
+      subdiv_model_.reset(base_model_->clone());
+    }
+  }
+
+  TriMesh* tri_base = dynamic_cast<TriMesh*>(base_model_.get());
+  if (tri_base != nullptr) {
+    ImGui::SeparatorText("Remeshing");
+    ImGui::SliderFloat("target edge length", &remesh_length_ui_, 0.25F, 4.0F,
+                       "%.2f x mean");
+    ImGui::SliderInt("remeshing iterations", &remesh_iterations_ui_, 1, 10);
+    if (ImGui::Button("Remesh base model")) {
+      const float target =
+          remesh_length_ui_ *
+          IsotropicRemeshing::MeanEdgeLength(tri_base->half_edge_data());
+      const IsotropicRemeshing remeshing;
+      TriMesh* remeshed =
+          remeshing.remesh(tri_base, target, remesh_iterations_ui_);
+      base_model_.reset(remeshed);
+
+      // everything built from the old base model is gone, back to level 0
+      ClearLODs();
+      delete subdiv_strategy_;
+      subdiv_strategy_ = nullptr;
+      subdiv_model_.reset(base_model_->clone());
+      current_subdiv_algo_ = sa::SubDiv::NONE;
+      current_subdiv_level_ = 0;
     }
   }
 
@@ -148,12 +228,58 @@ void SubDivMesh::ShowSettingsGUI() {
   ImGui::Text("this subdivided model contains %d faces",
               subdiv_model_->num_faces());
   ImGui::Spacing();
+
+  TriMesh* tri_model = dynamic_cast<TriMesh*>(subdiv_model_.get());
+  if (tri_model == nullptr) {
+    return;  // QEM decimation only works on triangles
+  }
+
+  ImGui::SeparatorText("Level of detail");
+  ImGui::SliderInt("LOD count", &lod_count_ui_, 1, 6);
+  ImGui::SliderFloat("LOD face ratio", &lod_ratio_ui_, 0.1F, 0.9F, "%.2f");
+  if (ImGui::Button("Generate LODs")) {
+    ClearLODs();
+
+    std::vector<int> targets;
+    float faces = static_cast<float>(subdiv_model_->num_faces());
+    for (int i = 0; i < lod_count_ui_; i++) {
+      faces *= lod_ratio_ui_;
+      targets.push_back(static_cast<int>(faces));
+    }
+
+    const QEMDecimation decimation;
+    for (TriMesh* lod : decimation.GenerateLODChain(tri_model, targets)) {
+      if (shading_ui_ == 1) {
+        lod->GenerateOpenGLBuffersWithSmoothShading();
+      } else {
+        lod->GenerateOpenGLBufferWithFlatShading();
+      }
+      lods_.emplace_back(lod);
+    }
+  }
+
+  if (!lods_.empty()) {
+    ImGui::Checkbox("LOD by camera distance", &lod_by_distance_);
+    if (lod_by_distance_) {
+      ImGui::SliderFloat("distance per LOD", &lod_distance_step_, 1.0F, 100.0F,
+                         "%.1f");
+    } else {
+      ImGui::SliderInt("current LOD", &current_lod_, 0,
+                       static_cast<int>(lods_.size()));
+    }
+    ImGui::Text("LOD %d has %d faces", current_lod_,
+                current_model()->num_faces());
+  }
 }
 
 void SubDivMesh::ApplySmoothShading() {
+  // the normals change in place, the clones keep theirs
+  if (base_model_.use_count() > 1) {
+    base_model_.reset(base_model_->clone());
+  }
   base_model_->ApplySmoothNormals();
-  delete subdiv_model_;
-  subdiv_model_ = base_model_->clone();
+  ClearLODs();
+  subdiv_model_.reset(base_model_->clone());
 }
 
 const Transform& SubDivMesh::transform() const {
@@ -165,7 +291,15 @@ void SubDivMesh::transform(const Transform& transform) {
 }
 
 const Shader* SubDivMesh::GetShader() const {
-  return shader_;
+  // catmull-clark turns the triangles into quads, the program must take the
+  // patches of the current model
+  const int patch_vertices = current_model()->PatchNumVertices();
+  if (patch_vertices == base_model_->PatchNumVertices()) {
+    return shader_;
+  }
+  return ShaderManager::Instance().GetShader(
+      patch_vertices == to_underlying(MESH_TYPE::QUAD) ? "QuadsShader"
+                                                       : "TriangleShader");
 }
 
 const std::string& SubDivMesh::name() const {
@@ -24,26 +24,19 @@ Terrain* Terrain::clone() {
   return nullptr;
 }
 
-void Terrain::Draw() const {
-  glBindVertexArray(terrain_->vao());
-
-  terrain_->material()->BindTextures();
-
-  glEnableVertexAttribArray(to_underlying(ATTRIB_ID::POSITIONS));
-  glEnableVertexAttribArray(to_underlying(ATTRIB_ID::NORMALS));
-  glEnableVertexAttribArray(to_underlying(ATTRIB_ID::TEXTURE_COORDS));
-
-  // clang-format off
-  const Material* material = terrain_->material();
-  shader_->SetUniformVec3("material_ambient_reflectivity", material->ambient_reflectivity());
-  shader_->SetUniformVec3("material_diffuse_reflectivity", material->diffuse_reflectivity());
-  shader_->SetUniformVec3("material_specular_reflectivity", material->specular_reflectivity());
-  shader_->SetUniformFloat("material_specular_glossiness_exponent", material->shininess());
-  // clang-format on
+void Terrain::Submit(RenderQueue* queue) const {
+  queue->Add(shader_, terrain_->material(), terrain_->vao(),
+             terrain_->PatchNumVertices(),
+             static_cast<GLsizei>(terrain_->num_indices()),
+             transform_.matrix());
+}
 
-  glDrawElements(GL_PATCHES, terrain_->num_indices(), GL_UNSIGNED_INT, nullptr);
+BoundingVolume Terrain::bounds() const {
+  return terrain_->bounds();
+}
 
-  glBindVertexArray(0);
+void Terrain::SelectLOD(const glm::vec3& /*camera_position*/) {
+  // no LODs
 }
 
 const Shader* Terrain::GetShader() const {
@@ -14,6 +14,9 @@ struct Vertex {
   glm::vec2 text_coords;  // texture coordinates
 
   HalfEdge* halfedge;  // one of it's outgoing halfedge
+  // its position in HalfEdgeData::vertices(), only valid after
+  // ExportVertices() (the export of the indices reads it)
+  unsigned int index = 0;
 
   Vertex() = default;
   Vertex(float x, float y, float z, float xn, float yn, float zn, float s,
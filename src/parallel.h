@@ -0,0 +1,88 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// number of worker threads used by the parallel loops (at least 1)
+inline unsigned int WorkerCount() {
+  return std::max(1U, std::thread::hardware_concurrency());
+}
+
+// calls f(i) for every i in [begin, end), split in contiguous chunks over the
+// worker threads (the calling thread takes the first chunk). f must be safe to
+// call concurrently for different i. Small ranges just run inline because
+// spawning threads costs more than the work
+template <typename F>
+void ParallelFor(std::size_t begin, std::size_t end, F f,
+                 std::size_t min_chunk = 1024) {
+  if (end <= begin) {
+    return;
+  }
+  const std::size_t count = end - begin;
+  const std::size_t n_chunks =
+      std::min<std::size_t>(WorkerCount(), (count + min_chunk - 1) / min_chunk);
+  if (n_chunks <= 1) {
+    for (std::size_t i = begin; i < end; i++) {
+      f(i);
+    }
+    return;
+  }
+
+  const std::size_t chunk = (count + n_chunks - 1) / n_chunks;
+  auto run = [&f, end](std::size_t from, std::size_t to) {
+    for (std::size_t i = from; i < std::min(to, end); i++) {
+      f(i);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(n_chunks - 1);
+  for (std::size_t c = 1; c < n_chunks; c++) {
+    workers.emplace_back(run, begin + c * chunk, begin + (c + 1) * chunk);
+  }
+  run(begin, begin + chunk);
+  for (std::thread& t : workers) {
+    t.join();
+  }
+}
+
+// std::sort of [begin, end) with the chunks sorted in parallel and then merged
+// pairwise (the merges of a round in parallel too)
+template <typename It, typename Compare = std::less<>>
+void ParallelSort(It begin, It end, Compare comp = Compare(),
+                  std::size_t min_chunk = 1 << 16) {
+  const std::size_t count = static_cast<std::size_t>(end - begin);
+  const std::size_t n_chunks = std::min<std::size_t>(
+      WorkerCount(), (count + min_chunk - 1) / min_chunk);
+  if (n_chunks <= 1) {
+    std::sort(begin, end, comp);
+    return;
+  }
+
+  const std::size_t chunk = (count + n_chunks - 1) / n_chunks;
+  ParallelFor(
+      0, n_chunks,
+      [&](const std::size_t c) {
+        std::sort(begin + std::min(c * chunk, count),
+                  begin + std::min((c + 1) * chunk, count), comp);
+      },
+      1);
+  for (std::size_t width = chunk; width < count; width *= 2) {
+    ParallelFor(
+        0, (count + 2 * width - 1) / (2 * width),
+        [&](const std::size_t m) {
+          const std::size_t first = m * 2 * width;
+          const std::size_t middle = std::min(first + width, count);
+          const std::size_t last = std::min(first + 2 * width, count);
+          std::inplace_merge(begin + first, begin + middle, begin + last,
+                             comp);
+        },
+        1);
+  }
+}
+
+#endif  // PARALLEL_H
@@ -0,0 +1,225 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+
+#include "logger.h"
+
+namespace {
+
+double Microseconds(const Profiler::clock::duration d) {
+  return std::chrono::duration<double, std::micro>(d).count();
+}
+
+}  // namespace
+
+Profiler::Profiler() : epoch_(clock::now()), frame_start_(epoch_) {
+  LOG_TRACE("Profiler()");
+}
+
+Profiler& Profiler::Instance() {
+  static Profiler instance_;
+  return instance_;
+}
+
+int Profiler::ThreadIndex(const std::thread::id id) {
+  // 0 is the GPU
+  const auto [it, inserted] =
+      threads_.try_emplace(id, static_cast<int>(threads_.size()) + 1);
+  return it->second;
+}
+
+void Profiler::AddEvent(Event event) {
+  if (events_.size() == kMaxEvents) {
+    events_.pop_front();
+  }
+  events_.push_back(std::move(event));
+}
+
+void Profiler::Push(std::deque<double>* history, const double value) {
+  if (history->size() == kHistory) {
+    history->pop_front();
+  }
+  history->push_back(value);
+}
+
+Profiler::Summary Profiler::Summarize(const std::deque<double>& history) {
+  Summary out;
+  if (history.empty()) {
+    return out;
+  }
+  std::vector<double> sorted(history.begin(), history.end());
+  std::sort(sorted.begin(), sorted.end());
+  double sum = 0.0;
+  for (const double ms : sorted) {
+    sum += ms;
+  }
+  out.average_ms = sum / sorted.size();
+  // nearest rank
+  const auto percentile = [&sorted](const double p) {
+    const std::size_t rank =
+        static_cast<std::size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+  };
+  out.p95_ms = percentile(0.95);
+  out.p99_ms = percentile(0.99);
+  return out;
+}
+
+void Profiler::AddCpuEvent(const char* name, const clock::time_point start,
+                           const clock::time_point end) {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  Stage& stage = cpu_stages_[name];
+  stage.this_frame_ms += Microseconds(end - start) / 1000.0;
+  stage.ran = true;
+  AddEvent({name, Microseconds(start - epoch_), Microseconds(end - start),
+            ThreadIndex(std::this_thread::get_id())});
+}
+
+void Profiler::BeginFrame() {
+  frame_start_ = clock::now();
+  const std::lock_guard<std::mutex> lock(mutex_);
+  gl_thread_ = ThreadIndex(std::this_thread::get_id());
+}
+
+void Profiler::EndFrame() {
+  const clock::time_point end = clock::now();
+  ReadGpuQueries();
+  // the next frame writes the queries just read
+  gpu_slot_ = 1 - gpu_slot_;
+
+  const std::lock_guard<std::mutex> lock(mutex_);
+  Push(&frame_history_, Microseconds(end - frame_start_) / 1000.0);
+  AddEvent({"frame", Microseconds(frame_start_ - epoch_),
+            Microseconds(end - frame_start_), gl_thread_});
+  for (auto& [name, stage] : cpu_stages_) {
+    if (stage.ran) {
+      Push(&stage.history, stage.this_frame_ms);
+    }
+    stage.this_frame_ms = 0.0;
+    stage.ran = false;
+  }
+}
+
+void Profiler::BeginGpu(const char* name) {
+  if (gpu_active_) {
+    LOG_WARN("GPU timer {} ignored, another one is running", name);
+    return;
+  }
+  GpuQuery& query = gpu_queries_[name];
+  if (query.ids[0] == 0) {
+    glGenQueries(2, query.ids.data());
+  }
+  // a result that wasn't read in time is lost
+  glBeginQuery(GL_TIME_ELAPSED, query.ids[gpu_slot_]);
+  query.pending[gpu_slot_] = true;
+  query.start[gpu_slot_] = clock::now();
+  gpu_active_ = true;
+}
+
+void Profiler::EndGpu() {
+  if (!gpu_active_) {
+    return;
+  }
+  glEndQuery(GL_TIME_ELAPSED);
+  gpu_active_ = false;
+}
+
+void Profiler::ReadGpuQueries() {
+  const std::size_t slot = 1 - gpu_slot_;
+  for (auto& [name, query] : gpu_queries_) {
+    if (!query.pending[slot]) {
+      continue;
+    }
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(query.ids[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available == GL_FALSE) {
+      continue;
+    }
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(query.ids[slot], GL_QUERY_RESULT, &nanoseconds);
+    query.pending[slot] = false;
+
+    const double us = static_cast<double>(nanoseconds) / 1000.0;
+    Push(&gpu_history_[name], us / 1000.0);
+    // the GPU clock isn't the CPU one, the event starts when it was issued
+    const std::lock_guard<std::mutex> lock(mutex_);
+    AddEvent({name, Microseconds(query.start[slot] - epoch_), us, kGpuThread});
+  }
+}
+
+Profiler::Summary Profiler::FrameSummary() const {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  return Summarize(frame_history_);
+}
+
+std::map<std::string, Profiler::Summary> Profiler::CpuSummaries() const {
+  const std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string, Summary> out;
+  for (const auto& [name, stage] : cpu_stages_) {
+    out[name] = Summarize(stage.history);
+  }
+  return out;
+}
+
+std::map<std::string, Profiler::Summary> Profiler::GpuSummaries() const {
+  std::map<std::string, Summary> out;
+  for (const auto& [name, history] : gpu_history_) {
+    out[name] = Summarize(history);
+  }
+  return out;
+}
+
+bool Profiler::ExportChromeTrace(const std::filesystem::path& path) const {
+  std::ofstream out(path);
+  if (!out) {
+    LOG_ERROR("can't write the trace {}", path.string());
+    return false;
+  }
+
+  const std::lock_guard<std::mutex> lock(mutex_);
+  // https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+  out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n";
+  out << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << kGpuThread
+      << R"(,"args":{"name":"GPU"}})";
+  for (const auto& [id, thread] : threads_) {
+    const std::string name =
+        thread == gl_thread_ ? "main" : "worker " + std::to_string(thread);
+    out << ",\n"
+        << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << thread
+        << R"(,"args":{"name":")" << name << "\"}}";
+  }
+  // the names are string literals of the code, nothing to escape
+  for (const Event& e : events_) {
+    out << ",\n"
+        << R"({"name":")" << e.name << R"(","ph":"X","pid":1,"tid":)"
+        << e.thread << ",\"ts\":" << e.start_us << ",\"dur\":" << e.duration_us
+        << "}";
+  }
+  out << "\n]}\n";
+
+  if (!out) {
+    LOG_ERROR("can't write the trace {}", path.string());
+    return false;
+  }
+  LOG_INFO("wrote {} events to {}", events_.size(), path.string());
+  return true;
+}
+
+void Profiler::Shutdown() {
+  for (auto& [name, query] : gpu_queries_) {
+    glDeleteQueries(2, query.ids.data());
+  }
+  gpu_queries_.clear();
+}
+
+ScopedTimer::ScopedTimer(const char* name)
+    : name_(name), start_(Profiler::clock::now()) {
+  //
+}
+
+ScopedTimer::~ScopedTimer() {
+  Profiler::Instance().AddCpuEvent(name_, start_, Profiler::clock::now());
+}
@@ -0,0 +1,140 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+
+// Timings of the stages of the app (import, subdivision, buffer generation,
+// render, ImGui...). The CPU ones come from ScopedTimer, on any thread, the
+// GPU ones from GL_TIME_ELAPSED queries between BeginGpu() and EndGpu() on the
+// GL thread. Every stage keeps its time in the last kHistory frames it ran in
+// (the import ones in the frame they ended in), and every timing is also kept
+// as an event (the last kMaxEvents) for ExportChromeTrace().
+// The GPU queries are double buffered: a frame reads the ones of the previous
+// frame (if they are ready, otherwise it keeps the last result) so nothing
+// waits for the GPU
+class Profiler {
+ public:
+  using clock = std::chrono::steady_clock;
+
+  static constexpr std::size_t kHistory = 240;
+  static constexpr std::size_t kMaxEvents = 100000;
+
+  // rolling statistics of a stage or of the whole frame, in milliseconds
+  struct Summary {
+    double average_ms = 0.0;
+    double p95_ms = 0.0;
+    double p99_ms = 0.0;
+  };
+
+  Profiler(const Profiler&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+  Profiler(Profiler&&) = delete;
+  Profiler& operator=(Profiler&&) = delete;
+  ~Profiler() = default;
+
+  static Profiler& Instance();
+
+  // thread safe
+  void AddCpuEvent(const char* name, clock::time_point start,
+                   clock::time_point end);
+
+  // the rest must be used on the GL thread
+  void BeginFrame();
+  void EndFrame();
+  // the GPU scopes can't be nested (one GL_TIME_ELAPSED query at a time)
+  void BeginGpu(const char* name);
+  void EndGpu();
+
+  [[nodiscard]] Summary FrameSummary() const;
+  // by stage name
+  [[nodiscard]] std::map<std::string, Summary> CpuSummaries() const;
+  [[nodiscard]] std::map<std::string, Summary> GpuSummaries() const;
+
+  // the events kept, in the Trace Event Format of chrome://tracing and
+  // Perfetto. False if the file can't be written
+  bool ExportChromeTrace(const std::filesystem::path& path) const;
+  // deletes the queries, it must be called while the OpenGL context still
+  // exists
+  void Shutdown();
+
+ private:
+  Profiler();
+
+  struct Event {
+    std::string name;
+    // microseconds from the start of the profiler
+    double start_us;
+    double duration_us;
+    // kGpuThread for the GPU ones
+    int thread;
+  };
+  static constexpr int kGpuThread = 0;
+
+  struct Stage {
+    double this_frame_ms = 0.0;
+    bool ran = false;
+    std::deque<double> history;
+  };
+  struct GpuQuery {
+    std::array<GLuint, 2> ids = {0, 0};
+    std::array<bool, 2> pending = {false, false};
+    // CPU time of the BeginGpu() of each query, for the trace
+    std::array<clock::time_point, 2> start;
+  };
+
+  int ThreadIndex(std::thread::id id);
+  void AddEvent(Event event);
+  static void Push(std::deque<double>* history, double value);
+  static Summary Summarize(const std::deque<double>& history);
+  // reads the results of the queries of the previous frame that are ready
+  void ReadGpuQueries();
+
+  const clock::time_point epoch_;
+
+  // guards everything the CPU timers touch
+  mutable std::mutex mutex_;
+  std::deque<Event> events_;
+  std::unordered_map<std::thread::id, int> threads_;
+  std::map<std::string, Stage> cpu_stages_;
+  // the thread that calls BeginFrame()
+  int gl_thread_ = -1;
+
+  // GL thread only, the last results of each GPU stage
+  std::map<std::string, std::deque<double>> gpu_history_;
+  std::map<std::string, GpuQuery> gpu_queries_;
+  // the query written this frame, 0 or 1
+  std::size_t gpu_slot_ = 0;
+  bool gpu_active_ = false;
+  clock::time_point frame_start_;
+  std::deque<double> frame_history_;
+};
+
+// adds the time between its construction and destruction to the stage name,
+// which must outlive it (a string literal)
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(const char* name);
+  ~ScopedTimer();
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+  ScopedTimer(ScopedTimer&&) = delete;
+  ScopedTimer& operator=(ScopedTimer&&) = delete;
+
+ private:
+  const char* name_;
+  Profiler::clock::time_point start_;
+};
+
+#endif  // PROFILER_H
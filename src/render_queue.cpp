@@ -0,0 +1,282 @@
+#include "render_queue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+
+#include "./mesh/mesh.h"
+#include "utilities.h"
+
+namespace {
+
+// bits of each field of the sort key, 64 in total
+constexpr int kShaderBits = 8;
+constexpr int kTextureBits = 16;
+constexpr int kPatchBits = 4;
+constexpr int kVaoBits = 12;
+constexpr int kMeshBits = 24;
+static_assert(kShaderBits + kTextureBits + kPatchBits + kVaoBits + kMeshBits ==
+                  64,
+              "the sort key must use all the 64 bits");
+
+// the index of value in indices, a new one if it's not there yet. Indices past
+// the bits of their field share the last one: the items are still sorted, just
+// not as well
+template <typename Map, typename Value>
+uint64_t IndexOf(Map* indices, const Value& value, const int bits) {
+  const auto [it, inserted] = indices->try_emplace(value, indices->size());
+  return std::min<uint64_t>(it->second, (uint64_t(1) << bits) - 1);
+}
+
+// same mesh in the same buffers, only the transform can differ
+bool SameMesh(const DrawItem& a, const DrawItem& b) {
+  return a.vao == b.vao && a.first_index == b.first_index &&
+         a.num_indices == b.num_indices && a.base_vertex == b.base_vertex &&
+         a.material == b.material;
+}
+
+}  // namespace
+
+RenderQueue::~RenderQueue() {
+  glDeleteBuffers(1, &instance_buffer_);
+  glDeleteBuffers(1, &command_buffer_);
+  glDeleteTextures(1, &material_texture_);
+  glDeleteBuffers(1, &material_buffer_);
+}
+
+void RenderQueue::Clear() {
+  items_.clear();
+  shaders_.clear();
+  texture_sets_.clear();
+  vaos_.clear();
+  meshes_.clear();
+  materials_.clear();
+  materials_data_.clear();
+}
+
+RenderQueue::TextureSet RenderQueue::TexturesOf(const Material* material) {
+  TextureSet textures = {0, 0, 0};
+  // the last texture of a type wins, as it did when every mesh bound them all
+  for (const Texture& t : material->textures()) {
+    textures[to_underlying(t.type())] = t.id();
+  }
+  return textures;
+}
+
+bool RenderQueue::SameState(const DrawItem& a, const DrawItem& b) {
+  return a.shader == b.shader && a.vao == b.vao &&
+         a.patch_vertices == b.patch_vertices &&
+         TexturesOf(a.material) == TexturesOf(b.material);
+}
+
+void RenderQueue::Add(const Shader* shader, const Material* material,
+                      const GLuint vao, const int patch_vertices,
+                      const GLsizei num_indices,
+                      const glm::mat4& model_to_world,
+                      const GLuint first_index, const GLint base_vertex) {
+  const auto [it, inserted] = materials_.try_emplace(
+      material, static_cast<uint32_t>(materials_data_.size()));
+  if (inserted) {
+    materials_data_.push_back(
+        {glm::vec4(material->ambient_reflectivity(), 0.0F),
+         glm::vec4(material->diffuse_reflectivity(), 0.0F),
+         glm::vec4(material->specular_reflectivity(), material->shininess())});
+  }
+
+  uint64_t key = IndexOf(&shaders_, shader, kShaderBits);
+  key = key << kTextureBits |
+        IndexOf(&texture_sets_, TexturesOf(material), kTextureBits);
+  key = key << kPatchBits |
+        std::min<uint64_t>(patch_vertices, (uint64_t(1) << kPatchBits) - 1);
+  key = key << kVaoBits | IndexOf(&vaos_, vao, kVaoBits);
+  key = key << kMeshBits |
+        IndexOf(&meshes_,
+                MeshKey(vao, first_index, num_indices, base_vertex, material),
+                kMeshBits);
+
+  items_.push_back({key, shader, material, it->second, vao, patch_vertices,
+                    first_index, num_indices, base_vertex, model_to_world});
+}
+
+void RenderQueue::Sort() {
+  // stable so the items with the same state keep the scene order
+  std::stable_sort(items_.begin(), items_.end(),
+                   [](const DrawItem& a, const DrawItem& b) {
+                     return a.key < b.key;
+                   });
+}
+
+void RenderQueue::BuildCommands() {
+  instances_.clear();
+  commands_.clear();
+  batches_.clear();
+
+  for (std::size_t first = 0; first < items_.size();) {
+    const DrawItem& item = items_[first];
+    std::size_t last = first + 1;
+    while (last < items_.size() && SameMesh(item, items_[last])) {
+      last++;
+    }
+
+    if (batches_.empty() ||
+        !SameState(items_[batches_.back().first_item], item)) {
+      batches_.push_back({first, commands_.size(), 0});
+    }
+    batches_.back().num_commands++;
+
+    // the base instance offsets the instance attributes to this mesh's ones
+    commands_.push_back({static_cast<GLuint>(item.num_indices),
+                         static_cast<GLuint>(last - first), item.first_index,
+                         item.base_vertex,
+                         static_cast<GLuint>(instances_.size())});
+    for (std::size_t i = first; i < last; i++) {
+      instances_.push_back({items_[i].model_to_world, items_[i].material_index,
+                            {0, 0, 0}});
+    }
+    first = last;
+  }
+}
+
+void RenderQueue::Upload() {
+  if (instance_buffer_ == 0) {
+    glGenBuffers(1, &instance_buffer_);
+    glGenBuffers(1, &command_buffer_);
+    glGenBuffers(1, &material_buffer_);
+    glGenTextures(1, &material_texture_);
+  }
+
+  // all orphaned every frame like the FrameData block
+  glBindBuffer(GL_ARRAY_BUFFER, instance_buffer_);
+  glBufferData(GL_ARRAY_BUFFER,
+               static_cast<GLsizeiptr>(instances_.size() * sizeof(Instance)),
+               instances_.data(), GL_STREAM_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command_buffer_);
+  glBufferData(GL_DRAW_INDIRECT_BUFFER,
+               static_cast<GLsizeiptr>(commands_.size() * sizeof(DrawCommand)),
+               commands_.data(), GL_STREAM_DRAW);
+
+  glBindBuffer(GL_TEXTURE_BUFFER, material_buffer_);
+  glBufferData(
+      GL_TEXTURE_BUFFER,
+      static_cast<GLsizeiptr>(materials_data_.size() * sizeof(MaterialData)),
+      materials_data_.data(), GL_STREAM_DRAW);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  glActiveTexture(GL_TEXTURE0 + kMaterialBufferUnit);
+  glBindTexture(GL_TEXTURE_BUFFER, material_texture_);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, material_buffer_);
+}
+
+void RenderQueue::BindInstanceAttributes() const {
+  glBindBuffer(GL_ARRAY_BUFFER, instance_buffer_);
+  // the transform, a mat4 takes 4 locations
+  for (GLuint i = 0; i < 4; i++) {
+    const GLuint location = to_underlying(ATTRIB_ID::MODEL_TO_WORLD) + i;
+    glEnableVertexAttribArray(location);
+    glVertexAttribPointer(
+        location, 4, GL_FLOAT, GL_FALSE, sizeof(Instance),
+        reinterpret_cast<GLvoid*>(offsetof(Instance, model_to_world) +
+                                  i * sizeof(glm::vec4)));
+    glVertexAttribDivisor(location, 1);
+  }
+  const GLuint material = to_underlying(ATTRIB_ID::MATERIAL);
+  glEnableVertexAttribArray(material);
+  glVertexAttribIPointer(material, 1, GL_UNSIGNED_INT, sizeof(Instance),
+                         reinterpret_cast<GLvoid*>(offsetof(Instance, material)));
+  glVertexAttribDivisor(material, 1);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void RenderQueue::Submit() {
+  const auto start = std::chrono::steady_clock::now();
+  stats_ = RenderStats();
+  if (items_.empty()) {
+    return;
+  }
+
+  BuildCommands();
+  Upload();
+  // without ARB_multi_draw_indirect (core in 4.3) the same commands are drawn
+  // one by one
+  const bool multi_draw = GLEW_ARB_multi_draw_indirect;
+
+  const Shader* shader = nullptr;
+  TextureSet textures = {0, 0, 0};
+  // nothing is assumed about the units before the first item
+  std::array<bool, 3> textures_valid = {false, false, false};
+  int patch_vertices = 0;
+  GLuint vao = 0;
+
+  for (const Batch& batch : batches_) {
+    const DrawItem& item = items_[batch.first_item];
+
+    if (item.shader != shader) {
+      item.shader->Enable();
+      shader = item.shader;
+      stats_.programs++;
+    }
+
+    const TextureSet item_textures = TexturesOf(item.material);
+    for (std::size_t unit = 0; unit < item_textures.size(); unit++) {
+      if (textures_valid[unit] && textures[unit] == item_textures[unit]) {
+        continue;
+      }
+      glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(unit));
+      glBindTexture(GL_TEXTURE_2D, item_textures[unit]);
+      textures[unit] = item_textures[unit];
+      textures_valid[unit] = true;
+      stats_.textures++;
+    }
+
+    if (item.patch_vertices != patch_vertices) {
+      glPatchParameteri(GL_PATCH_VERTICES, item.patch_vertices);
+      patch_vertices = item.patch_vertices;
+      stats_.patch_sizes++;
+    }
+
+    if (item.vao != vao) {
+      glBindVertexArray(item.vao);
+      BindInstanceAttributes();
+      vao = item.vao;
+      stats_.vaos++;
+    }
+
+    if (multi_draw) {
+      glMultiDrawElementsIndirect(
+          GL_PATCHES, GL_UNSIGNED_INT,
+          reinterpret_cast<GLvoid*>(batch.first_command * sizeof(DrawCommand)),
+          static_cast<GLsizei>(batch.num_commands), 0);
+      stats_.draws++;
+    } else {
+      for (std::size_t i = batch.first_command;
+           i < batch.first_command + batch.num_commands; i++) {
+        const DrawCommand& c = commands_[i];
+        glDrawElementsInstancedBaseVertexBaseInstance(
+            GL_PATCHES, static_cast<GLsizei>(c.count), GL_UNSIGNED_INT,
+            reinterpret_cast<GLvoid*>(c.first_index * sizeof(GLuint)),
+            static_cast<GLsizei>(c.instance_count), c.base_vertex,
+            c.base_instance);
+        stats_.draws++;
+      }
+    }
+    stats_.commands += static_cast<int>(batch.num_commands);
+  }
+  stats_.instances = static_cast<int>(instances_.size());
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  glActiveTexture(GL_TEXTURE0);
+
+  const auto end = std::chrono::steady_clock::now();
+  stats_.submit_ms =
+      std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+const RenderStats& RenderQueue::stats() const {
+  return stats_;
+}
+
+std::size_t RenderQueue::size() const {
+  return items_.size();
+}
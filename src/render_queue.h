@@ -0,0 +1,164 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "material.h"
+#include "shader.h"
+
+// everything needed to draw one mesh, collected from the objects with
+// IRenderableObject::Submit()
+struct DrawItem {
+  // see RenderQueue::Add()
+  uint64_t key;
+  const Shader* shader;
+  const Material* material;
+  // its index in the material buffer
+  uint32_t material_index;
+  GLuint vao;
+  int patch_vertices;
+  // the range of the index buffer of the VAO, for the meshes packed together
+  // in one buffer (see StaticModel)
+  GLuint first_index;
+  GLsizei num_indices;
+  GLint base_vertex;
+  glm::mat4 model_to_world;
+};
+
+// OpenGL state changes of the last frame, for the stats window
+struct RenderStats {
+  // the draw calls, a multi draw is one call for all its commands
+  int draws = 0;
+  int commands = 0;
+  // objects drawn by the instanced draws
+  int instances = 0;
+  int programs = 0;
+  int textures = 0;
+  int patch_sizes = 0;
+  int vaos = 0;
+  // objects drawn and skipped by the frustum culling
+  int objects = 0;
+  int culled = 0;
+  // primitives out of the tessellation, of a previous frame (the query is
+  // read when it's ready, see Renderer)
+  uint64_t triangles = 0;
+  // patches seen and culled by the control shaders, of a previous frame too.
+  // Always 0 without patch_stats (see Renderer::patch_stats())
+  bool patch_stats = false;
+  uint32_t patches = 0;
+  uint32_t patches_culled = 0;
+  // CPU time of RenderQueue::Submit()
+  double submit_ms = 0.0;
+};
+
+// The draws of a frame: the objects add their meshes, the queue sorts them so
+// the ones sharing state are next to each other and then only issues the state
+// changes between an item and the previous one. Consecutive items of the same
+// mesh (the clones sharing it) become one instanced draw command, their
+// transforms and materials are read from per instance vertex attributes, so
+// the items with the same program, textures, patch size and VAO (the meshes
+// packed in one buffer) are drawn with a single glMultiDrawElementsIndirect.
+// The materials are in a buffer texture, indexed by the material attribute.
+// The sort key is, from the most significant bits, the program, the textures,
+// the patch size, the VAO and the mesh (each one as the index of its first
+// appearance in the frame), so the most expensive changes happen least often
+class RenderQueue {
+ public:
+  RenderQueue() = default;
+  ~RenderQueue();
+  RenderQueue(const RenderQueue& other) = delete;
+  RenderQueue& operator=(const RenderQueue& other) = delete;
+  RenderQueue(RenderQueue&& other) = delete;
+  RenderQueue& operator=(RenderQueue&& other) = delete;
+
+  void Clear();
+  // first_index and base_vertex select a mesh in buffers shared with others
+  void Add(const Shader* shader, const Material* material, GLuint vao,
+           int patch_vertices, GLsizei num_indices,
+           const glm::mat4& model_to_world, GLuint first_index = 0,
+           GLint base_vertex = 0);
+  void Sort();
+  // the FrameData block must already be bound
+  void Submit();
+
+  [[nodiscard]] const RenderStats& stats() const;
+  [[nodiscard]] std::size_t size() const;
+
+ private:
+  // the texture bound to the unit of each TEXTURE_TYPE, 0 if the material has
+  // none of that type
+  using TextureSet = std::array<GLuint, 3>;
+  static TextureSet TexturesOf(const Material* material);
+  // everything but the mesh, the items drawn by one multi draw
+  static bool SameState(const DrawItem& a, const DrawItem& b);
+  // vao, first index, number of indices, base vertex and material
+  using MeshKey = std::tuple<GLuint, GLuint, GLsizei, GLint, const Material*>;
+
+  // per instance attributes, see BindInstanceAttributes()
+  struct Instance {
+    glm::mat4 model_to_world;
+    uint32_t material;
+    uint32_t padding[3];
+  };
+  // layout of GL_DRAW_INDIRECT_BUFFER
+  struct DrawCommand {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    // also where the instance attributes of the command start
+    GLuint base_instance;
+  };
+  // the commands drawn with the same state, starting from items_[first_item]
+  struct Batch {
+    std::size_t first_item;
+    std::size_t first_command;
+    std::size_t num_commands;
+  };
+  // ambient, diffuse and specular reflectivity, the glossiness exponent is in
+  // specular.w
+  struct MaterialData {
+    glm::vec4 ambient;
+    glm::vec4 diffuse;
+    glm::vec4 specular;
+  };
+
+  // fills instances_, commands_ and batches_ from the sorted items
+  void BuildCommands();
+  // the instances, the commands and the materials (bound to their unit)
+  void Upload();
+  // they are part of the VAO state so they're set every time a VAO is bound
+  // (the VAOs come and go with the meshes)
+  void BindInstanceAttributes() const;
+
+  std::vector<DrawItem> items_;
+  // per frame indices of the distinct states
+  std::unordered_map<const Shader*, uint64_t> shaders_;
+  std::map<TextureSet, uint64_t> texture_sets_;
+  std::unordered_map<GLuint, uint64_t> vaos_;
+  std::map<MeshKey, uint64_t> meshes_;
+  // the index of each material is its position in materials_data_
+  std::unordered_map<const Material*, uint32_t> materials_;
+  std::vector<MaterialData> materials_data_;
+
+  // built by Submit() and uploaded every frame
+  std::vector<Instance> instances_;
+  std::vector<DrawCommand> commands_;
+  std::vector<Batch> batches_;
+  GLuint instance_buffer_ = 0;
+  GLuint command_buffer_ = 0;
+  GLuint material_buffer_ = 0;
+  GLuint material_texture_ = 0;
+
+  RenderStats stats_;
+};
+
+#endif  // RENDER_QUEUE_H
@@ -7,11 +7,13 @@
 #include "./mesh/mesh.h"
 #include "shader.h"
 #include "logger.h"
+#include "profiler.h"
 #include "utilities.h"
 
 Renderer::Renderer()
     : gl_mode_(GL_FILL),
       render_target_(1, 1),
+      frame_ubo_(0),
       tess_level_(1),
       displacement_height_(0.0F) {
   LOG_TRACE("Renderer()");
@@ -26,10 +28,43 @@ Renderer::Renderer()
 
   glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &max_tessel_level_);
 
+  glGenBuffers(1, &frame_ubo_);
+  glBindBuffer(GL_UNIFORM_BUFFER, frame_ubo_);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr,
+               GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+  glGenQueries(2, primitive_queries_.data());
+
+  // the two counters of the control shaders, in one buffer
+  GLint max_counters = 0;
+  GLint max_counter_buffers = 0;
+  glGetIntegerv(GL_MAX_TESS_CONTROL_ATOMIC_COUNTERS, &max_counters);
+  glGetIntegerv(GL_MAX_TESS_CONTROL_ATOMIC_COUNTER_BUFFERS,
+                &max_counter_buffers);
+  patch_stats_ = max_counters >= 2 && max_counter_buffers >= 1;
+  if (patch_stats_) {
+    glGenBuffers(2, patch_counters_.data());
+    for (const GLuint counters : patch_counters_) {
+      glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, counters);
+      glBufferData(GL_ATOMIC_COUNTER_BUFFER, sizeof(patch_counts_), nullptr,
+                   GL_DYNAMIC_READ);
+    }
+    glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+  } else {
+    LOG_WARN("No atomic counters in the control shaders, no patch stats");
+  }
+
   render_target_.Unbind();
 }
 
 Renderer::~Renderer() {
+  glDeleteBuffers(1, &frame_ubo_);
+  glDeleteQueries(2, primitive_queries_.data());
+  glDeleteBuffers(2, patch_counters_.data());
+  for (const GLsync fence : patch_fences_) {
+    glDeleteSync(fence);
+  }
   LOG_TRACE("~Renderer()");
 }
 
@@ -47,46 +82,147 @@ void Renderer::ToggleWireframe() {
   render_target_.Unbind();
 }
 
-void Renderer::Render(const Scene& scene, const Camera& camera) const {
+void Renderer::Render(const Scene& scene, const Camera& camera) {
+  ScopedTimer timer("render");
   render_target_.Bind();
+  Profiler::Instance().BeginGpu("render");
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-  for (const IRenderableObject* o : scene.objects()) {
-    const Shader* shader = o->GetShader();
-    shader->Enable();
-    // clang-format off
-    shader->SetUniformMat4("camera_view_matrix", camera.view_matrix());
-    shader->SetUniformMat4("camera_projection_matrix", camera.projection_matrix());
-
-    // this is for the fragment shader
-    shader->SetUniformVec3("camera_position", camera.position());
+  // what is the same for every object is uploaded once (the samplers are bound
+  // to their texture units in the shaders)
+  FrameUniforms frame = {};
+  frame.camera_view_matrix = camera.view_matrix();
+  frame.camera_projection_matrix = camera.projection_matrix();
+  frame.camera_position = camera.position();
+  frame.tessellation_level = static_cast<float>(tess_level_);
+  frame.displacement_height = displacement_height_;
+  frame.alpha = alpha_;
+  frame.tessellation_edge_pixels = tessellation_edge_pixels_;
+  frame.adaptive_tessellation = adaptive_tessellation_ ? 1 : 0;
+  frame.viewport_size = render_target_.size_vector();
+  frame.patch_culling = patch_culling_ ? 1 : 0;
 
-    shader->SetUnifromSampler("ColorTextSampler", TEXTURE_TYPE::DIFFUSE);
-    shader->SetUnifromSampler("DisplacementTextSampler", TEXTURE_TYPE::DISPLACEMENT);
+  const AmbientLight& ambient_light = scene.ambient_light();
+  frame.ambient_light_color = ambient_light.color();
+  frame.ambient_light_intensity = ambient_light.intensity();
 
-    shader->SetUniformFloat("alpha", alpha_);
-    shader->SetUniformFloat("tessellation_level", static_cast<float>(tess_level_));
-    shader->SetUniformFloat("displacement_height", displacement_height_);
+  const DirectionalLight& directional_light = scene.directional_light();
+  frame.directional_light_color = directional_light.color();
+  frame.directional_light_intensity = directional_light.intensity();
+  frame.directional_light_direction =
+      glm::normalize(directional_light.direction());
 
-    shader->SetUniformMat4("Model2World", o->transform().matrix());
+  glBindBuffer(GL_UNIFORM_BUFFER, frame_ubo_);
+  // orphaned, so the driver doesn't wait for the last frame to be done with it
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr,
+               GL_DYNAMIC_DRAW);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glBindBufferBase(GL_UNIFORM_BUFFER, kFrameDataBinding, frame_ubo_);
 
- 
-    const AmbientLight& ambient_light = scene.ambient_light();
-    shader->SetUniformVec3("ambient_light_color", ambient_light.color());
-    shader->SetUniformVec3("ambient_light_intensity", ambient_light.intensity());
+  const std::vector<IRenderableObject*> objects = scene.objects();
+  bounds_.clear();
+  for (const IRenderableObject* o : objects) {
+    BoundingVolume bounds = o->bounds();
+    // the displacement moves the vertices up to displacement_height_ along y
+    // in model space
+    if (!bounds.empty() && displacement_height_ > 0.0F) {
+      bounds.center.y += displacement_height_ * 0.5F;
+      bounds.extent.y += displacement_height_ * 0.5F;
+      bounds.radius += displacement_height_;
+    }
+    bounds = bounds.Transformed(o->transform().matrix());
+    // and phong tessellation bulges the triangles, by the same margin the
+    // control shaders add to their patches (in world space as theirs), so
+    // nothing culled here would have been kept there
+    if (!bounds.empty() && alpha_ > 0.0F) {
+      const float bulge = alpha_ * 2.0F * bounds.patch_radius;
+      bounds.extent += glm::vec3(bulge);
+      bounds.radius += bulge;
+    }
+    bounds_.push_back(bounds);
+  }
+  if (frustum_culling_) {
+    const Frustum frustum(camera.projection_matrix() * camera.view_matrix());
+    frustum.Test(bounds_, &visible_);
+  } else {
+    visible_.assign(objects.size(), 1);
+  }
 
-    const DirectionalLight& directional_light = scene.directional_light();
-    shader->SetUniformVec3("directional_light_color", directional_light.color());
-    shader->SetUniformVec3("directional_light_intensity", directional_light.intensity());
-    shader->SetUniformVec3("directional_light_direction", glm::normalize(directional_light.direction()));
-    // clang-format on
+  queue_.Clear();
+  int culled = 0;
+  for (std::size_t i = 0; i < objects.size(); i++) {
+    if (visible_[i] == 0) {
+      culled++;
+      continue;
+    }
+    objects[i]->SelectLOD(camera.position());
+    objects[i]->Submit(&queue_);
+  }
+  queue_.Sort();
+  if (patch_stats_) {
+    // the patch counters start from zero every frame
+    const std::array<GLuint, 2> zero = {0, 0};
+    glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, patch_counters_[query_slot_]);
+    glBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(zero), zero.data());
+    glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+    glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, 0, patch_counters_[query_slot_]);
+  }
+  glBeginQuery(GL_PRIMITIVES_GENERATED, primitive_queries_[query_slot_]);
+  queue_.Submit();
+  glEndQuery(GL_PRIMITIVES_GENERATED);
+  primitive_pending_[query_slot_] = true;
+  if (patch_stats_) {
+    glDeleteSync(patch_fences_[query_slot_]);
+    patch_fences_[query_slot_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
 
-    o->Draw();
+  // the query and the counters of the previous frame, the next one writes
+  // them again
+  query_slot_ = 1 - query_slot_;
+  if (primitive_pending_[query_slot_]) {
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(primitive_queries_[query_slot_],
+                       GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available != GL_FALSE) {
+      GLuint64 primitives = 0;
+      glGetQueryObjectui64v(primitive_queries_[query_slot_],
+                            GL_QUERY_RESULT, &primitives);
+      triangles_ = primitives;
+      primitive_pending_[query_slot_] = false;
+    }
+  }
+  GLsync& fence = patch_fences_[query_slot_];
+  if (fence != nullptr) {
+    const GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+      // the shader writes must be visible to the read back
+      glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+      glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, patch_counters_[query_slot_]);
+      glGetBufferSubData(GL_ATOMIC_COUNTER_BUFFER, 0, sizeof(patch_counts_),
+                         patch_counts_.data());
+      glBindBuffer(GL_ATOMIC_COUNTER_BUFFER, 0);
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
   }
 
+  stats_ = queue_.stats();
+  stats_.objects = static_cast<int>(objects.size()) - culled;
+  stats_.culled = culled;
+  stats_.triangles = triangles_;
+  stats_.patch_stats = patch_stats_;
+  stats_.patches = patch_counts_[0];
+  stats_.patches_culled = patch_counts_[1];
+
+  Profiler::Instance().EndGpu();
   render_target_.Unbind();
 }
 
+const RenderStats& Renderer::stats() const {
+  return stats_;
+}
+
 const FrameBuffer& Renderer::target() {
   return render_target_;
 }
@@ -113,4 +249,24 @@ float* Renderer::displacement_height() {
 
 float* Renderer::phong_alpha() {
   return &alpha_;
+}
+
+bool* Renderer::frustum_culling() {
+  return &frustum_culling_;
+}
+
+bool* Renderer::adaptive_tessellation() {
+  return &adaptive_tessellation_;
+}
+
+float* Renderer::tessellation_edge_pixels() {
+  return &tessellation_edge_pixels_;
+}
+
+bool* Renderer::patch_culling() {
+  return &patch_culling_;
+}
+
+bool Renderer::patch_stats() const {
+  return patch_stats_;
 }
\ No newline at end of file
@@ -1,18 +1,53 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
+#include <array>
+#include <cstdint>
+
 #include <GL/glew.h>
+#include <glm/glm.hpp>
 
 #include "scene.h"
 #include "shader.h"
 #include "framebuffer.h"
+#include "bounds.h"
 #include "camera.h"
+#include "render_queue.h"
+
+// the FrameData uniform block of the shaders with the std140 layout: a vec3
+// takes 16 bytes unless a float follows it
+struct FrameUniforms {
+  glm::mat4 camera_view_matrix;
+  glm::mat4 camera_projection_matrix;
+  glm::vec3 camera_position;
+  float tessellation_level;
+  glm::vec3 ambient_light_color;
+  float displacement_height;
+  glm::vec3 ambient_light_intensity;
+  float alpha;
+  glm::vec3 directional_light_color;
+  // target length of the tessellated edges on screen
+  float tessellation_edge_pixels;
+  glm::vec3 directional_light_intensity;
+  // 1 if the tessellation levels come from the edges length on screen, 0 if
+  // they are all tessellation_level
+  int32_t adaptive_tessellation;
+  glm::vec3 directional_light_direction;
+  // 1 if the control shaders discard the patches that can't be visible
+  int32_t patch_culling;
+  glm::vec2 viewport_size;
+  glm::vec2 padding1;
+};
+static_assert(sizeof(FrameUniforms) == 240,
+              "FrameUniforms must match the std140 FrameData block");
 
 class Renderer {
  public:
   Renderer();
   ~Renderer();
-  void Render(const Scene& scene, const Camera& camera) const;
+  void Render(const Scene& scene, const Camera& camera);
+  // the state changes of the last frame
+  [[nodiscard]] const RenderStats& stats() const;
 
   void ToggleWireframe();
   const FrameBuffer& target();
@@ -25,6 +60,16 @@ class Renderer {
   int max_tessel_level() const;
 
   float* phong_alpha();
+  bool* frustum_culling();
+  // the levels from the length of the edges on screen instead of tess_level
+  bool* adaptive_tessellation();
+  float* tessellation_edge_pixels();
+  // the control shaders discard the patches outside the frustum or facing away
+  bool* patch_culling();
+  // true if the control shaders can count their patches with atomic counters,
+  // GL 4.2 allows 0 of them there. The programs are built with PATCH_STATS
+  // only then
+  [[nodiscard]] bool patch_stats() const;
 
  private:
   // for wireframe
@@ -32,9 +77,40 @@ class Renderer {
 
   FrameBuffer render_target_;
 
+  // the FrameData block, filled once per frame and shared by every program
+  GLuint frame_ubo_;
+
+  // reused every frame, so its vectors keep their capacity
+  RenderQueue queue_;
+  // world space bounds of the scene objects and the result of the frustum
+  // test, same reason
+  std::vector<BoundingVolume> bounds_;
+  std::vector<uint8_t> visible_;
+  RenderStats stats_;
+  bool frustum_culling_ = true;
+
   int tess_level_;
   int max_tessel_level_;
   float displacement_height_;
+  bool adaptive_tessellation_ = false;
+  float tessellation_edge_pixels_ = 16.0F;
+
+  // GL_PRIMITIVES_GENERATED around the scene, double buffered: a frame reads
+  // the query of the previous one if it's ready, so it never waits for the GPU
+  std::array<GLuint, 2> primitive_queries_ = {0, 0};
+  std::array<bool, 2> primitive_pending_ = {false, false};
+  // the query and the patch counters written this frame, 0 or 1
+  std::size_t query_slot_ = 0;
+  uint64_t triangles_ = 0;
+
+  bool patch_culling_ = true;
+  bool patch_stats_ = false;
+  // the patch counters of the control shaders (2 uints at the atomic counter
+  // binding 0), double buffered like the queries: a fence tells when the
+  // counters of the previous frame can be read without waiting
+  std::array<GLuint, 2> patch_counters_ = {0, 0};
+  std::array<GLsync, 2> patch_fences_ = {nullptr, nullptr};
+  std::array<GLuint, 2> patch_counts_ = {0, 0};
 
   float alpha_ = 0.5;
 };
@@ -0,0 +1,202 @@
+#include "scene_loader.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+#include "logger.h"
+#include "parallel.h"
+#include "./mesh/model_importer.h"
+
+SceneLoader::SceneLoader() : priority_(-1), stop_(false) {
+  LOG_TRACE("SceneLoader()");
+}
+
+SceneLoader::~SceneLoader() {
+  LOG_TRACE("~SceneLoader()");
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  // the workers finish the model they are reading and stop
+  for (std::thread& t : workers_) {
+    t.join();
+  }
+
+  // what was read for the scenes that never got built
+  for (const PendingScene& x : scenes_) {
+    if (x.state == SCENE_STATE::LOADING) {
+      for (const std::vector<ImportedMesh>& model : x.read) {
+        DeleteImportedMeshes(model);
+      }
+    }
+  }
+}
+
+void SceneLoader::Add(Scene* scene, const std::vector<ModelSource>& models,
+                      const BuildFunction& build) {
+  assert(workers_.empty());
+  PendingScene x;
+  x.scene = scene;
+  x.models = models;
+  x.build = build;
+  x.read.resize(models.size());
+  x.next_model = 0;
+  x.n_read = 0;
+  x.state = SCENE_STATE::LOADING;
+  scenes_.push_back(x);
+}
+
+void SceneLoader::Start() {
+  std::size_t n_models = 0;
+  for (const PendingScene& x : scenes_) {
+    n_models += x.models.size();
+  }
+  const std::size_t n_workers =
+      std::min<std::size_t>(WorkerCount(), n_models);
+  LOG_INFO("Loading {} scenes ({} models) with {} threads", scenes_.size(),
+           n_models, n_workers);
+  for (std::size_t i = 0; i < n_workers; i++) {
+    workers_.emplace_back(&SceneLoader::WorkerLoop, this);
+  }
+}
+
+void SceneLoader::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_) {
+    const int scene_i = NextScene(false);
+    if (scene_i == -1) {
+      return;  // nothing left to read
+    }
+    PendingScene& scene = scenes_[scene_i];
+    const int model_i = scene.next_model++;
+    const ModelSource source = scene.models[model_i];
+
+    lock.unlock();
+    std::vector<ImportedMesh> read;
+    std::exception_ptr error;
+    try {
+      read = ReadModel(source.path, source.opts);
+    } catch (...) {
+      LOG_ERROR("Failed to read \"{}\"", source.path.string());
+      error = std::current_exception();
+    }
+    lock.lock();
+
+    // scenes_ is not resized after Start(), the reference is still valid
+    scene.read[model_i] = std::move(read);
+    scene.n_read++;
+    if (error && !scene.error) {
+      scene.error = error;
+    }
+  }
+}
+
+int SceneLoader::NextScene(const bool ready_to_build) const {
+  auto qualifies = [this, ready_to_build](const int i) {
+    const PendingScene& x = scenes_[i];
+    if (x.state != SCENE_STATE::LOADING) {
+      return false;
+    }
+    const int n_models = static_cast<int>(x.models.size());
+    if (ready_to_build) {
+      return x.n_read == n_models;
+    }
+    // the other models of a scene that already failed are not worth reading
+    return x.next_model < n_models && !x.error;
+  };
+
+  if (priority_ != -1 && qualifies(priority_)) {
+    return priority_;
+  }
+  for (int i = 0; i < static_cast<int>(scenes_.size()); i++) {
+    if (qualifies(i)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void SceneLoader::Update() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  int scene_i = NextScene(true);
+  if (scene_i == -1) {
+    // a failed scene is done as soon as its workers are
+    for (int i = 0; i < static_cast<int>(scenes_.size()); i++) {
+      const PendingScene& x = scenes_[i];
+      if (x.state == SCENE_STATE::LOADING && x.error &&
+          x.n_read == x.next_model) {
+        scene_i = i;
+        break;
+      }
+    }
+    if (scene_i == -1) {
+      return;
+    }
+  }
+  PendingScene& x = scenes_[scene_i];
+  const std::vector<std::vector<ImportedMesh>> read = std::move(x.read);
+  const std::exception_ptr error = x.error;
+  lock.unlock();
+
+  SCENE_STATE state = SCENE_STATE::FAILED;
+  if (error) {
+    for (const std::vector<ImportedMesh>& model : read) {
+      DeleteImportedMeshes(model);
+    }
+  } else {
+    try {
+      x.build(x.scene, read);
+      state = SCENE_STATE::LOADED;
+    } catch (...) {
+      // the meshes were handed over to the creators, what they made before the
+      // failure stays in the scene
+    }
+  }
+
+  if (state == SCENE_STATE::LOADED) {
+    LOG_INFO("Scene \"{}\" loaded", x.scene->name());
+  } else {
+    LOG_ERROR("Failed to load the scene \"{}\"", x.scene->name());
+  }
+
+  lock.lock();
+  x.state = state;
+}
+
+void SceneLoader::Prioritize(const Scene* scene) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  priority_ = IndexOf(scene);
+}
+
+bool SceneLoader::IsLoaded(const Scene* scene) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int i = IndexOf(scene);
+  return i == -1 || scenes_[i].state == SCENE_STATE::LOADED;
+}
+
+bool SceneLoader::IsFailed(const Scene* scene) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int i = IndexOf(scene);
+  return i != -1 && scenes_[i].state == SCENE_STATE::FAILED;
+}
+
+float SceneLoader::Progress(const Scene* scene) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const int i = IndexOf(scene);
+  if (i == -1 || scenes_[i].state != SCENE_STATE::LOADING ||
+      scenes_[i].models.empty()) {
+    return 1.0F;
+  }
+  return static_cast<float>(scenes_[i].n_read) /
+         static_cast<float>(scenes_[i].models.size());
+}
+
+int SceneLoader::IndexOf(const Scene* scene) const {
+  for (int i = 0; i < static_cast<int>(scenes_.size()); i++) {
+    if (scenes_[i].scene == scene) {
+      return i;
+    }
+  }
+  return -1;
+}
@@ -0,0 +1,91 @@
+#ifndef SCENE_LOADER_H
+#define SCENE_LOADER_H
+
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "scene.h"
+#include "./mesh/importer.h"
+
+// a model needed by a scene, read with ReadModel()
+struct ModelSource {
+  std::filesystem::path path;
+  Options opts;
+};
+
+// Builds the scenes in the background, so the window comes up before any model
+// is imported. A scene is described by the models it needs and by a function
+// that makes its objects out of them:
+// - the models are read by worker threads (ReadModel() doesn't touch OpenGL),
+//   the ones of the prioritized scene first
+// - when all of them are read, Update() runs the function on the GL thread,
+//   where the meshes are uploaded and the objects added to the scene
+// Until then the scene is just empty
+class SceneLoader {
+ public:
+  // models[i] is what was read for the i-th ModelSource of the scene, the
+  // function takes the ownership of it (through the creators)
+  using BuildFunction = std::function<void(
+      Scene* scene, const std::vector<std::vector<ImportedMesh>>& models)>;
+
+  SceneLoader();
+  ~SceneLoader();
+  SceneLoader(const SceneLoader& other) = delete;
+  SceneLoader& operator=(const SceneLoader& other) = delete;
+  SceneLoader(SceneLoader&& other) = delete;
+  SceneLoader& operator=(SceneLoader&& other) = delete;
+
+  // the loader doesn't own the scene, it only fills it. All the scenes must be
+  // added before Start()
+  void Add(Scene* scene, const std::vector<ModelSource>& models,
+           const BuildFunction& build);
+  // starts the worker threads
+  void Start();
+  // must be called on the GL thread (once per frame), it builds at most one
+  // ready scene per call so a single frame never uploads everything
+  void Update();
+  // its models are read before the ones of the other scenes
+  void Prioritize(const Scene* scene);
+
+  [[nodiscard]] bool IsLoaded(const Scene* scene) const;
+  [[nodiscard]] bool IsFailed(const Scene* scene) const;
+  // from 0 to 1, the fraction of its models that have been read
+  [[nodiscard]] float Progress(const Scene* scene) const;
+
+ private:
+  enum class SCENE_STATE {
+    LOADING,
+    LOADED,
+    FAILED
+  };
+
+  struct PendingScene {
+    Scene* scene;
+    std::vector<ModelSource> models;
+    BuildFunction build;
+    std::vector<std::vector<ImportedMesh>> read;
+    int next_model;  // the first one no worker has taken yet
+    int n_read;      // finished, successfully or not
+    std::exception_ptr error;
+    SCENE_STATE state;
+  };
+
+  void WorkerLoop();
+  // the prioritized scene if it qualifies, otherwise the first one that does
+  // (-1 if none): with ready_to_build the scenes whose models are all read,
+  // otherwise the ones with a model left to read. mutex_ must be locked
+  int NextScene(bool ready_to_build) const;
+  int IndexOf(const Scene* scene) const;
+
+  std::vector<PendingScene> scenes_;
+  int priority_;
+  bool stop_;
+  std::vector<std::thread> workers_;
+  mutable std::mutex mutex_;
+};
+
+#endif  // SCENE_LOADER_H
@@ -1,5 +1,6 @@
 #include "shader.h"
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -11,7 +12,7 @@
 
 #define INVALID_UNIFORM_LOCATION 0xffffffff
 
-Shader::Shader() {
+Shader::Shader() : program_(0) {
   LOG_TRACE("Shader()");
 }
 
@@ -59,6 +60,10 @@ void Shader::AddShaderFile(const GLenum type,
   shaders_.push_back(res);
 }
 
+void Shader::AddDefine(const std::string& name) {
+  defines_ += "#define " + name + "\n";
+}
+
 GLuint Shader::CompileShader(const GLenum type, const std::string& src) {
   GLuint shader = glCreateShader(type);
   const GLchar* source = src.c_str();
@@ -91,7 +96,14 @@ void Shader::Init() {
   program_ = glCreateProgram();
 
   for (const ShaderSource& x : shaders_) {
-    GLuint currentShader = CompileShader(x.type, x.source);
+    std::string source = x.source;
+    if (!defines_.empty()) {
+      // #version has to be the first line, #line keeps the numbers of the
+      // error messages those of the file
+      const std::size_t after_version = source.find('\n') + 1;
+      source.insert(after_version, defines_ + "#line 2\n");
+    }
+    GLuint currentShader = CompileShader(x.type, source);
     compiled_shaders_.push_back(currentShader);
 
     // Attach our shaders to our program
@@ -131,6 +143,30 @@ void Shader::Init() {
   if (isLinked == GL_FALSE) {
     throw ProgramCreationException();
   }
+
+  ReflectUniforms();
+}
+
+void Shader::ReflectUniforms() {
+  GLint n_uniforms = 0;
+  glGetProgramiv(program_, GL_ACTIVE_UNIFORMS, &n_uniforms);
+  GLint max_length = 0;
+  glGetProgramiv(program_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+  std::vector<GLchar> name(std::max(max_length, 1));
+  for (GLint i = 0; i < n_uniforms; i++) {
+    GLsizei length = 0;
+    GLint size = 0;
+    GLenum type = 0;
+    glGetActiveUniform(program_, static_cast<GLuint>(i), max_length, &length,
+                       &size, &type, name.data());
+    const std::string uniform_name(name.data(), length);
+    // the members of a uniform block have no location
+    const GLint location = glGetUniformLocation(program_, uniform_name.c_str());
+    if (location != -1) {
+      uniform_locations_[uniform_name] = location;
+    }
+  }
 }
 
 // TODO maybe improvable with OpenGL 4.1
@@ -148,14 +184,13 @@ GLuint Shader::program_id() const {
 }
 
 GLint Shader::GetUniformLocation(const std::string& uniform_name) const {
-  GLint location = glGetUniformLocation(program_, uniform_name.c_str());
-
-  if (location == -1) {
+  const auto it = uniform_locations_.find(uniform_name);
+  if (it == uniform_locations_.end()) {
     LOG_WARN("Unable to get uniform location {}", uniform_name);
     return INVALID_UNIFORM_LOCATION;
   }
 
-  return location;
+  return it->second;
 }
 
 void Shader::SetUniformMat4(const std::string& uniform_name,
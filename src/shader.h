@@ -12,6 +12,14 @@
 #include "logger.h"
 #include "texture.h"
 
+// binding point of the FrameData uniform block, that every program shares
+// (see FrameUniforms in renderer.h). The samplers are bound to the texture
+// unit of their TEXTURE_TYPE in the shaders themselves, the per object data
+// comes from instance attributes (see RenderQueue)
+constexpr GLuint kFrameDataBinding = 0;
+// texture unit of the material buffer, after the ones of the TEXTURE_TYPEs
+constexpr GLuint kMaterialBufferUnit = 3;
+
 // this actually represents a shader program (that can have multiple shaders
 // files maybe)
 class Shader {
@@ -27,6 +35,10 @@ class Shader {
    */
   void AddShaderFile(const GLenum type, const std::filesystem::path& path);
 
+  // #define name in every shader of the program, after their #version line.
+  // It must be called before Init()
+  void AddDefine(const std::string& name);
+
   /**
    * @brief compiling and linking all the added shaders to a program
    *
@@ -42,6 +54,7 @@ class Shader {
 
   GLuint program_id() const;
 
+  // by name, the location comes from the table filled by Init()
   void SetUniformMat4(const std::string& uniform_name,
                       const glm::mat4& matrix) const;
   void SetUniformFloat(const std::string& uniform_name,
@@ -55,6 +68,9 @@ class Shader {
 
  private:
   static GLuint CompileShader(const GLenum type, const std::string& src);
+  // reads the active uniforms of the linked program (the ones outside the
+  // uniform blocks) into uniform_locations_
+  void ReflectUniforms();
   GLint GetUniformLocation(const std::string& uniform_name) const;
 
   struct ShaderSource {
@@ -63,9 +79,13 @@ class Shader {
   };
 
   std::vector<ShaderSource> shaders_;
+  // the #define lines added by AddDefine()
+  std::string defines_;
   std::vector<GLuint> compiled_shaders_;
 
   GLuint program_;
+
+  std::unordered_map<std::string, GLint> uniform_locations_;
 };
 
 // singleton class that handles shaders
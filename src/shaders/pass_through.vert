@@ -4,12 +4,17 @@
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 textcoord;
+// per instance (ATTRIB_ID::MODEL_TO_WORLD)
+layout (location = 3) in mat4 model_to_world;
+layout (location = 7) in uint material;
 
 // interface block
 out VS_OUT {
   vec3 normal_;
   vec3 position_;
   vec2 textcoord_;
+  mat4 model_to_world_;
+  flat uint material_;
 } vs_out;
 
 // Vertex shader that does not compute the transformations, because they are 
@@ -20,4 +25,6 @@ void main() {
   vs_out.normal_ = normal;
   vs_out.position_ = position;
   vs_out.textcoord_ = textcoord;
+  vs_out.model_to_world_ = model_to_world;
+  vs_out.material_ = material;
 }
@@ -10,28 +10,43 @@ vec3 fragment_normal = fs_in.normal_;
 vec3 fragment_position = fs_in.position_;
 vec2 fragment_textcoord = fs_in.textcoord_;
 
-// Informazioni di luce ambientale 
-uniform vec3 ambient_light_color;
-uniform vec3 ambient_light_intensity;
+// per frame data, the same block in every shader (FrameUniforms in renderer.h)
+layout(std140, binding = 0) uniform FrameData {
+  mat4 camera_view_matrix;
+  mat4 camera_projection_matrix;
+  vec3 camera_position;
+  float tessellation_level;
+  vec3 ambient_light_color;
+  float displacement_height;
+  vec3 ambient_light_intensity;
+  float alpha;
+  vec3 directional_light_color;
+  float tessellation_edge_pixels;
+  vec3 directional_light_intensity;
+  int adaptive_tessellation;
+  vec3 directional_light_direction;
+  int patch_culling;
+  vec2 viewport_size;
+};
 
-// Informazioni di luce direzionale 
-uniform vec3 directional_light_color;
-uniform vec3 directional_light_intensity;
-uniform vec3 directional_light_direction;
+// the materials of the frame, 3 texels each: ambient, diffuse and specular
+// reflectivity with the glossiness exponent in the last w (see RenderQueue)
+layout(binding = 3) uniform samplerBuffer Materials;
+flat in uint material_;
 
-uniform vec3 material_ambient_reflectivity;
-uniform vec3 material_diffuse_reflectivity;
-uniform vec3 material_specular_reflectivity;
-uniform float material_specular_glossiness_exponent;
-
-// Posizione della camera in coordinate mondo
-uniform vec3 camera_position;
-
-uniform sampler2D ColorTextSampler;
+// texture unit of TEXTURE_TYPE::DIFFUSE
+layout(binding = 0) uniform sampler2D ColorTextSampler;
 
 layout(location = 0) out vec4 out_color;
 
 void main() {
+  const int material_texel = int(material_) * 3;
+  vec3 material_ambient_reflectivity = texelFetch(Materials, material_texel).rgb;
+  vec3 material_diffuse_reflectivity = texelFetch(Materials, material_texel + 1).rgb;
+  vec4 material_specular = texelFetch(Materials, material_texel + 2);
+  vec3 material_specular_reflectivity = material_specular.rgb;
+  float material_specular_glossiness_exponent = material_specular.w;
+
   vec4 material_color = texture(ColorTextSampler, fragment_textcoord);
 
   // NOTE: material_diffuse_reflectivity is basically the base color of the material
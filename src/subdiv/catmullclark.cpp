@@ -1,23 +1,60 @@
 #include "catmullclark.h"
 
+#include <stdexcept>
+
 #include "../logger.h"
+#include "../mesh/quadrangulation.h"
 
-// TODO adapt for any mesh in input
-// based on
-// https://en.wikipedia.org/wiki/Catmull%E2%80%93Clark_subdivision_surface
 QuadMesh* CatmullClarkSubdiv::subdivide(QuadMesh* in, int n_steps) {
   if (!in->IsManifold()) {
     // TODO deal with boundaries
     // ideally you should never be here
-    LOG_ERROR("MESH IS NOT MANIFOLD");
-    throw;
+    throw std::invalid_argument("Catmull-Clark needs a manifold mesh");
   }
 
-  const HalfEdgeData* hfd = in->half_edge_data();
-  HalfEdgeData* subdivided = new HalfEdgeData(*hfd);
+  HalfEdgeData* subdivided = new HalfEdgeData(*in->half_edge_data());
+  SubdivideLevels(subdivided, n_steps);
+  return new QuadMesh(subdivided, in->material());
+}
 
-  // implementation here
+IMesh* CatmullClarkSubdiv::subdivide(TriMesh* in, int n_steps) {
+  if (!in->IsManifold()) {
+    throw std::invalid_argument("Catmull-Clark needs a manifold mesh");
+  }
+  if (n_steps == 0) {
+    // the paired mesh can't be drawn as patches, and there is nothing to do
+    return in->clone();
+  }
+
+  HalfEdgeData* subdivided = new HalfEdgeData(*in->half_edge_data());
+  const TrianglePairing pairing;
+  pairing.Pair(subdivided);
+  SubdivideLevels(subdivided, n_steps);
+  return new QuadMesh(subdivided, in->material());
+}
+
+IMesh* CatmullClarkSubdiv::subdivide(PolyMesh* in, int n_steps) {
+  if (!in->IsManifold()) {
+    throw std::invalid_argument("Catmull-Clark needs a manifold mesh");
+  }
+  if (n_steps == 0) {
+    return in->clone();
+  }
+
+  HalfEdgeData* subdivided = new HalfEdgeData(*in->half_edge_data());
+  SubdivideLevels(subdivided, n_steps);
+  return new QuadMesh(subdivided, in->material());
+}
+
+// based on
+// https://en.wikipedia.org/wiki/Catmull%E2%80%93Clark_subdivision_surface
+// the faces can have any number of sides (every level turns an n-gon into n
+// quads), but the mesh has to be closed
+void CatmullClarkSubdiv::SubdivideLevels(HalfEdgeData* subdivided,
+                                         int n_steps) const {
   for (int i = 0; i < n_steps; i++) {
+    const level_clock::time_point level_start = level_clock::now();
+
     // new face point at the center
     std::unordered_map<Face*, Vertex*> new_face_points;
     for (Face* f : *subdivided->faces()) {
@@ -318,8 +355,7 @@ QuadMesh* CatmullClarkSubdiv::subdivide(QuadMesh* in, int n_steps) {
     }
     delete subdivided->faces();
     subdivided->faces(new_subdivided_faces);
-  }
 
-  QuadMesh* output = new QuadMesh(subdivided, in->material());
-  return output;
+    EndLevel(subdivided, "catmull", i + 1, level_start);
+  }
 }
@@ -7,19 +7,33 @@ class CatmullClarkSubdiv final : public ISubdivision {
  public:
   // I can't specify the argument type because it violates the Liskov
   // Substitution Principle
-  [[nodiscard]] QuadMesh* subdivide(IMesh* in, int n_steps) override {
+  [[nodiscard]] IMesh* subdivide(IMesh* in, int n_steps) override {
+    // the architecture of the program
+    // (AvailableSubdivAlgosFactory::GetAvailableAlgos()) should guarantee
+    // that one of these works
     if (QuadMesh* d = dynamic_cast<QuadMesh*>(in); d != nullptr) {
-      // the architecture of the program
-      // (AvailableSubdivAlgosFactory::GetAvailableAlgos()) should guarantee
-      // that this works
+      return subdivide(d, n_steps);
+    }
+    if (TriMesh* d = dynamic_cast<TriMesh*>(in); d != nullptr) {
+      return subdivide(d, n_steps);
+    }
+    if (PolyMesh* d = dynamic_cast<PolyMesh*>(in); d != nullptr) {
       return subdivide(d, n_steps);
     }
     return nullptr;
   }
 
   [[nodiscard]] QuadMesh* subdivide(QuadMesh* in, int n_steps);
+  // the triangles are paired into quads first (TrianglePairing), the first
+  // level then works on a quad dominant mesh instead of a split one.
+  // With 0 steps it returns a copy of in
+  [[nodiscard]] IMesh* subdivide(TriMesh* in, int n_steps);
+  // every n-gon becomes n quads. With 0 steps it returns a copy of in
+  [[nodiscard]] IMesh* subdivide(PolyMesh* in, int n_steps);
 
  private:
+  // works in place on closed meshes with mixed faces (triangles, quads...)
+  void SubdivideLevels(HalfEdgeData* subdivided, int n_steps) const;
 };
 
-#endif  // CATMULLCLARK_H
\ No newline at end of file
+#endif  // CATMULLCLARK_H
@@ -14,6 +14,7 @@ TriMesh* LoopSubdiv::subdivide(TriMesh* in, int n_steps) {
 
   for (int i = 0; i < n_steps; i++) {
     LOG_INFO("loop subdiv {}", i + 1);
+    const level_clock::time_point level_start = level_clock::now();
 
     // computing the new vertex positions for the even vertices
     std::unordered_map<Vertex*, Vertex> even_vertex_pos;
@@ -153,6 +154,8 @@ TriMesh* LoopSubdiv::subdivide(TriMesh* in, int n_steps) {
       // v->normal = n_v.normal;
       v->text_coords = n_v.text_coords;
     }
+
+    EndLevel(subdivided, "loop", i + 1, level_start);
   }
 
   TriMesh* output = new TriMesh(subdivided, in->material());
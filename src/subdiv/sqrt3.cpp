@@ -25,6 +25,7 @@ TriMesh* Sqrt3Subdiv::subdivide(TriMesh* in, int n_steps) {
 
   for (int i = 0; i < n_steps; i++) {
     LOG_INFO("sqrt3 subdiv {}", i + 1);
+    const level_clock::time_point level_start = level_clock::now();
 
     // computing the new vertex positions for the even vertices
     std::unordered_map<Face*, Vertex*> odd_vertices;
@@ -216,6 +217,8 @@ TriMesh* Sqrt3Subdiv::subdivide(TriMesh* in, int n_steps) {
       // v->normal = n_v.normal;
       v->text_coords = n_v.text_coords;
     }
+
+    EndLevel(subdivided, "sqrt3", i + 1, level_start);
   }
 
   TriMesh* output = new TriMesh(subdivided, in->material());
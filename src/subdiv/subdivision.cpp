@@ -1,9 +1,37 @@
 #include "subdivision.h"
 
+#include "../logger.h"
+
 ISubdivision::~ISubdivision() {
   //
 }
 
+void ISubdivision::spatial_reorder(const bool enabled) {
+  spatial_reorder_ = enabled;
+}
+
+bool ISubdivision::spatial_reorder() const {
+  return spatial_reorder_;
+}
+
+void ISubdivision::EndLevel(HalfEdgeData* m, const std::string& algo_name,
+                            int level,
+                            const level_clock::time_point& level_start) const {
+  using ms = std::chrono::duration<float, std::milli>;
+
+  const ms level_time = level_clock::now() - level_start;
+  LOG_INFO("{} subdiv {} took {:.3f} ms ({} faces)", algo_name, level,
+           level_time.count(), m->faces()->size());
+
+  if (spatial_reorder_) {
+    const level_clock::time_point reorder_start = level_clock::now();
+    m->SpatialReorder();
+    const ms reorder_time = level_clock::now() - reorder_start;
+    LOG_INFO("spatial reorder after {} subdiv {} took {:.3f} ms", algo_name,
+             level, reorder_time.count());
+  }
+}
+
 NoneSubdiv::~NoneSubdiv() {
   //
 }
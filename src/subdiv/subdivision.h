@@ -1,6 +1,8 @@
 #ifndef SUBDIVISION_H
 #define SUBDIVISION_H
 
+#include <chrono>
+
 #include "../mesh/mesh.h"
 
 // [chapter 17.5 in RealTimeRendering 4th edition]
@@ -14,7 +16,22 @@ class ISubdivision {
 
   [[nodiscard]] virtual IMesh* subdivide(IMesh* in, int n_steps) = 0;
 
- private:
+  // when enabled the halfedge data gets spatially reordered
+  // (HalfEdgeData::SpatialReorder()) at the end of every subdivision level, so
+  // that the next level traverses memory in a cache friendly order
+  void spatial_reorder(const bool enabled);
+  [[nodiscard]] bool spatial_reorder() const;
+
+ protected:
+  using level_clock = std::chrono::steady_clock;
+
+  // to be called at the end of every level: it logs how long the level took
+  // and then, if enabled, reorders the data for the next level (the reorder
+  // time is logged on its own, so the two can be compared)
+  void EndLevel(HalfEdgeData* m, const std::string& algo_name, int level,
+                const level_clock::time_point& level_start) const;
+
+  bool spatial_reorder_ = false;
 };
 
 class NoneSubdiv final : public ISubdivision {
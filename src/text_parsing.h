@@ -0,0 +1,146 @@
+#ifndef TEXT_PARSING_H
+#define TEXT_PARSING_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// Small number parsers for text mesh formats (ply, obj) that work directly on
+// a [p, end) buffer (the file does not need to be null terminated) and move p
+// past what they read. They don't look at the locale and don't allocate, which
+// is what makes std::strtod / std::istream so slow on big files.
+
+inline bool IsBlank(const char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline void SkipBlanks(const char*& p, const char* end) {
+  while (p < end && IsBlank(*p)) {
+    p++;
+  }
+}
+
+// moves p to the first character of the next line (or to end)
+inline void SkipLine(const char*& p, const char* end) {
+  const void* nl = std::memchr(p, '\n', end - p);
+  p = (nl == nullptr) ? end : static_cast<const char*>(nl) + 1;
+}
+
+// skips the blanks before the number, false if there are no digits
+inline bool ParseUint(const char*& p, const char* end, uint64_t* out) {
+  SkipBlanks(p, end);
+  const char* start = p;
+  uint64_t value = 0;
+  while (p < end && static_cast<unsigned char>(*p - '0') < 10) {
+    value = value * 10 + static_cast<uint64_t>(*p - '0');
+    p++;
+  }
+  *out = value;
+  return p != start;
+}
+
+inline bool ParseInt(const char*& p, const char* end, int64_t* out) {
+  SkipBlanks(p, end);
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    p++;
+  }
+  uint64_t value = 0;
+  if (!ParseUint(p, end, &value)) {
+    return false;
+  }
+  *out = negative ? -static_cast<int64_t>(value) : static_cast<int64_t>(value);
+  return true;
+}
+
+// decimal floats like "-12.5e-3". The mantissa is accumulated in an integer
+// (up to 19 significant digits) and scaled once by a power of ten, which is
+// exact enough for float output. Anything unusual (nan, inf, hex floats) goes
+// through strtod on a small copy
+inline bool ParseFloat(const char*& p, const char* end, float* out) {
+  static constexpr double kPow10[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+      1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+      1e22};
+
+  SkipBlanks(p, end);
+  const char* start = p;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    p++;
+  }
+
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool any_digit = false;
+  while (p < end && static_cast<unsigned char>(*p - '0') < 10) {
+    if (digits < 19) {
+      mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+      digits += (mantissa != 0) ? 1 : 0;
+    } else {
+      exponent++;  // the digit is dropped but it still counts
+    }
+    any_digit = true;
+    p++;
+  }
+  if (p < end && *p == '.') {
+    p++;
+    while (p < end && static_cast<unsigned char>(*p - '0') < 10) {
+      if (digits < 19) {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+        digits += (mantissa != 0) ? 1 : 0;
+        exponent--;
+      }
+      any_digit = true;
+      p++;
+    }
+  }
+
+  if (!any_digit) {
+    // not a plain decimal number
+    char buffer[64];
+    p = start;
+    std::size_t n = 0;
+    while (p + n < end && n < sizeof(buffer) - 1 && !IsBlank(p[n]) &&
+           p[n] != '\n') {
+      n++;
+    }
+    std::memcpy(buffer, p, n);
+    buffer[n] = '\0';
+    char* parsed_end = nullptr;
+    *out = std::strtof(buffer, &parsed_end);
+    p += parsed_end - buffer;
+    return parsed_end != buffer;
+  }
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const char* e = p + 1;
+    int64_t exp_value = 0;
+    if (ParseInt(e, end, &exp_value)) {
+      exponent += static_cast<int>(exp_value);
+      p = e;
+    }
+  }
+
+  double value = static_cast<double>(mantissa);
+  if (exponent < 0) {
+    while (exponent < -22) {
+      value /= 1e22;
+      exponent += 22;
+    }
+    value /= kPow10[-exponent];
+  } else {
+    while (exponent > 22) {
+      value *= 1e22;
+      exponent -= 22;
+    }
+    value *= kPow10[exponent];
+  }
+  *out = static_cast<float>(negative ? -value : value);
+  return true;
+}
+
+#endif  // TEXT_PARSING_H
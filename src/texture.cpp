@@ -1,6 +1,12 @@
 #include "texture.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <filesystem>
+#include <string_view>
+#include <system_error>
+#include <utility>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -8,146 +14,576 @@
 #include <assimp/texture.h>
 
 #include "logger.h"
+#include "parallel.h"
+#include "texture_cache.h"
+#include "texture_encoder.h"
 #include "utilities.h"
 
-Texture::Texture(const TEXTURE_TYPE type) : id_(-1), type_(type) {
-  LOG_TRACE("Texture(const TEXTURE_TYPE)");
-
-  LOG_INFO("Loading default texture");
-  int width, height, channels;
-  unsigned char* image = nullptr;
-
-  stbi_set_flip_vertically_on_load(true);
+// stb_image can flip on load, but that's a global flag and decoding happens on
+// several threads, so the rows are flipped while copying them out instead
+static bool CopyFlipped(unsigned char* image, const int width, const int height,
+                        TextureImage* out) {
+  if (image == nullptr) {
+    return false;
+  }
+  const std::size_t row = static_cast<std::size_t>(width) * 4;
+  auto pixels = std::make_shared<std::vector<unsigned char>>(row * height);
+  for (int y = 0; y < height; y++) {
+    std::memcpy(pixels->data() + row * (height - 1 - y), image + row * y, row);
+  }
+  stbi_image_free(image);
+  out->width = width;
+  out->height = height;
+  out->pixels = pixels;
+  TextureManager::Instance().AddDecoded(*out);
+  return true;
+}
 
-  // 4 means desired channels, in this case we want 4 because RGBA
-  std::string default_path;
+// the texels of an uncompressed embedded texture are already decoded, they are
+// only flipped and swizzled from BGRA to RGBA in the copy that every image
+// gets (the aiScene is gone by the time the texture is uploaded)
+static void CopyTexels(const aiTexture* embedded, TextureImage* out) {
+  const int width = static_cast<int>(embedded->mWidth);
+  const int height = static_cast<int>(embedded->mHeight);
+  auto pixels = std::make_shared<std::vector<unsigned char>>(
+      static_cast<std::size_t>(width) * height * 4);
+  for (int y = 0; y < height; y++) {
+    const aiTexel* src = embedded->pcData + static_cast<std::size_t>(width) * y;
+    unsigned char* dst =
+        pixels->data() + static_cast<std::size_t>(width) * 4 * (height - 1 - y);
+    for (int x = 0; x < width; x++) {
+      dst[x * 4 + 0] = src[x].r;
+      dst[x * 4 + 1] = src[x].g;
+      dst[x * 4 + 2] = src[x].b;
+      dst[x * 4 + 3] = src[x].a;
+    }
+  }
+  out->width = width;
+  out->height = height;
+  out->pixels = pixels;
+  TextureManager::Instance().AddDecoded(*out);
+}
 
+static std::string DefaultTexturePath(const TEXTURE_TYPE type) {
   switch (type) {
     case TEXTURE_TYPE::DIFFUSE:
-      default_path = "white.png";  // Neutral element for product is 1
-      break;
+      return "white.png";  // Neutral element for product is 1
     case TEXTURE_TYPE::DISPLACEMENT:
-      default_path = "black.png";  // Neutral element for sum is 0
-      break;
+      return "black.png";  // Neutral element for sum is 0
     default:
-      break;
+      return "";
   }
+}
 
-  image = stbi_load(default_path.c_str(), &width, &height, &channels, 4);
-  if (image == nullptr) {
+static std::string DefaultTextureKey(const TEXTURE_TYPE type) {
+  return "default:" + DefaultTexturePath(type);
+}
+
+// the encoding depends on the type, so the same image used as two types is
+// two textures
+static std::string TypeKey(const TEXTURE_TYPE type) {
+  return std::to_string(to_underlying(type));
+}
+
+// the same file reached through different relative paths is the same texture
+static std::string FileTextureKey(const std::filesystem::path& path,
+                                  const TEXTURE_TYPE type) {
+  std::error_code error;
+  const std::filesystem::path canonical =
+      std::filesystem::weakly_canonical(path, error);
+  return "file:" + TypeKey(type) + ":" +
+         (error ? path.lexically_normal() : canonical).generic_string();
+}
+
+// compressed embedded textures are mWidth bytes long, uncompressed ones are
+// mWidth x mHeight texels
+static std::size_t EmbeddedDataSize(const aiTexture* embedded) {
+  return embedded->mHeight == 0
+             ? embedded->mWidth
+             : static_cast<std::size_t>(embedded->mWidth) * embedded->mHeight *
+                   sizeof(aiTexel);
+}
+
+static std::string EmbeddedTextureKey(const aiTexture* embedded,
+                                      const TEXTURE_TYPE type) {
+  const std::string_view data(reinterpret_cast<const char*>(embedded->pcData),
+                              EmbeddedDataSize(embedded));
+  return "embedded:" + TypeKey(type) + ":" + std::to_string(std::hash<std::string_view>()(data)) +
+         ":" + std::to_string(data.size());
+}
+
+TextureImage DecodeDefaultTexture(const TEXTURE_TYPE type) {
+  TextureImage out;
+  out.type = type;
+  out.key = DefaultTextureKey(type);
+  if (TextureManager::Instance().FindDecoded(&out)) {
+    return out;
+  }
+
+  LOG_INFO("Loading default texture");
+  int width, height, channels;
+  // 4 means desired channels, in this case we want 4 because RGBA
+  if (!CopyFlipped(stbi_load(DefaultTexturePath(type).c_str(), &width,
+                             &height, &channels, 4),
+                   width, height, &out)) {
     LOG_ERROR("Failed to load default texture");
     throw FileNotFoundException();
   }
+  return out;
+}
+
+TextureImage DecodeTexture(const std::filesystem::path& path,
+                           const TEXTURE_TYPE type) {
+  TextureImage out;
+  out.type = type;
+  out.key = FileTextureKey(path, type);
+  out.path = path;
+  if (TextureManager::Instance().FindDecoded(&out)) {
+    return out;
+  }
+
+  LOG_INFO("Loading texture from \"{}\" ", path.string());
+  int width, height, channels;
+  if (!CopyFlipped(
+          stbi_load(path.string().c_str(), &width, &height, &channels, 4),
+          width, height, &out)) {
+    LOG_WARN("Failed to load texture \"{}\"", path.string());
+    out = DecodeDefaultTexture(type);
+    out.path = path;
+  }
+  return out;
+}
 
-  stbi_set_flip_vertically_on_load(false);
+TextureImage DecodeTexture(const aiTexture* embedded, const TEXTURE_TYPE type) {
+  TextureImage out;
+  out.type = type;
+  out.key = EmbeddedTextureKey(embedded, type);
+  out.embedded = true;
+  if (TextureManager::Instance().FindDecoded(&out)) {
+    return out;
+  }
+
+  if (embedded->mHeight != 0) {
+    LOG_INFO("Loading uncompressed embedded texture from \"{}\"",
+             embedded->mFilename.C_Str());
+    CopyTexels(embedded, &out);
+    return out;
+  }
 
-  data_ = *image;
+  LOG_INFO("Loading embedded texture from \"{}\"", embedded->mFilename.C_Str());
+  int width, height, channels;
+  if (!CopyFlipped(stbi_load_from_memory(
+                       reinterpret_cast<const unsigned char*>(embedded->pcData),
+                       embedded->mWidth, &width, &height, &channels, 4),
+                   width, height, &out)) {
+    LOG_ERROR("Failed to load texture \"{}\"", embedded->mFilename.C_Str());
+    out = DecodeDefaultTexture(type);
+    out.embedded = true;
+  }
+  return out;
+}
 
-  glGenTextures(1, &id_);
+TextureManager& TextureManager::Instance() {
+  static TextureManager instance_;
+  return instance_;
+}
 
-  glBindTexture(GL_TEXTURE_2D, id_);
+bool TextureManager::FindDecoded(TextureImage* out) {
+  std::lock_guard<std::mutex> lock(decoded_mutex_);
+  const auto it = decoded_.find(out->key);
+  if (it == decoded_.end()) {
+    return false;
+  }
+  out->pixels = it->second.pixels.lock();
+  if (out->pixels == nullptr) {
+    decoded_.erase(it);
+    return false;
+  }
+  out->width = it->second.width;
+  out->height = it->second.height;
+  return true;
+}
 
-  // https://registry.khronos.org/OpenGL-Refpages/gl4/html/glTexImage2D.xhtml
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
-               GL_UNSIGNED_BYTE, image);
+void TextureManager::AddDecoded(const TextureImage& image) {
+  std::lock_guard<std::mutex> lock(decoded_mutex_);
+  decoded_[image.key] = {image.pixels, image.width, image.height};
+}
 
+TextureManager::~TextureManager() {
+  // normally already done by Shutdown(), the OpenGL objects are gone with the
+  // context by now
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    stop_ = true;
+  }
+  queue_cv_.notify_all();
+  for (std::thread& t : workers_) {
+    t.join();
+  }
+}
+
+GLuint TextureManager::CreatePlaceholder(const std::string& key,
+                                         const TEXTURE_TYPE type) {
+  // the neutral element of the texture type, like the default textures
+  unsigned char pixel[4] = {255, 255, 255, 255};
+  if (type == TEXTURE_TYPE::DISPLACEMENT) {
+    pixel[0] = pixel[1] = pixel[2] = 0;
+  } else if (type == TEXTURE_TYPE::NORMAL) {
+    pixel[0] = pixel[1] = 128;
+  }
+
+  GLuint id;
+  glGenTextures(1, &id);
+  glBindTexture(GL_TEXTURE_2D, id);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+               pixel);
   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   glBindTexture(GL_TEXTURE_2D, 0);
 
-  stbi_image_free(image);
-  LOG_INFO("Default texture has been created");
+  ids_[key] = id;
+  resident_[id] = {key, 1, next_serial_++, false, false};
+  return id;
 }
 
-Texture::Texture(const std::filesystem::path& path, const TEXTURE_TYPE type)
-    : id_(-1), type_(type) {
-  LOG_TRACE("Texture(const std::filesystem::path&, const TEXTURE_TYPE)");
+GLuint TextureManager::Acquire(const TextureImage& image) {
+  if (const auto it = ids_.find(image.key); it != ids_.end()) {
+    resident_.at(it->second).references++;
+    return it->second;
+  }
 
-  LOG_INFO("Loading texture from \"{}\" ", path.string());
-  int width, height, channels;
-  unsigned char* image = nullptr;
+  const GLuint id = CreatePlaceholder(image.key, image.type);
+  // already decoded, the workers only encode it
+  AddDecodeJob({id, resident_.at(id).serial, image.key,
+                [image]() { return image; }});
+  return id;
+}
 
-  stbi_set_flip_vertically_on_load(true);
+GLuint TextureManager::Acquire(const std::string& key, const TEXTURE_TYPE type,
+                               const std::function<TextureImage()>& decode) {
+  if (const auto it = ids_.find(key); it != ids_.end()) {
+    resident_.at(it->second).references++;
+    return it->second;
+  }
 
-  image = stbi_load(path.string().c_str(), &width, &height, &channels, 4);
+  const GLuint id = CreatePlaceholder(key, type);
+  AddDecodeJob({id, resident_.at(id).serial, key, decode});
+  return id;
+}
 
-  stbi_set_flip_vertically_on_load(false);
+void TextureManager::AddDecodeJob(const DecodeJob& job) {
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    decode_queue_.push_back(job);
+    // the workers are only started the first time they are needed
+    if (workers_.empty()) {
+      // BC4/BC5 (RGTC) are core since OpenGL 3.0, BC1/BC3 (S3TC) are an
+      // extension that every desktop driver has
+      compress_ = GLEW_EXT_texture_compression_s3tc;
+      const unsigned int n_workers = std::max(1U, WorkerCount() / 2);
+      for (unsigned int i = 0; i < n_workers; i++) {
+        workers_.emplace_back(&TextureManager::WorkerLoop, this);
+      }
+    }
+  }
+  queue_cv_.notify_one();
+}
 
-  // TODO refactor
-  if (image == nullptr) {
-    LOG_WARN("Failed to load texture \"{}\"", path.string());
+void TextureManager::WorkerLoop() {
+  const TextureCache cache("cache");
 
-    // TODO this "white.png" should be the path argument
-    // path = white.png
-    image = stbi_load("white.png", &width, &height, &channels, 4);
-    if (image == nullptr) {
-      LOG_ERROR("Failed to load default texture");
-      throw FileNotFoundException();
+  std::unique_lock<std::mutex> lock(queue_mutex_);
+  while (true) {
+    queue_cv_.wait(lock, [this] { return stop_ || !decode_queue_.empty(); });
+    if (stop_) {
+      return;
     }
-  }
+    const DecodeJob job = decode_queue_.front();
+    decode_queue_.pop_front();
+
+    lock.unlock();
+    Upload upload = {job.id, job.serial, job.key, EncodedTexture()};
+    // the cache skips the decoding too
+    bool ready = cache.Load(job.key, compress_, &upload.texture);
+    if (!ready) {
+      try {
+        upload.texture = EncodeTexture(job.decode(), compress_);
+        cache.Store(job.key, compress_, upload.texture);
+        ready = true;
+      } catch (...) {
+        LOG_ERROR("Failed to decode a texture, it keeps its placeholder");
+      }
+    }
+    lock.lock();
 
-  data_ = *image;
+    if (ready) {
+      uploads_.push_back(std::move(upload));
+    } else {
+      failed_.emplace_back(job.id, job.serial);
+    }
+  }
+}
 
-  glGenTextures(1, &id_);
+// https://registry.khronos.org/OpenGL-Refpages/gl4/html/glCompressedTexImage2D.xhtml
+static GLenum InternalFormat(const TEXTURE_FORMAT format) {
+  switch (format) {
+    case TEXTURE_FORMAT::R8:
+      return GL_R8;
+    case TEXTURE_FORMAT::BC1:
+      return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case TEXTURE_FORMAT::BC3:
+      return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case TEXTURE_FORMAT::BC5:
+      return GL_COMPRESSED_RG_RGTC2;
+    default:
+      return GL_RGBA8;
+  }
+}
 
-  glBindTexture(GL_TEXTURE_2D, id_);
+void TextureManager::UploadTexture(const Upload& upload) {
+  const auto it = resident_.find(upload.id);
+  if (it == resident_.end() || it->second.serial != upload.serial) {
+    return;  // released before its image was ready
+  }
 
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
-               GL_UNSIGNED_BYTE, image);
+  const EncodedTexture& texture = upload.texture;
+  const GLsizeiptr size = static_cast<GLsizeiptr>(texture.data.size());
 
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  // the levels go through a pixel buffer object so the glTexImage2D calls
+  // don't wait for the copy. The buffer is orphaned every time, the driver can
+  // keep transferring the previous texture from the old storage
+  if (pbo_ == 0) {
+    glGenBuffers(1, &pbo_);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo_);
+  glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+  void* mapped = glMapBufferRange(
+      GL_PIXEL_UNPACK_BUFFER, 0, size,
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (mapped != nullptr) {
+    std::memcpy(mapped, texture.data.data(), texture.data.size());
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  } else {
+    LOG_WARN("Could not map the pixel buffer, uploading directly");
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+  // with a pixel unpack buffer bound the data argument is an offset in it
+  auto level_data = [&texture, mapped](const EncodedTexture::Level& level) {
+    return mapped != nullptr
+               ? reinterpret_cast<const void*>(level.offset)
+               : static_cast<const void*>(texture.data.data() + level.offset);
+  };
+
+  const GLenum internal_format = InternalFormat(texture.format);
+  const bool compressed = texture.format != TEXTURE_FORMAT::RGBA8 &&
+                          texture.format != TEXTURE_FORMAT::R8;
+  glBindTexture(GL_TEXTURE_2D, upload.id);
+  // the R8 rows are not 4 bytes aligned
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (std::size_t i = 0; i < texture.levels.size(); i++) {
+    const EncodedTexture::Level& level = texture.levels[i];
+    const GLint mip = static_cast<GLint>(i);
+    if (compressed) {
+      glCompressedTexImage2D(GL_TEXTURE_2D, mip, internal_format, level.width,
+                             level.height, 0,
+                             static_cast<GLsizei>(level.size),
+                             level_data(level));
+    } else {
+      glTexImage2D(GL_TEXTURE_2D, mip, internal_format, level.width,
+                   level.height, 0,
+                   texture.format == TEXTURE_FORMAT::R8 ? GL_RED : GL_RGBA,
+                   GL_UNSIGNED_BYTE, level_data(level));
+    }
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                  static_cast<GLint>(texture.levels.size()) - 1);
+  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  GL_LINEAR_MIPMAP_LINEAR);
+  if (texture.format == TEXTURE_FORMAT::R8) {
+    // the shaders can read the height from any channel, as with RGBA
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+  }
   glBindTexture(GL_TEXTURE_2D, 0);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 
-  stbi_image_free(image);
-  LOG_INFO("Texture has been created from \"{}\"", path.string());
+  it->second.loaded = true;
+  LOG_INFO("Texture has been created ({})", upload.key);
 }
 
-Texture::Texture(const aiTexture* embedded, const TEXTURE_TYPE type)
-    : id_(-1), type_(type) {
-  LOG_TRACE("Texture(const aiTexture*, const TEXTURE_TYPE)");
-  LOG_INFO("Loading embedded texture from \"{}\"", embedded->mFilename.C_Str());
+void TextureManager::Update(const double budget_ms) {
+  using upload_clock = std::chrono::steady_clock;
+  const upload_clock::time_point start = upload_clock::now();
+
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    for (const auto& [id, serial] : failed_) {
+      const auto it = resident_.find(id);
+      if (it != resident_.end() && it->second.serial == serial) {
+        it->second.failed = true;
+      }
+    }
+    failed_.clear();
+  }
 
-  int width, height, channels;
-  unsigned char* image = nullptr;
+  do {
+    Upload upload;
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      if (uploads_.empty()) {
+        return;
+      }
+      upload = std::move(uploads_.front());
+      uploads_.pop_front();
+    }
+    UploadTexture(upload);
+  } while (std::chrono::duration<double, std::milli>(upload_clock::now() -
+                                                     start)
+               .count() < budget_ms);
+}
 
-  stbi_set_flip_vertically_on_load(true);
+void TextureManager::AddReference(const GLuint id) {
+  if (const auto it = resident_.find(id); it != resident_.end()) {
+    it->second.references++;
+  }
+}
 
-  image =
-      stbi_load_from_memory((unsigned char*)embedded->pcData, embedded->mWidth,
-                            &width, &height, &channels, 4);
+void TextureManager::Release(const GLuint id) {
+  const auto it = resident_.find(id);
+  if (it == resident_.end()) {
+    return;
+  }
+  if (--it->second.references > 0) {
+    return;
+  }
 
-  stbi_set_flip_vertically_on_load(false);
+  // an upload still in the queue is skipped, its serial won't match
+  for (auto key_it = ids_.begin(); key_it != ids_.end();) {
+    if (key_it->second == id) {
+      key_it = ids_.erase(key_it);
+    } else {
+      ++key_it;
+    }
+  }
+  LOG_INFO("Texture has been deleted ({})", it->second.key);
+  resident_.erase(it);
+  glDeleteTextures(1, &id);
+}
 
-  // TODO refactor
-  if (image == nullptr) {
-    LOG_ERROR("Failed to load texture \"{}\"", embedded->mFilename.C_Str());
-    image = stbi_load("white.png", &width, &height, &channels, 4);
-    if (image == nullptr) {
-      LOG_ERROR("Failed to load default texture");
-      throw FileNotFoundException();
+bool TextureManager::IsResident(const GLuint id) const {
+  const auto it = resident_.find(id);
+  return it != resident_.end() && it->second.loaded;
+}
+
+bool TextureManager::Busy() const {
+  for (const auto& [id, resident] : resident_) {
+    if (!resident.loaded && !resident.failed) {
+      return true;
     }
   }
+  return false;
+}
 
-  data_ = *image;
+void TextureManager::Shutdown() {
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    stop_ = true;
+    decode_queue_.clear();
+    uploads_.clear();
+  }
+  queue_cv_.notify_all();
+  for (std::thread& t : workers_) {
+    t.join();
+  }
+  workers_.clear();
 
-  glGenTextures(1, &id_);
+  if (pbo_ != 0) {
+    glDeleteBuffers(1, &pbo_);
+    pbo_ = 0;
+  }
+}
 
-  glBindTexture(GL_TEXTURE_2D, id_);
+Texture::Texture(const TextureImage& image)
+    : id_(TextureManager::Instance().Acquire(image)),
+      type_(image.type),
+      path_(image.path),
+      embedded_(image.embedded) {
+  LOG_TRACE("Texture(const TextureImage&)");
+}
 
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
-               GL_UNSIGNED_BYTE, image);
+Texture::Texture(const TEXTURE_TYPE type)
+    : id_(TextureManager::Instance().Acquire(
+          DefaultTextureKey(type), type,
+          [type]() { return DecodeDefaultTexture(type); })),
+      type_(type),
+      embedded_(false) {
+  LOG_TRACE("Texture(const TEXTURE_TYPE)");
+}
 
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  glBindTexture(GL_TEXTURE_2D, 0);
+Texture::Texture(const std::filesystem::path& path, const TEXTURE_TYPE type)
+    : id_(TextureManager::Instance().Acquire(
+          FileTextureKey(path, type), type,
+          // the worker outlives the reference, the path is copied
+          [path, type]() { return DecodeTexture(path, type); })),
+      type_(type),
+      path_(path),
+      embedded_(false) {
+  LOG_TRACE("Texture(const std::filesystem::path&, const TEXTURE_TYPE)");
+}
 
-  stbi_image_free(image);
-  LOG_INFO("Texture has been created from \"{}\"", embedded->mFilename.C_Str());
+Texture::Texture(const aiTexture* embedded, const TEXTURE_TYPE type)
+    // the aiTexture belongs to the scene and may be gone before a worker gets
+    // to it, so it is decoded right away and only the upload waits
+    : id_(TextureManager::Instance().Acquire(DecodeTexture(embedded, type))),
+      type_(type),
+      embedded_(true) {
+  LOG_TRACE("Texture(const aiTexture*, const TEXTURE_TYPE)");
 }
 
 Texture::~Texture() {
   LOG_TRACE("~Texture()");
+  TextureManager::Instance().Release(id_);
+}
+
+Texture::Texture(const Texture& other)
+    : id_(other.id_),
+      type_(other.type_),
+      path_(other.path_),
+      embedded_(other.embedded_) {
+  TextureManager::Instance().AddReference(id_);
+}
+
+Texture& Texture::operator=(const Texture& other) {
+  // the reference is added first in case other shares the texture
+  TextureManager::Instance().AddReference(other.id_);
+  TextureManager::Instance().Release(id_);
+  id_ = other.id_;
+  type_ = other.type_;
+  path_ = other.path_;
+  embedded_ = other.embedded_;
+  return *this;
+}
+
+Texture::Texture(Texture&& other)
+    : id_(other.id_),
+      type_(other.type_),
+      path_(std::move(other.path_)),
+      embedded_(other.embedded_) {
+  other.id_ = 0;  // never a texture, Release() ignores it
+}
+
+Texture& Texture::operator=(Texture&& other) {
+  if (this != &other) {
+    TextureManager::Instance().Release(id_);
+    id_ = other.id_;
+    type_ = other.type_;
+    path_ = std::move(other.path_);
+    embedded_ = other.embedded_;
+    other.id_ = 0;
+  }
+  return *this;
 }
 
 GLuint Texture::id() const {
@@ -157,3 +593,11 @@ GLuint Texture::id() const {
 TEXTURE_TYPE Texture::type() const {
   return type_;
 }
+
+const std::filesystem::path& Texture::path() const {
+  return path_;
+}
+
+bool Texture::embedded() const {
+  return embedded_;
+}
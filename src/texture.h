@@ -2,7 +2,16 @@
 #define TEXTURE_H
 
 #include <string>
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <GL/glew.h>
 
@@ -14,8 +23,169 @@ enum class TEXTURE_TYPE {
   NORMAL
 };
 
+// RGBA pixels decoded on the CPU and not uploaded yet. Decoding doesn't touch
+// OpenGL so it can run on any thread, the upload (Texture(const TextureImage&))
+// must happen on the thread that owns the context
+struct TextureImage {
+  TEXTURE_TYPE type;
+  int width = 0;
+  int height = 0;
+  // rows from the bottom to the top, as OpenGL wants them. Shared between the
+  // images with the same key
+  std::shared_ptr<const std::vector<unsigned char>> pixels;
+  // what the pixels are: the canonical file path, a hash of the embedded data
+  // or the name of the default texture, with the type (it picks the encoding)
+  std::string key;
+  std::filesystem::path path;
+  bool embedded = false;
+};
+
+enum class TEXTURE_FORMAT {
+  RGBA8,
+  R8,
+  BC1,  // RGB, 8 bytes per 4x4 block
+  BC3,  // RGBA, 16 bytes per 4x4 block
+  BC5   // RG, 16 bytes per 4x4 block
+};
+
+// a texture ready to be uploaded (see texture_encoder.h): all its mip levels,
+// from the full size one to 1x1, one after the other in data
+struct EncodedTexture {
+  struct Level {
+    int width;
+    int height;
+    std::size_t offset;
+    std::size_t size;
+  };
+
+  TEXTURE_FORMAT format = TEXTURE_FORMAT::RGBA8;
+  std::vector<Level> levels;
+  std::vector<unsigned char> data;
+};
+
+// if the image can't be decoded the default texture of the type is returned
+// instead (throws FileNotFoundException if even that one is missing)
+TextureImage DecodeTexture(const std::filesystem::path& path,
+                           const TEXTURE_TYPE type);
+// compressed embedded textures (png, jpeg...) are decoded with stb_image, the
+// uncompressed ones are copied from their texels
+TextureImage DecodeTexture(const aiTexture* embedded, const TEXTURE_TYPE type);
+TextureImage DecodeDefaultTexture(const TEXTURE_TYPE type);
+
+// A Texture is a handle to an OpenGL texture that is shared with every other
+// Texture made from the same image (see TextureImage::key): the manager counts
+// the handles and deletes the OpenGL texture when the last one is destroyed.
+// It also shares the decoded pixels while some TextureImage holds them, so a
+// file used by many meshes is decoded once.
+// Nothing is loaded while a Texture is made: a new texture shows a 1 pixel
+// placeholder (the neutral color of its type) while the worker threads decode
+// its image and encode it with its mip chain (or find it in the texture
+// cache), then Update() uploads a few of them per frame through a pixel buffer
+// object.
+// Only FindDecoded()/AddDecoded() are thread safe, the rest must be used on
+// the GL thread
+class TextureManager {
+ public:
+  TextureManager(const TextureManager&) = delete;
+  TextureManager& operator=(const TextureManager&) = delete;
+  TextureManager(TextureManager&&) = delete;
+  TextureManager& operator=(TextureManager&&) = delete;
+  ~TextureManager();
+
+  static TextureManager& Instance();
+
+  // false if no image with out->key is held right now, otherwise out gets its
+  // pixels and size
+  bool FindDecoded(TextureImage* out);
+  void AddDecoded(const TextureImage& image);
+
+  // the OpenGL texture of image.key, image is encoded and uploaded if the
+  // texture doesn't exist yet
+  GLuint Acquire(const TextureImage& image);
+  // same, decode() runs on a worker thread if the texture doesn't exist yet
+  GLuint Acquire(const std::string& key, const TEXTURE_TYPE type,
+                 const std::function<TextureImage()>& decode);
+  void AddReference(GLuint id);
+  // deletes the texture if it was the last reference
+  void Release(GLuint id);
+
+  // uploads the encoded textures for about budget_ms (at least one per call),
+  // once per frame
+  void Update(double budget_ms = 2.0);
+  // true if the texture shows its image and not the placeholder
+  [[nodiscard]] bool IsResident(GLuint id) const;
+  // true while some texture still waits for its image (the ones that failed to
+  // decode don't count)
+  [[nodiscard]] bool Busy() const;
+  // stops the workers and deletes the pixel buffer, it must be called while
+  // the OpenGL context still exists
+  void Shutdown();
+
+ private:
+  TextureManager() = default;
+
+  struct Resident {
+    std::string key;
+    int references;
+    // OpenGL reuses the names of deleted textures, a pending upload is only
+    // done if the serial still matches
+    unsigned int serial;
+    bool loaded;
+    // its image couldn't be decoded, it keeps the placeholder for good
+    bool failed;
+  };
+  struct Decoded {
+    std::weak_ptr<const std::vector<unsigned char>> pixels;
+    int width;
+    int height;
+  };
+  struct DecodeJob {
+    GLuint id;
+    unsigned int serial;
+    std::string key;
+    std::function<TextureImage()> decode;
+  };
+  struct Upload {
+    GLuint id;
+    unsigned int serial;
+    std::string key;
+    EncodedTexture texture;
+  };
+
+  GLuint CreatePlaceholder(const std::string& key, const TEXTURE_TYPE type);
+  void AddDecodeJob(const DecodeJob& job);
+  void UploadTexture(const Upload& upload);
+  void WorkerLoop();
+
+  std::unordered_map<std::string, GLuint> ids_;
+  std::unordered_map<GLuint, Resident> resident_;
+  unsigned int next_serial_ = 0;
+  GLuint pbo_ = 0;
+
+  std::unordered_map<std::string, Decoded> decoded_;
+  std::mutex decoded_mutex_;
+
+  // shared with the workers
+  std::deque<DecodeJob> decode_queue_;
+  std::deque<Upload> uploads_;
+  // id and serial of the textures whose decoding failed, marked by Update()
+  std::vector<std::pair<GLuint, unsigned int>> failed_;
+  std::mutex queue_mutex_;
+  std::condition_variable queue_cv_;
+  std::vector<std::thread> workers_;
+  bool stop_ = false;
+  // block compressed formats are supported, set before the workers start
+  bool compress_ = false;
+};
+
 class Texture {
  public:
+  /**
+   * @brief uploads an already decoded image
+   *
+   * @param image
+   */
+  explicit Texture(const TextureImage& image);
   /**
    * @brief Construct a new Texture object from a given path
    *
@@ -31,22 +201,29 @@ class Texture {
   Texture(const TEXTURE_TYPE type);
 
   ~Texture();
-  Texture(const Texture& other) = default;
-  Texture& operator=(const Texture& other) = default;
-  Texture(Texture&& other) = default;
-  Texture& operator=(Texture&& other) = default;
+  Texture(const Texture& other);
+  Texture& operator=(const Texture& other);
+  Texture(Texture&& other);
+  Texture& operator=(Texture&& other);
 
   TEXTURE_TYPE type() const;
 
   GLuint id() const;
 
+  // the file the texture was loaded from (empty for the default textures and
+  // the embedded ones)
+  const std::filesystem::path& path() const;
+  // true if it was loaded from a texture embedded in the model file
+  bool embedded() const;
+
  private:
   GLuint id_;
   // Texture type article
   // https://help.poliigon.com/en/articles/1712652-what-are-the-different-texture-maps-for
   // https://assimp.sourceforge.net/lib_html/material_8h.html#a7dd415ff703a2cc53d1c22ddbbd7dde0
   TEXTURE_TYPE type_;
-  unsigned char data_;
+  std::filesystem::path path_;
+  bool embedded_;
 };
 
 #endif  // TEXTURE_H
@@ -0,0 +1,227 @@
+#include "texture_cache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+#include <thread>
+
+#include "logger.h"
+#include "mapped_file.h"
+#include "utilities.h"
+
+namespace {
+
+// bump it every time the layout below or the encoder output changes
+constexpr uint32_t kCacheVersion = 1;
+constexpr char kCacheMagic[8] = {'T', 'E', 'S', 'S', 'T', 'E', 'X', '\0'};
+constexpr uint32_t kByteOrder = 0x01020304;
+
+struct CacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t stamp;  // see CacheStamp()
+  uint32_t key_length;
+  uint32_t format;  // TEXTURE_FORMAT
+  uint32_t n_levels;
+  uint32_t padding;
+  uint64_t data_size;
+};
+
+struct CachedLevel {
+  uint32_t width;
+  uint32_t height;
+  uint64_t offset;
+  uint64_t size;
+};
+
+// the file a key refers to, empty for the embedded textures. The file keys
+// are "file:<type>:<path>"
+std::filesystem::path SourceOf(const std::string& key) {
+  if (key.rfind("file:", 0) == 0) {
+    return key.substr(key.find(':', std::strlen("file:")) + 1);
+  }
+  if (key.rfind("default:", 0) == 0) {
+    return key.substr(std::strlen("default:"));
+  }
+  return {};
+}
+
+// what makes a cache file stale: the size and modification time of the source
+// file and compress
+bool CacheStamp(const std::string& key, const bool compress, uint64_t* stamp) {
+  uint64_t hash = Fnv1a(&compress, sizeof(compress));
+  const std::filesystem::path source = SourceOf(key);
+  if (!source.empty()) {
+    std::error_code error;
+    const uintmax_t size = std::filesystem::file_size(source, error);
+    if (error) {
+      return false;
+    }
+    const auto mtime = std::filesystem::last_write_time(source, error)
+                           .time_since_epoch()
+                           .count();
+    if (error) {
+      return false;
+    }
+    hash = Fnv1a(&size, sizeof(size), hash);
+    hash = Fnv1a(&mtime, sizeof(mtime), hash);
+  }
+  *stamp = hash;
+  return true;
+}
+
+bool IsTextureFormat(const uint32_t format) {
+  for (const TEXTURE_FORMAT x :
+       {TEXTURE_FORMAT::RGBA8, TEXTURE_FORMAT::R8, TEXTURE_FORMAT::BC1,
+        TEXTURE_FORMAT::BC3, TEXTURE_FORMAT::BC5}) {
+    if (format == static_cast<uint32_t>(to_underlying(x))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+TextureCache::TextureCache(const std::filesystem::path& directory)
+    : directory_(directory) {
+  //
+}
+
+std::filesystem::path TextureCache::CachePath(const std::string& key,
+                                              const bool compress) const {
+  // the key includes the type of the texture, so does the name
+  const uint64_t name =
+      Fnv1a(&compress, sizeof(compress), Fnv1a(key.data(), key.size()));
+  char hex[17];
+  std::snprintf(hex, sizeof(hex), "%016llx",
+                static_cast<unsigned long long>(name));
+  return directory_ / (std::string(hex) + ".tex");
+}
+
+bool TextureCache::Load(const std::string& key, const bool compress,
+                        EncodedTexture* out) const {
+  const std::filesystem::path cache_path = CachePath(key, compress);
+  uint64_t stamp = 0;
+  std::error_code error;
+  if (!std::filesystem::exists(cache_path, error) ||
+      !CacheStamp(key, compress, &stamp)) {
+    return false;
+  }
+
+  try {
+    const MappedFile file(cache_path);
+    const char* p = file.data();
+    const char* end = file.data() + file.size();
+
+    CacheHeader header;
+    if (file.size() < sizeof(header)) {
+      return false;
+    }
+    std::memcpy(&header, p, sizeof(header));
+    p += sizeof(header);
+    const std::size_t padded_key = (header.key_length + 3) / 4 * 4;
+    if (std::memcmp(header.magic, kCacheMagic, sizeof(kCacheMagic)) != 0 ||
+        header.version != kCacheVersion || header.byte_order != kByteOrder ||
+        header.stamp != stamp || !IsTextureFormat(header.format) ||
+        static_cast<std::size_t>(end - p) < padded_key ||
+        std::string(p, header.key_length) != key) {
+      LOG_INFO("texture cache for {} is out of date", key);
+      return false;
+    }
+    p += padded_key;
+
+    const std::size_t levels_size = header.n_levels * sizeof(CachedLevel);
+    if (static_cast<std::size_t>(end - p) < levels_size ||
+        static_cast<std::size_t>(end - p) - levels_size < header.data_size) {
+      LOG_WARN("texture cache {} is corrupted", cache_path.string());
+      return false;
+    }
+    EncodedTexture texture;
+    texture.format = static_cast<TEXTURE_FORMAT>(header.format);
+    for (uint32_t i = 0; i < header.n_levels; i++) {
+      CachedLevel level;
+      std::memcpy(&level, p + i * sizeof(CachedLevel), sizeof(CachedLevel));
+      if (level.offset > header.data_size ||
+          level.size > header.data_size - level.offset) {
+        LOG_WARN("texture cache {} is corrupted", cache_path.string());
+        return false;
+      }
+      texture.levels.push_back({static_cast<int>(level.width),
+                                static_cast<int>(level.height),
+                                static_cast<std::size_t>(level.offset),
+                                static_cast<std::size_t>(level.size)});
+    }
+    p += levels_size;
+    texture.data.assign(p, p + header.data_size);
+    *out = std::move(texture);
+  } catch (const FileNotFoundException&) {
+    return false;
+  }
+  return true;
+}
+
+void TextureCache::Store(const std::string& key, const bool compress,
+                         const EncodedTexture& texture) const {
+  uint64_t stamp = 0;
+  if (!CacheStamp(key, compress, &stamp)) {
+    return;
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(directory_, error);
+  const std::filesystem::path cache_path = CachePath(key, compress);
+  // same as the mesh cache: written next to it and renamed at the end, with a
+  // name per thread
+  std::filesystem::path temporary_path = cache_path;
+  temporary_path +=
+      "." +
+      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) +
+      ".tmp";
+  {
+    std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      LOG_WARN("could not write the texture cache {}", cache_path.string());
+      std::filesystem::remove(temporary_path, error);
+      return;
+    }
+
+    CacheHeader header = {};
+    std::memcpy(header.magic, kCacheMagic, sizeof(kCacheMagic));
+    header.version = kCacheVersion;
+    header.byte_order = kByteOrder;
+    header.stamp = stamp;
+    header.key_length = static_cast<uint32_t>(key.size());
+    header.format = static_cast<uint32_t>(to_underlying(texture.format));
+    header.n_levels = static_cast<uint32_t>(texture.levels.size());
+    header.data_size = texture.data.size();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    const char padding[4] = {0, 0, 0, 0};
+    file.write(key.data(), static_cast<std::streamsize>(key.size()));
+    file.write(padding, static_cast<std::streamsize>((4 - key.size() % 4) % 4));
+
+    for (const EncodedTexture::Level& x : texture.levels) {
+      const CachedLevel level = {static_cast<uint32_t>(x.width),
+                                 static_cast<uint32_t>(x.height), x.offset,
+                                 x.size};
+      file.write(reinterpret_cast<const char*>(&level), sizeof(level));
+    }
+    file.write(reinterpret_cast<const char*>(texture.data.data()),
+               static_cast<std::streamsize>(texture.data.size()));
+    if (!file) {
+      LOG_WARN("could not write the texture cache {}", cache_path.string());
+      file.close();
+      std::filesystem::remove(temporary_path, error);
+      return;
+    }
+  }
+
+  std::filesystem::rename(temporary_path, cache_path, error);
+  if (error) {
+    LOG_WARN("could not write the texture cache {}", cache_path.string());
+    std::filesystem::remove(temporary_path, error);
+  }
+}
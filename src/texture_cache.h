@@ -0,0 +1,34 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <filesystem>
+#include <string>
+
+#include "texture.h"
+
+// Binary cache of encoded textures (see EncodeTexture()), so the mip chain and
+// the block compression are only computed the first time a texture is loaded.
+// Every (TextureImage::key, compress) pair gets its own cache file with a
+// header (format version, key, a hash of the size and modification time of
+// the source file), the levels and their data as they are uploaded.
+// The embedded textures have no source file, their key is already a hash of
+// their data.
+// Neither Load() nor Store() touch OpenGL
+class TextureCache {
+ public:
+  explicit TextureCache(const std::filesystem::path& directory);
+
+  // false if there is no up to date cache for the key
+  bool Load(const std::string& key, bool compress, EncodedTexture* out) const;
+  // errors are only logged, the cache is just an optimization
+  void Store(const std::string& key, bool compress,
+             const EncodedTexture& texture) const;
+
+ private:
+  [[nodiscard]] std::filesystem::path CachePath(const std::string& key,
+                                                bool compress) const;
+
+  std::filesystem::path directory_;
+};
+
+#endif  // TEXTURE_CACHE_H
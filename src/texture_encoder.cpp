@@ -0,0 +1,280 @@
+#include "texture_encoder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "parallel.h"
+
+namespace {
+
+// an RGBA8 mip level
+struct Level {
+  int width;
+  int height;
+  std::vector<unsigned char> pixels;
+};
+
+// each pixel is the average of the 2x2 pixels above it. With an odd size the
+// last row/column is just repeated, good enough for textures that are almost
+// always powers of two
+Level Downsample(const Level& in) {
+  Level out;
+  out.width = std::max(1, in.width / 2);
+  out.height = std::max(1, in.height / 2);
+  out.pixels.resize(static_cast<std::size_t>(out.width) * out.height * 4);
+
+  for (int y = 0; y < out.height; y++) {
+    const int y0 = std::min(2 * y, in.height - 1);
+    const int y1 = std::min(2 * y + 1, in.height - 1);
+    const unsigned char* row0 = in.pixels.data() + std::size_t(y0) * in.width * 4;
+    const unsigned char* row1 = in.pixels.data() + std::size_t(y1) * in.width * 4;
+    unsigned char* dst = out.pixels.data() + std::size_t(y) * out.width * 4;
+    // no dependency between the iterations, the compiler vectorizes it
+    for (int x = 0; x < out.width; x++) {
+      const int x0 = std::min(2 * x, in.width - 1) * 4;
+      const int x1 = std::min(2 * x + 1, in.width - 1) * 4;
+      for (int c = 0; c < 4; c++) {
+        dst[x * 4 + c] = static_cast<unsigned char>(
+            (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) /
+            4);
+      }
+    }
+  }
+  return out;
+}
+
+// the 4x4 block at (bx, by), the pixels outside the image repeat the edge
+void FetchBlock(const Level& level, const int bx, const int by,
+                unsigned char block[16][4]) {
+  for (int y = 0; y < 4; y++) {
+    const int py = std::min(by * 4 + y, level.height - 1);
+    for (int x = 0; x < 4; x++) {
+      const int px = std::min(bx * 4 + x, level.width - 1);
+      std::memcpy(block[y * 4 + x],
+                  level.pixels.data() +
+                      (std::size_t(py) * level.width + px) * 4,
+                  4);
+    }
+  }
+}
+
+// https://learn.microsoft.com/en-us/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression#bc4
+// 2 endpoints and 16 3-bit indices into the 8 values between them
+void EncodeBC4Block(const unsigned char block[16][4], const int channel,
+                    unsigned char* out) {
+  unsigned char lo = 255;
+  unsigned char hi = 0;
+  for (int i = 0; i < 16; i++) {
+    lo = std::min(lo, block[i][channel]);
+    hi = std::max(hi, block[i][channel]);
+  }
+  out[0] = hi;
+  out[1] = lo;
+
+  // with hi > lo the palette is hi, lo and 6 values in between
+  int palette[8] = {hi, lo};
+  for (int k = 1; k < 7; k++) {
+    palette[k + 1] = ((7 - k) * hi + k * lo) / 7;
+  }
+
+  uint64_t indices = 0;
+  if (hi != lo) {
+    for (int i = 0; i < 16; i++) {
+      int best = 0;
+      int best_error = 256;
+      for (int k = 0; k < 8; k++) {
+        const int error = std::abs(palette[k] - block[i][channel]);
+        if (error < best_error) {
+          best = k;
+          best_error = error;
+        }
+      }
+      indices |= static_cast<uint64_t>(best) << (3 * i);
+    }
+  }
+  for (int i = 0; i < 6; i++) {
+    out[2 + i] = static_cast<unsigned char>(indices >> (8 * i));
+  }
+}
+
+uint16_t To565(const int r, const int g, const int b) {
+  return static_cast<uint16_t>(((r * 31 + 127) / 255) << 11 |
+                               ((g * 63 + 127) / 255) << 5 |
+                               ((b * 31 + 127) / 255));
+}
+
+void From565(const uint16_t c, int rgb[3]) {
+  rgb[0] = ((c >> 11) & 31) * 255 / 31;
+  rgb[1] = ((c >> 5) & 63) * 255 / 63;
+  rgb[2] = (c & 31) * 255 / 31;
+}
+
+// https://learn.microsoft.com/en-us/windows/win32/direct3d10/d3d10-graphics-programming-guide-resources-block-compression#bc1
+// the endpoints are the corners of the bounding box of the colors (moved a bit
+// inside), each pixel takes the closest of the 4 colors of the palette
+void EncodeBC1Block(const unsigned char block[16][4], unsigned char* out) {
+  int lo[3] = {255, 255, 255};
+  int hi[3] = {0, 0, 0};
+  for (int i = 0; i < 16; i++) {
+    for (int c = 0; c < 3; c++) {
+      lo[c] = std::min<int>(lo[c], block[i][c]);
+      hi[c] = std::max<int>(hi[c], block[i][c]);
+    }
+  }
+  for (int c = 0; c < 3; c++) {
+    const int inset = (hi[c] - lo[c]) / 16;
+    lo[c] += inset;
+    hi[c] -= inset;
+  }
+
+  uint16_t c0 = To565(hi[0], hi[1], hi[2]);
+  uint16_t c1 = To565(lo[0], lo[1], lo[2]);
+  // c0 > c1 selects the 4 color mode
+  if (c0 < c1) {
+    std::swap(c0, c1);
+  }
+  int palette[4][3];
+  From565(c0, palette[0]);
+  From565(c1, palette[1]);
+  for (int c = 0; c < 3; c++) {
+    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+  }
+
+  uint32_t indices = 0;
+  if (c0 != c1) {
+    for (int i = 0; i < 16; i++) {
+      int best = 0;
+      int best_error = 3 * 256 * 256;
+      for (int k = 0; k < 4; k++) {
+        int error = 0;
+        for (int c = 0; c < 3; c++) {
+          const int d = palette[k][c] - block[i][c];
+          error += d * d;
+        }
+        if (error < best_error) {
+          best = k;
+          best_error = error;
+        }
+      }
+      indices |= static_cast<uint32_t>(best) << (2 * i);
+    }
+  }
+
+  out[0] = static_cast<unsigned char>(c0);
+  out[1] = static_cast<unsigned char>(c0 >> 8);
+  out[2] = static_cast<unsigned char>(c1);
+  out[3] = static_cast<unsigned char>(c1 >> 8);
+  for (int i = 0; i < 4; i++) {
+    out[4 + i] = static_cast<unsigned char>(indices >> (8 * i));
+  }
+}
+
+std::size_t BlockSize(const TEXTURE_FORMAT format) {
+  return format == TEXTURE_FORMAT::BC1 ? 8 : 16;
+}
+
+bool IsBlockCompressed(const TEXTURE_FORMAT format) {
+  return format == TEXTURE_FORMAT::BC1 || format == TEXTURE_FORMAT::BC3 ||
+         format == TEXTURE_FORMAT::BC5;
+}
+
+void EncodeLevel(const Level& level, const TEXTURE_FORMAT format,
+                 unsigned char* out) {
+  const std::size_t n_pixels = std::size_t(level.width) * level.height;
+  if (format == TEXTURE_FORMAT::RGBA8) {
+    std::memcpy(out, level.pixels.data(), n_pixels * 4);
+    return;
+  }
+  if (format == TEXTURE_FORMAT::R8) {
+    for (std::size_t i = 0; i < n_pixels; i++) {
+      out[i] = level.pixels[i * 4];
+    }
+    return;
+  }
+
+  const int blocks_x = (level.width + 3) / 4;
+  const int blocks_y = (level.height + 3) / 4;
+  const std::size_t block_size = BlockSize(format);
+  // one row of blocks per iteration, only big levels are worth the threads
+  ParallelFor(
+      0, blocks_y,
+      [&](const std::size_t by) {
+        unsigned char block[16][4];
+        unsigned char* dst = out + by * blocks_x * block_size;
+        for (int bx = 0; bx < blocks_x; bx++, dst += block_size) {
+          FetchBlock(level, bx, static_cast<int>(by), block);
+          switch (format) {
+            case TEXTURE_FORMAT::BC1:
+              EncodeBC1Block(block, dst);
+              break;
+            case TEXTURE_FORMAT::BC3:
+              EncodeBC4Block(block, 3, dst);
+              EncodeBC1Block(block, dst + 8);
+              break;
+            case TEXTURE_FORMAT::BC5:
+              EncodeBC4Block(block, 0, dst);
+              EncodeBC4Block(block, 1, dst + 8);
+              break;
+            default:
+              break;
+          }
+        }
+      },
+      64);
+}
+
+std::size_t LevelSize(const int width, const int height,
+                      const TEXTURE_FORMAT format) {
+  if (IsBlockCompressed(format)) {
+    return std::size_t((width + 3) / 4) * ((height + 3) / 4) *
+           BlockSize(format);
+  }
+  return std::size_t(width) * height *
+         (format == TEXTURE_FORMAT::R8 ? 1 : 4);
+}
+
+}  // namespace
+
+TEXTURE_FORMAT ChooseFormat(const TextureImage& image, const bool compress) {
+  switch (image.type) {
+    case TEXTURE_TYPE::DISPLACEMENT:
+      return TEXTURE_FORMAT::R8;
+    case TEXTURE_TYPE::NORMAL:
+      return compress ? TEXTURE_FORMAT::BC5 : TEXTURE_FORMAT::RGBA8;
+    default:
+      break;
+  }
+  if (!compress) {
+    return TEXTURE_FORMAT::RGBA8;
+  }
+  const std::vector<unsigned char>& pixels = *image.pixels;
+  for (std::size_t i = 3; i < pixels.size(); i += 4) {
+    if (pixels[i] != 255) {
+      return TEXTURE_FORMAT::BC3;
+    }
+  }
+  return TEXTURE_FORMAT::BC1;
+}
+
+EncodedTexture EncodeTexture(const TextureImage& image, const bool compress) {
+  EncodedTexture out;
+  out.format = ChooseFormat(image, compress);
+
+  Level level = {image.width, image.height, *image.pixels};
+  while (true) {
+    const std::size_t offset = out.data.size();
+    const std::size_t size = LevelSize(level.width, level.height, out.format);
+    out.data.resize(offset + size);
+    EncodeLevel(level, out.format, out.data.data() + offset);
+    out.levels.push_back({level.width, level.height, offset, size});
+
+    if (level.width == 1 && level.height == 1) {
+      break;
+    }
+    level = Downsample(level);
+  }
+  return out;
+}
@@ -0,0 +1,18 @@
+#ifndef TEXTURE_ENCODER_H
+#define TEXTURE_ENCODER_H
+
+#include "texture.h"
+
+// the format a decoded image is uploaded with:
+// - DIFFUSE: BC1, or BC3 if some pixel is not opaque
+// - DISPLACEMENT: R8, the height is a single channel and block compression
+//   would show up as steps in the tessellated surface
+// - NORMAL: BC5 (x and y, z is reconstructed)
+// without compress the color textures stay RGBA8
+TEXTURE_FORMAT ChooseFormat(const TextureImage& image, bool compress);
+
+// builds the whole mip chain with a 2x2 box filter and encodes every level in
+// the chosen format. Doesn't touch OpenGL, it runs on the texture workers
+EncodedTexture EncodeTexture(const TextureImage& image, bool compress);
+
+#endif  // TEXTURE_ENCODER_H
@@ -1,6 +1,8 @@
 #ifndef UTILITIES_H
 #define UTILITIES_H
 
+#include <cstddef>
+#include <cstdint>
 #include <stdexcept>
 #include <type_traits>
 
@@ -12,6 +14,17 @@ template <class T>
   return static_cast<typename std::underlying_type<T>::type>(val);
 }
 
+// https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function
+inline uint64_t Fnv1a(const void* data, const std::size_t size,
+                      uint64_t hash = 0xcbf29ce484222325ULL) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for (std::size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
 /**
  * Semplici strutture che rappresentano delle eccezioni
  */